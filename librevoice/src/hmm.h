@@ -8,7 +8,21 @@ extern "C"
 #endif
 
 typedef struct RvSparseHMM RvSparseHMM;
-RV_EXPORT void rvHMMViterbiForwardRest(const RvSparseHMM *sparseHMM, RvReal *oldDelta, RvReal *obs, RvReal *newDelta, int *psi);
+RV_EXPORT RvSparseHMM *rvCreateSparseHMM(const RvReal *init, const int *frm, const int *to, const RvReal *transProb, int nState, int nTrans);
+RV_EXPORT RvSparseHMM *rvRetainSparseHMM(RvSparseHMM *sparseHMM);
+RV_EXPORT void rvReleaseSparseHMM(RvSparseHMM *sparseHMM);
+RV_EXPORT int rvSparseHMMNState(const RvSparseHMM *sparseHMM);
+RV_EXPORT int rvSparseHMMNTrans(const RvSparseHMM *sparseHMM);
+RV_EXPORT int rvSparseHMMBackpointerSize(const RvSparseHMM *sparseHMM);
+
+RV_EXPORT void rvHMMViterbiForwardRest(const RvSparseHMM *sparseHMM, const RvReal *oldDelta, const RvReal *obs, RvReal *newDelta, int *psi);
+RV_EXPORT int rvHMMViterbiForwardBeam(const RvSparseHMM *sparseHMM, const RvReal *oldDelta, const int *active, int nActive, const RvReal *obs, RvReal logBeam, RvReal *newDelta, int *psi, int *newActive);
+RV_EXPORT int rvHMMPruneBeam(RvReal *deltaIO, int nState, RvReal logBeam, int *active);
+RV_EXPORT void rvSparseHMMViterbiDecode(const RvSparseHMM *sparseHMM, const RvReal *obs, int nFrame, int *out);
+RV_EXPORT void rvHMMForwardRest(const RvSparseHMM *sparseHMM, const RvReal *oldAlpha, const RvReal *obs, RvReal *newAlpha);
+RV_EXPORT void rvHMMBackwardRest(const RvSparseHMM *sparseHMM, const RvReal *nextBeta, const RvReal *nextObs, RvReal *beta, RvReal *temp);
+// nThread > 1 splits the work into up to nThread parts for the shared thread pool
+RV_EXPORT RvReal rvSparseHMMPosterior(const RvSparseHMM *sparseHMM, const RvReal *obs, int nFrame, int nThread, RvReal *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvHNMAnalyzerParameter
+{
+  RvReal samprate;
+  int hopSize, fftSize;
+  const RvWindowInfo *window;
+  RvReal mvf;
+  // quasi-harmonic peak picking, f0 is re-estimated from the first maxAvgHarmonic peaks
+  int maxAvgHarmonic;
+  RvReal maxHarmonicOffset, peakSearchRange;
+  RvReal noiseEnvOrderFac, noiseEnergyThreshold;
+} RvHNMAnalyzerParameter;
+
+typedef struct RvHNMSynthesizerParameter
+{
+  RvReal samprate;
+  int hopSize;
+  RvReal mvf;
+} RvHNMSynthesizerParameter;
+
+// harmonic plus noise analysis of a whole signal with one f0 per hop, rvGetNFrame(nX, hopSize) in total, frames run on the shared thread pool
+// outputs per hop: refined f0, maxHar harmonics as frequency relative to (iHar + 1) * f0, amplitude and phase relative to the first harmonic,
+// energy of the resynthesized sinusoid, log noise envelope of fftSize / 2 + 1 bins and noise energy
+// rvHNMMaxHarmonic gives the maxHar that covers mvf for the lowest f0
+RV_EXPORT RvHNMAnalyzerParameter *rvCreateHNMAnalyzerParameter(RvReal sr);
+RV_EXPORT void rvDestroyHNMAnalyzerParameter(RvHNMAnalyzerParameter *param);
+RV_EXPORT int rvHNMMaxHarmonic(const RvHNMAnalyzerParameter *param, const RvReal *f0, int nHop);
+RV_EXPORT void rvCallHNMAnalyzer(const RvHNMAnalyzerParameter *param, const RvReal *x, int nX, const RvReal *f0, int maxHar, RvReal *refinedF0, RvReal *hFreq, RvReal *hAmp, RvReal *hPhase, RvReal *sinusoidEnergy, RvReal *noiseEnv, RvReal *noiseEnergy);
+
+// sinusoidal part of the analyzer output, out holds nHop * hopSize samples, hop iHop is centered at iHop * hopSize
+// an oscillator bank renders each hop to the next with linear amplitude and constant frequency per harmonic, reaching the phase of the next hop
+// harmonic phases follow the integrated f0 plus their relative phase, amplitudes are scaled to the sinusoid energy
+// the last hop is held for hopSize samples, hops run in parallel on the shared thread pool, see rthnm.h for the streaming variant
+RV_EXPORT RvHNMSynthesizerParameter *rvCreateHNMSynthesizerParameter(RvReal sr);
+RV_EXPORT void rvDestroyHNMSynthesizerParameter(RvHNMSynthesizerParameter *param);
+RV_EXPORT void rvCallHNMSynthesizer(const RvHNMSynthesizerParameter *param, const RvReal *f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, const RvReal *sinusoidEnergy, int nHop, int maxHar, RvReal *out);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -1,8 +1,198 @@
 #include "hmm_p.hpp"
 
 #include "./util_p.hpp"
+#include "threadpool_p.hpp"
 
-void rvHMMViterbiForwardRest(const RvSparseHMM *self, RvReal *oldDelta, RvReal *obs, RvReal *newDelta, int *psi)
+#include <cmath>
+#include <vector>
+
+using namespace ReVoice;
+
+template<typename T>static void viterbiForwardCompact(const RvSparseHMM &self, const RvReal *oldDelta, const RvReal *obs, RvReal *newDelta, T *psi)
+{
+  auto inBegin = self.inBegin;
+  auto inFrm = self.inFrm;
+  auto inProb = self.inProb;
+  int nState = self.nState;
+
+  for(int iState = 0; iState < nState; ++iState)
+  {
+    int begin = inBegin[iState];
+    int end = inBegin[iState + 1];
+    RvReal bestValue = 0.0;
+    int iBest = 0;
+    for(int i = begin; i < end; ++i)
+    {
+      RvReal v = oldDelta[inFrm[i]] * inProb[i];
+      if(v > bestValue)
+      {
+        bestValue = v;
+        iBest = i - begin;
+      }
+    }
+    newDelta[iState] = bestValue * obs[iState];
+    psi[iState] = static_cast<T>(iBest);
+  }
+}
+
+// predecessor of state on the best path into it at iFrame
+template<typename T>static inline int viterbiPredecessor(const RvSparseHMM &self, const T *psiList, int iFrame, int state)
+{
+  int rank = static_cast<int>(psiList[static_cast<size_t>(iFrame) * self.nState + state]);
+  return self.inBegin[state] == self.inBegin[state + 1] ? 0 : self.inFrm[self.inBegin[state] + rank];
+}
+
+// number of leading frames shared by the best paths into every state of the last frame
+// all survivors are traced back together until they meet
+template<typename T>static int viterbiSettledLength(const RvSparseHMM &self, const T *psiList, int nFrame)
+{
+  int nState = self.nState;
+  auto stateList = RVALLOC(int, nState);
+  auto prevStateList = RVALLOC(int, nState);
+  auto isPrevState = RVALLOC(bool, nState);
+  for(int i = 0; i < nState; ++i)
+    stateList[i] = i;
+  std::fill(isPrevState, isPrevState + nState, false);
+
+  int nSurvivor = nState;
+  int iFrame = nFrame - 1;
+  for(; iFrame > 0 && nSurvivor > 1; --iFrame)
+  {
+    int nPrev = 0;
+    for(int i = 0; i < nSurvivor; ++i)
+    {
+      int prevState = viterbiPredecessor(self, psiList, iFrame, stateList[i]);
+      if(!isPrevState[prevState])
+      {
+        isPrevState[prevState] = true;
+        prevStateList[nPrev++] = prevState;
+      }
+    }
+    for(int i = 0; i < nPrev; ++i)
+      isPrevState[prevStateList[i]] = false;
+    std::swap(stateList, prevStateList);
+    nSurvivor = nPrev;
+  }
+
+  rvFree(isPrevState);
+  rvFree(prevStateList);
+  rvFree(stateList);
+  return nSurvivor == 1 ? iFrame + 1 : 0;
+}
+
+template<typename T>static int viterbiDecodeCompact(const RvSparseHMM &self, const RvReal *obs, int nFrame, int *out, bool calcSettled)
+{
+  int nState = self.nState;
+  auto psiList = RVALLOC(T, static_cast<size_t>(nFrame) * static_cast<size_t>(nState));
+  auto oldDelta = RVALLOC(RvReal, nState);
+  auto delta = RVALLOC(RvReal, nState);
+
+  // init first frame
+  for(int i = 0; i < nState; ++i)
+    oldDelta[i] = self.init[i] * obs[i];
+  RvReal deltaSum = sum(oldDelta, nState);
+  if(deltaSum > 0.0)
+  {
+    for(int i = 0; i < nState; ++i)
+      oldDelta[i] /= deltaSum;
+  }
+  std::fill(psiList, psiList + nState, static_cast<T>(0));
+
+  // rest of forward step
+  for(int iFrame = 1; iFrame < nFrame; ++iFrame)
+  {
+    viterbiForwardCompact(self, oldDelta, obs + static_cast<size_t>(iFrame) * nState, delta, psiList + static_cast<size_t>(iFrame) * nState);
+    deltaSum = sum(delta, nState);
+    if(deltaSum > 0.0)
+    {
+      for(int i = 0; i < nState; ++i)
+        oldDelta[i] = delta[i] / deltaSum;
+    }
+    else
+    {
+      warning("WARNING: Viterbi decoder has been fed some zero probabilities at frame %d.", iFrame);
+      std::fill(oldDelta, oldDelta + nState, 1.0 / static_cast<RvReal>(nState));
+    }
+  }
+
+  // backward step, psi holds the rank of the best transition into each state
+  out[nFrame - 1] = argmax(oldDelta, nState);
+  for(int iFrame = nFrame - 2; iFrame >= 0; --iFrame)
+    out[iFrame] = viterbiPredecessor(self, psiList, iFrame + 1, out[iFrame + 1]);
+  int nSettled = calcSettled ? viterbiSettledLength(self, psiList, nFrame) : 0;
+
+  rvFree(delta);
+  rvFree(oldDelta);
+  rvFree(psiList);
+  return nSettled;
+}
+
+static int viterbiDecode(const RvSparseHMM &self, const RvReal *obs, int nFrame, int *out, bool calcSettled)
+{
+  switch(rvSparseHMMBackpointerSize(&self))
+  {
+  case 1:
+    return viterbiDecodeCompact<unsigned char>(self, obs, nFrame, out, calcSettled);
+  case 2:
+    return viterbiDecodeCompact<unsigned short>(self, obs, nFrame, out, calcSettled);
+  default:
+    return viterbiDecodeCompact<int>(self, obs, nFrame, out, calcSettled);
+  }
+}
+
+RvSparseHMM *rvCreateSparseHMM(const RvReal *init, const int *frm, const int *to, const RvReal *transProb, int nState, int nTrans)
+{
+  rvAssert(init, "init cannot be nullptr");
+  rvAssert(frm && to && transProb, "frm, to or transProb cannot be nullptr");
+  rvAssert(nState > 0, "nState must be greater than 0");
+  rvAssert(nTrans > 0, "nTrans must be greater than 0");
+  Arena measure;
+  layoutSparseHMM(measure, init, frm, to, transProb, nState, nTrans);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutSparseHMM(arena, init, frm, to, transProb, nState, nTrans);
+  self->refCount.store(1);
+  self->releaseHook = nullptr;
+  return self;
+}
+
+RvSparseHMM *rvRetainSparseHMM(RvSparseHMM *self)
+{
+  rvAssert(self, "sparseHMM cannot be nullptr");
+  self->refCount.fetch_add(1, std::memory_order_relaxed);
+  return self;
+}
+
+void rvReleaseSparseHMM(RvSparseHMM *self)
+{
+  rvAssert(self, "sparseHMM cannot be nullptr");
+  int oldCount = self->refCount.fetch_sub(1, std::memory_order_acq_rel);
+  rvAssert(oldCount > 0, "sparseHMM has already been released");
+  if(oldCount == 1)
+  {
+    if(self->releaseHook)
+      self->releaseHook(self);
+    self->~RvSparseHMM();
+    rvFree(self);
+  }
+}
+
+int rvSparseHMMNState(const RvSparseHMM *self)
+{ return self->nState; }
+
+int rvSparseHMMNTrans(const RvSparseHMM *self)
+{ return self->nTrans; }
+
+int rvSparseHMMBackpointerSize(const RvSparseHMM *self)
+{
+  if(self->maxInDegree <= 0x100)
+    return 1;
+  else if(self->maxInDegree <= 0x10000)
+    return 2;
+  else
+    return 4;
+}
+
+void rvHMMViterbiForwardRest(const RvSparseHMM *self, const RvReal *oldDelta, const RvReal *obs, RvReal *newDelta, int *psi)
 {
   auto fromState = self->frm;
   auto toState = self->to;
@@ -10,17 +200,15 @@ void rvHMMViterbiForwardRest(const RvSparseHMM *self, RvReal *oldDelta, RvReal *
   int nState = self->nState;
   int nTrans = self->nTrans;
 
-  auto currValue = self->transTemp;
-  for(int i = 0; i < nTrans; ++i)
-    currValue[i] = oldDelta[fromState[i]] * transProb[i];
   std::fill(newDelta, newDelta + nState, 0.0);
   std::fill(psi, psi + nState, 0);
   for(int iTrans = 0; iTrans < nTrans; ++iTrans)
   {
     int ts = toState[iTrans];
-    if(currValue[iTrans] > newDelta[ts])
+    RvReal currValue = oldDelta[fromState[iTrans]] * transProb[iTrans];
+    if(currValue > newDelta[ts])
     {
-      newDelta[ts] = currValue[iTrans];
+      newDelta[ts] = currValue;
       psi[ts] = fromState[iTrans];
     }
   }
@@ -29,15 +217,232 @@ void rvHMMViterbiForwardRest(const RvSparseHMM *self, RvReal *oldDelta, RvReal *
     newDelta[iState] *= obs[iState];
 }
 
+int rvHMMViterbiForwardBeam(const RvSparseHMM *self, const RvReal *oldDelta, const int *active, int nActive, const RvReal *obs, RvReal logBeam, RvReal *newDelta, int *psi, int *newActive)
+{
+  rvAssert(active || nActive == 0, "active cannot be nullptr with non-zero nActive");
+  auto outBegin = self->outBegin;
+  auto outTo = self->outTo;
+  auto outProb = self->outProb;
+  int nState = self->nState;
+
+  std::fill(newDelta, newDelta + nState, 0.0);
+  std::fill(psi, psi + nState, 0);
+  for(int iActive = 0; iActive < nActive; ++iActive)
+  {
+    int fs = active[iActive];
+    RvReal d = oldDelta[fs];
+    for(int i = outBegin[fs]; i < outBegin[fs + 1]; ++i)
+    {
+      int ts = outTo[i];
+      RvReal currValue = d * outProb[i];
+      if(currValue > newDelta[ts])
+      {
+        newDelta[ts] = currValue;
+        psi[ts] = fs;
+      }
+    }
+  }
+
+  for(int iState = 0; iState < nState; ++iState)
+    newDelta[iState] *= obs[iState];
+
+  return rvHMMPruneBeam(newDelta, nState, logBeam, newActive);
+}
+
+int rvHMMPruneBeam(RvReal *deltaIO, int nState, RvReal logBeam, int *active)
+{
+  rvAssert(deltaIO, "deltaIO cannot be nullptr");
+  rvAssert(active, "active cannot be nullptr");
+  RvReal threshold = max(deltaIO, nState) * std::exp(-logBeam);
+  int nActive = 0;
+  for(int iState = 0; iState < nState; ++iState)
+  {
+    if(deltaIO[iState] > 0.0 && deltaIO[iState] >= threshold)
+      active[nActive++] = iState;
+    else
+      deltaIO[iState] = 0.0;
+  }
+  return nActive;
+}
+
+void rvSparseHMMViterbiDecode(const RvSparseHMM *self, const RvReal *obs, int nFrame, int *out)
+{
+  rvAssert(self, "sparseHMM cannot be nullptr");
+  rvAssert(obs, "obs cannot be nullptr");
+  rvAssert(nFrame > 0, "nFrame must be greater than 0");
+  rvAssert(out, "out cannot be nullptr");
+
+  viterbiDecode(*self, obs, nFrame, out, false);
+}
+
 namespace ReVoice
 {
-  void ctorSparseHMM(RvSparseHMM &self, RvReal *init, int *frm, int *to, RvReal *transProb, int nState, int nTrans)
+  int sparseHMMViterbiDecodeSettled(const RvSparseHMM *self, const RvReal *obs, int nFrame, int *out)
+  {
+    rvAssert(nFrame > 0, "nFrame must be greater than 0");
+    return viterbiDecode(*self, obs, nFrame, out, true);
+  }
+} // namespace ReVoice
+
+void rvHMMForwardRest(const RvSparseHMM *self, const RvReal *oldAlpha, const RvReal *obs, RvReal *newAlpha)
+{
+  auto inBegin = self->inBegin;
+  auto inFrm = self->inFrm;
+  auto inProb = self->inProb;
+  int nState = self->nState;
+
+  for(int iState = 0; iState < nState; ++iState)
   {
-    self.init = RVALLOC(RvReal, nState);
-    self.frm = RVALLOC(int, nTrans);
-    self.to = RVALLOC(int, nTrans);
-    self.transProb = RVALLOC(RvReal, nTrans);
-    self.transTemp = RVALLOC(RvReal, nTrans);
+    RvReal s = 0.0;
+    for(int i = inBegin[iState]; i < inBegin[iState + 1]; ++i)
+      s += oldAlpha[inFrm[i]] * inProb[i];
+    newAlpha[iState] = s * obs[iState];
+  }
+}
+
+void rvHMMBackwardRest(const RvSparseHMM *self, const RvReal *nextBeta, const RvReal *nextObs, RvReal *beta, RvReal *temp)
+{
+  auto fromState = self->frm;
+  auto toState = self->to;
+  auto transProb = self->transProb;
+  int nState = self->nState;
+  int nTrans = self->nTrans;
+
+  for(int iState = 0; iState < nState; ++iState)
+    temp[iState] = nextBeta[iState] * nextObs[iState];
+  std::fill(beta, beta + nState, 0.0);
+  for(int iTrans = 0; iTrans < nTrans; ++iTrans)
+    beta[fromState[iTrans]] += transProb[iTrans] * temp[toState[iTrans]];
+}
+
+RvReal rvSparseHMMPosterior(const RvSparseHMM *self, const RvReal *obs, int nFrame, int nThread, RvReal *out)
+{
+  rvAssert(self, "sparseHMM cannot be nullptr");
+  rvAssert(obs, "obs cannot be nullptr");
+  rvAssert(nFrame > 0, "nFrame must be greater than 0");
+  rvAssert(out, "out cannot be nullptr");
+  int nState = self->nState;
+  size_t frameSize = static_cast<size_t>(nState);
+
+  auto betaList = RVALLOC(RvReal, nFrame * frameSize);
+  RvReal logLikelihood = 0.0;
+
+  // scaled forward pass, alpha is kept in out
+  auto forward = [&]()
+  {
+    for(int i = 0; i < nState; ++i)
+      out[i] = self->init[i] * obs[i];
+    logLikelihood = std::log(normalizeProb(out, nState));
+    for(int iFrame = 1; iFrame < nFrame; ++iFrame)
+    {
+      RvReal *alpha = out + iFrame * frameSize;
+      rvHMMForwardRest(self, alpha - frameSize, obs + iFrame * frameSize, alpha);
+      logLikelihood += std::log(normalizeProb(alpha, nState));
+    }
+  };
+
+  // scaled backward pass, every frame is normalized on its own
+  auto backward = [&]()
+  {
+    auto temp = RVALLOC(RvReal, nState);
+    RvReal *lastBeta = betaList + (nFrame - 1) * frameSize;
+    std::fill(lastBeta, lastBeta + nState, 1.0 / static_cast<RvReal>(nState));
+    for(int iFrame = nFrame - 2; iFrame >= 0; --iFrame)
+    {
+      RvReal *beta = betaList + iFrame * frameSize;
+      rvHMMBackwardRest(self, beta + frameSize, obs + (iFrame + 1) * frameSize, beta, temp);
+      normalizeProb(beta, nState);
+    }
+    rvFree(temp);
+  };
+
+  auto combine = [&](int iBegin, int iEnd)
+  {
+    for(int iFrame = iBegin; iFrame < iEnd; ++iFrame)
+    {
+      RvReal *gamma = out + iFrame * frameSize;
+      const RvReal *beta = betaList + iFrame * frameSize;
+      for(int i = 0; i < nState; ++i)
+        gamma[i] *= beta[i];
+      normalizeProb(gamma, nState);
+    }
+  };
+
+  if(nThread > 1)
+  {
+    RvThreadPool *pool = rvSharedThreadPool();
+    // a pool without helpers runs the whole range in one call
+    parallelFor(pool, 2, 1, [&](int iBegin, int iEnd)
+    {
+      for(int i = iBegin; i < iEnd; ++i)
+      {
+        if(i == 0)
+          forward();
+        else
+          backward();
+      }
+    });
+    int nChunk = std::min(nThread, nFrame);
+    parallelFor(pool, nFrame, (nFrame + nChunk - 1) / nChunk, combine);
+  }
+  else
+  {
+    forward();
+    backward();
+    combine(0, nFrame);
+  }
+
+  rvFree(betaList);
+  return logLikelihood;
+}
+
+namespace ReVoice
+{
+  RvReal normalizeProb(RvReal *xo, int n)
+  {
+    RvReal s = sum(xo, n);
+    if(s > 0.0)
+    {
+      for(int i = 0; i < n; ++i)
+        xo[i] /= s;
+    }
+    else
+      std::fill(xo, xo + n, 1.0 / static_cast<RvReal>(n));
+    return s;
+  }
+
+  bool retainSparseHMMIfAlive(RvSparseHMM *self)
+  {
+    int count = self->refCount.load(std::memory_order_relaxed);
+    while(count > 0)
+    {
+      if(self->refCount.compare_exchange_weak(count, count + 1, std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  RvSparseHMM *layoutSparseHMM(Arena &arena, const RvReal *init, const int *frm, const int *to, const RvReal *transProb, int nState, int nTrans)
+  {
+    auto pSelf = arena.construct<RvSparseHMM>();
+    auto initCopy = arena.take<RvReal>(nState);
+    auto frmCopy = arena.take<int>(nTrans);
+    auto toCopy = arena.take<int>(nTrans);
+    auto transProbCopy = arena.take<RvReal>(nTrans);
+    auto inBegin = arena.take<int>(nState + 1);
+    auto inFrm = arena.take<int>(nTrans);
+    auto inProb = arena.take<RvReal>(nTrans);
+    auto outBegin = arena.take<int>(nState + 1);
+    auto outTo = arena.take<int>(nTrans);
+    auto outProb = arena.take<RvReal>(nTrans);
+    if(arena.isMeasuring())
+      return nullptr;
+
+    auto &self = *pSelf;
+    self.init = initCopy;
+    self.frm = frmCopy;
+    self.to = toCopy;
+    self.transProb = transProbCopy;
 
     self.nState = nState;
     self.nTrans = nTrans;
@@ -46,14 +451,49 @@ namespace ReVoice
     std::copy(frm, frm + nTrans, self.frm);
     std::copy(to, to + nTrans, self.to);
     std::copy(transProb, transProb + nTrans, self.transProb);
-  }
 
-  void dtorSparseHMM(RvSparseHMM &self)
-  {
-    rvFree(self.init);
-    rvFree(self.frm);
-    rvFree(self.to);
-    rvFree(self.transProb);
-    rvFree(self.transTemp);
+    // stable counting sort by destination state
+    self.inBegin = inBegin;
+    self.inFrm = inFrm;
+    self.inProb = inProb;
+    std::fill(self.inBegin, self.inBegin + nState + 1, 0);
+    for(int i = 0; i < nTrans; ++i)
+    {
+      rvAssert(frm[i] >= 0 && frm[i] < nState && to[i] >= 0 && to[i] < nState, "transition state out of range");
+      ++self.inBegin[to[i] + 1];
+    }
+    self.maxInDegree = 0;
+    for(int i = 0; i < nState; ++i)
+    {
+      self.maxInDegree = std::max(self.maxInDegree, self.inBegin[i + 1]);
+      self.inBegin[i + 1] += self.inBegin[i];
+    }
+    auto fillPos = RVALLOC(int, nState);
+    std::copy(self.inBegin, self.inBegin + nState, fillPos);
+    for(int i = 0; i < nTrans; ++i)
+    {
+      int j = fillPos[to[i]]++;
+      self.inFrm[j] = frm[i];
+      self.inProb[j] = transProb[i];
+    }
+
+    // stable counting sort by source state
+    self.outBegin = outBegin;
+    self.outTo = outTo;
+    self.outProb = outProb;
+    std::fill(self.outBegin, self.outBegin + nState + 1, 0);
+    for(int i = 0; i < nTrans; ++i)
+      ++self.outBegin[frm[i] + 1];
+    for(int i = 0; i < nState; ++i)
+      self.outBegin[i + 1] += self.outBegin[i];
+    std::copy(self.outBegin, self.outBegin + nState, fillPos);
+    for(int i = 0; i < nTrans; ++i)
+    {
+      int j = fillPos[frm[i]]++;
+      self.outTo[j] = to[i];
+      self.outProb[j] = transProb[i];
+    }
+    rvFree(fillPos);
+    return pSelf;
   }
 } // namespace ReVoice
\ No newline at end of file
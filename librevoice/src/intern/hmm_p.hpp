@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../hmm.h"
+#include "util_p.hpp"
+
+#include <atomic>
 
 typedef struct RvSparseHMM
 {
@@ -9,11 +12,33 @@ typedef struct RvSparseHMM
   RvReal *transProb;
   int nState, nTrans;
 
-  RvReal *transTemp;
+  // transitions grouped by destination state, in original order
+  int *inBegin, *inFrm;
+  RvReal *inProb;
+  int maxInDegree;
+
+  // transitions grouped by source state, in original order
+  int *outBegin, *outTo;
+  RvReal *outProb;
+
+  // immutable after construction, shared between decoders by reference count
+  std::atomic<int> refCount;
+
+  // called once the last reference is released, right before destruction
+  void (*releaseHook)(RvSparseHMM *self);
 } RvSparseHMM;
 
 namespace ReVoice
 {
-  void ctorSparseHMM(RvSparseHMM &self, RvReal *init, int *frm, int *to, RvReal *transProb, int nState, int nTrans);
-  void dtorSparseHMM(RvSparseHMM &self);
+  // places the model and its tables in arena, see Arena
+  RvSparseHMM *layoutSparseHMM(Arena &arena, const RvReal *init, const int *frm, const int *to, const RvReal *transProb, int nState, int nTrans);
+
+  // for weak references: takes a new reference unless the model is already being destroyed
+  bool retainSparseHMMIfAlive(RvSparseHMM *self);
+
+  // rvSparseHMMViterbiDecode that also returns how many leading frames of out the best paths into all final states share
+  // later frames cannot change those, see pitchtracker.cpp
+  int sparseHMMViterbiDecodeSettled(const RvSparseHMM *self, const RvReal *obs, int nFrame, int *out);
+
+  RvReal normalizeProb(RvReal *xo, int n);
 } // namespace ReVoice
\ No newline at end of file
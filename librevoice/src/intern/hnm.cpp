@@ -0,0 +1,547 @@
+#define _USE_MATH_DEFINES
+#include "../hnm.h"
+
+#include "util_p.hpp"
+#include "threadpool_p.hpp"
+#include "stage_p.hpp"
+#include <cmath>
+#include <limits>
+
+using namespace ReVoice;
+
+namespace
+{
+  // the hanning windows of the energy analysis have a mean square of 0.375
+  const RvReal energyNormFac = 1.0 / std::sqrt(0.375);
+  // envelope f0 of unvoiced hops
+  const RvReal noiseEnvUnvoicedF0 = 240.0;
+
+  // scratch of one parallel chunk
+  struct FrameWorker
+  {
+    RvRFFT *rfft;
+    RvIRFFT *irfft;
+    RvReal *window, *frame, *buffer, *magn, *phase;
+    RvComplex *spectrum;
+    // sized by f0, grown on demand
+    RvReal *synthBuffer, *energyWindow;
+    int synthCapacity, energyCapacity;
+  };
+} // namespace
+
+static FrameWorker createFrameWorker(int fftSize)
+{
+  FrameWorker worker;
+  int nBin = fftSize / 2 + 1;
+  worker.rfft = rvCreateRFFT(fftSize);
+  worker.irfft = rvCreateIRFFT(fftSize);
+  worker.window = RVALLOC(RvReal, fftSize);
+  worker.frame = RVALLOC(RvReal, fftSize);
+  worker.buffer = RVALLOC(RvReal, fftSize);
+  worker.magn = RVALLOC(RvReal, nBin);
+  worker.phase = RVALLOC(RvReal, nBin);
+  worker.spectrum = RVALLOC(RvComplex, nBin);
+  worker.synthBuffer = nullptr;
+  worker.energyWindow = nullptr;
+  worker.synthCapacity = worker.energyCapacity = 0;
+  return worker;
+}
+
+static void destroyFrameWorker(FrameWorker &worker)
+{
+  rvDestroyRFFT(worker.rfft);
+  rvDestroyIRFFT(worker.irfft);
+  rvFree(worker.window);
+  rvFree(worker.frame);
+  rvFree(worker.buffer);
+  rvFree(worker.magn);
+  rvFree(worker.phase);
+  rvFree(worker.spectrum);
+  if(worker.synthBuffer)
+    rvFree(worker.synthBuffer);
+  if(worker.energyWindow)
+    rvFree(worker.energyWindow);
+}
+
+static RvReal *reserve(RvReal *&buffer, int &capacity, int n)
+{
+  if(n > capacity)
+  {
+    if(buffer)
+      rvFree(buffer);
+    buffer = RVALLOC(RvReal, n);
+    capacity = n;
+  }
+  return buffer;
+}
+
+static RvReal wrapPhase(RvReal phase)
+{
+  RvReal out = phase - std::nearbyint(phase / (2.0 * M_PI)) * 2.0 * M_PI;
+  if(out > M_PI)
+    out -= 2.0 * M_PI;
+  else if(out < -M_PI)
+    out += 2.0 * M_PI;
+  return out;
+}
+
+// out[i] = sum of amp * cos(2 * pi * freq / sr * (begin + i) + phase), harmonics end at the first one outside (0, nyq)
+// each harmonic is a rotating phasor instead of a cos per sample
+static void synthSinusoid(const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, int nHar, int begin, int n, RvReal sr, RvReal *out)
+{
+  std::fill(out, out + n, 0.0);
+  for(int iHar = 0; iHar < nHar; ++iHar)
+  {
+    if(hFreq[iHar] <= 0.0 || hFreq[iHar] >= sr / 2.0)
+      break;
+    if(hAmp[iHar] <= 0.0)
+      continue;
+    RvReal omega = 2.0 * M_PI / sr * hFreq[iHar];
+    RvComplex z = std::polar(hAmp[iHar], omega * begin + hPhase[iHar]);
+    RvComplex step = std::polar(1.0, omega);
+    for(int i = 0; i < n; ++i)
+    {
+      out[i] += z.real();
+      z *= step;
+    }
+  }
+}
+
+// mean square of the frame under a hanning window of the same size
+static RvReal windowedEnergy(FrameWorker &worker, const RvReal *frame, int n)
+{
+  auto window = reserve(worker.energyWindow, worker.energyCapacity, n);
+  rvHanning(n, window);
+  RvReal energy = 0.0;
+  for(int i = 0; i < n; ++i)
+  {
+    RvReal v = frame[i] * window[i] * energyNormFac;
+    energy += v * v;
+  }
+  return energy / static_cast<RvReal>(n);
+}
+
+// about B periods on each side for voiced hops, 2 hops otherwise
+static int frameWindowSize(const RvHNMAnalyzerParameter *param, RvReal f0)
+{
+  if(f0 <= 0.0)
+    return 2 * param->hopSize;
+  int windowSize = static_cast<int>(std::min(static_cast<RvReal>(param->fftSize), std::ceil(param->samprate / f0) * param->window->B * 2.0));
+  return windowSize + windowSize % 2;
+}
+
+// spectrum of the windowed frame around center with its mean removed, zero phase at the center
+// returns the factor that turns the magnitude into amplitude
+static RvReal transformFrame(FrameWorker &worker, const RvHNMAnalyzerParameter *param, const RvReal *x, int nX, int center, RvReal f0)
+{
+  int windowSize = frameWindowSize(param, f0);
+  rvGetFrame(x, nX, center, windowSize, worker.frame);
+  param->window->func(windowSize, worker.window);
+  for(int i = 0; i < windowSize; ++i)
+    worker.frame[i] *= worker.window[i];
+  rvSimpleDCRemove(worker.frame, windowSize);
+  rvZeroPad(worker.frame, windowSize, worker.buffer, param->fftSize);
+  rvDoRFFT(worker.rfft, worker.buffer, worker.spectrum);
+  // the frame has zero mean, the sign of the rounding noise left at dc would offset the unwrapped phase by 2 * pi
+  worker.spectrum[0] = 0.0;
+  return 2.0 / (param->window->mean * windowSize);
+}
+
+// same as numpy.unwrap
+static void unwrapPhase(const RvComplex *spectrum, int n, RvReal *phase)
+{
+  RvReal correction = 0.0;
+  RvReal prev = std::arg(spectrum[0]);
+  phase[0] = prev;
+  for(int i = 1; i < n; ++i)
+  {
+    RvReal curr = std::arg(spectrum[i]);
+    RvReal dd = curr - prev;
+    RvReal ddMod = std::fmod(dd + M_PI, 2.0 * M_PI);
+    if(ddMod < 0.0)
+      ddMod += 2.0 * M_PI;
+    ddMod -= M_PI;
+    if(ddMod == -M_PI && dd > 0.0)
+      ddMod = M_PI;
+    if(std::abs(dd) >= M_PI)
+      correction += ddMod - dd;
+    phase[i] = curr + correction;
+    prev = curr;
+  }
+}
+
+// f0 from the phase advance of the strongest bin near f0 over one sample, f0 itself when that is implausible
+// worker.magn holds the amplitude spectrum of the frame at center
+static RvReal refineF0(FrameWorker &worker, const RvHNMAnalyzerParameter *param, const RvReal *x, int nX, int center, RvReal f0)
+{
+  RvReal sr = param->samprate;
+  int fftSize = param->fftSize;
+  int lowerIdx = std::max(0, static_cast<int>(std::floor(f0 * fftSize / sr * (1.0 - param->peakSearchRange))));
+  int upperIdx = std::min(fftSize / 2, static_cast<int>(std::floor(f0 * fftSize / sr * (1.0 + param->peakSearchRange))));
+  if(upperIdx <= lowerIdx)
+    return f0;
+  int peakIdx = lowerIdx + argmax(worker.magn + lowerIdx, upperIdx - lowerIdx);
+  RvReal phase = worker.phase[peakIdx];
+
+  transformFrame(worker, param, x, nX, center - 1, f0);
+  RvReal deltaPhase = std::arg(worker.spectrum[peakIdx]);
+
+  phase -= std::floor(phase / 2.0 / M_PI) * 2.0 * M_PI;
+  deltaPhase -= std::floor(deltaPhase / 2.0 / M_PI) * 2.0 * M_PI;
+  if(phase < deltaPhase)
+    phase += 2.0 * M_PI;
+  RvReal refinedF0 = (phase - deltaPhase) / 2.0 / M_PI * sr;
+  if(std::abs(refinedF0 - f0) / f0 > 0.08 || std::abs(refinedF0 / sr * fftSize - peakIdx) > 1.0)
+    return f0;
+  return refinedF0;
+}
+
+// highest local maximum in (lowerIdx, upperIdx - 1), highest bin in [lowerIdx, upperIdx) without one
+static int findPeak(const RvReal *magn, int lowerIdx, int upperIdx)
+{
+  if(lowerIdx >= upperIdx)
+    return lowerIdx;
+  int iPeak = -1;
+  for(int i = lowerIdx + 1; i < upperIdx - 1; ++i)
+  {
+    if(magn[i] > magn[i - 1] && magn[i] > magn[i + 1] && (iPeak < 0 || magn[i] > magn[iPeak]))
+      iPeak = i;
+  }
+  if(iPeak < 0)
+    iPeak = lowerIdx + argmax(magn + lowerIdx, upperIdx - lowerIdx);
+  return iPeak;
+}
+
+static void pickHarmonic(const RvHNMAnalyzerParameter *param, const RvReal *magn, const RvReal *phase, RvReal freq, RvReal offset, RvReal *outFreq, RvReal *outAmp, RvReal *outPhase)
+{
+  RvReal sr = param->samprate;
+  int fftSize = param->fftSize;
+  int nBin = fftSize / 2 + 1;
+  int lowerIdx = std::max(0, static_cast<int>(std::floor((freq - offset) / sr * fftSize)));
+  int upperIdx = std::min(nBin - 1, static_cast<int>(std::ceil((freq + offset) / sr * fftSize)));
+  int peakBin = findPeak(magn, lowerIdx, upperIdx);
+  auto ipled = rvParabolicInterp(magn, nBin, peakBin, false);
+  *outFreq = ipled.x * sr / fftSize;
+  *outAmp = ipled.y;
+  *outPhase = lerp(phase[peakBin], phase[std::min(peakBin + 1, nBin - 1)], ipled.x - std::floor(ipled.x));
+}
+
+// peaks near multiples of f0 in the log magnitude, f0 is re-estimated from the lower ones until it stops moving
+// returns the frequency of the first harmonic, hAmp is log amplitude and -inf for missing harmonics
+static RvReal findHarmonic(const RvHNMAnalyzerParameter *param, RvReal f0, const RvReal *magn, const RvReal *phase, int maxHar, RvReal *hFreq, RvReal *hAmp, RvReal *hPhase)
+{
+  std::fill(hFreq, hFreq + maxHar, 0.0);
+  std::fill(hAmp, hAmp + maxHar, -std::numeric_limits<RvReal>::infinity());
+  std::fill(hPhase, hPhase + maxHar, 0.0);
+
+  RvReal oldF0 = 0.0, offset = 0.0;
+  int nHar = 0, nAvgHar = 0;
+  for(int iIter = 0; iIter < 17 && oldF0 != f0; ++iIter)
+  {
+    nHar = std::min(maxHar, static_cast<int>(param->mvf / f0));
+    nAvgHar = std::min(param->maxAvgHarmonic, nHar);
+    if(nAvgHar <= 0)
+      break;
+    offset = f0 * param->maxHarmonicOffset;
+    for(int iHar = 1; iHar <= nAvgHar; ++iHar)
+    {
+      RvReal freq = iHar * f0;
+      if(freq >= param->mvf)
+        break;
+      pickHarmonic(param, magn, phase, freq, offset, hFreq + iHar - 1, hAmp + iHar - 1, hPhase + iHar - 1);
+    }
+    oldF0 = f0;
+    f0 = 0.0;
+    for(int iHar = 1; iHar <= nAvgHar; ++iHar)
+      f0 += hFreq[iHar - 1] / iHar;
+    f0 /= nAvgHar;
+  }
+  for(int iHar = nAvgHar + 1; iHar < nHar; ++iHar)
+  {
+    RvReal freq = iHar * f0;
+    if(freq >= param->mvf)
+      break;
+    pickHarmonic(param, magn, phase, freq, offset, hFreq + iHar - 1, hAmp + iHar - 1, hPhase + iHar - 1);
+  }
+  return hFreq[0];
+}
+
+// smoothed log envelope of an amplitude spectrum, overwrites magn
+static void calcCheapTrick(FrameWorker &worker, RvReal *magn, RvReal f0, RvReal sr, int order, RvReal *out)
+{
+  int fftSize = rvGetRFFTSize(worker.rfft);
+  int nBin = fftSize / 2 + 1;
+
+  // mirror the bins below f0 / 2 around it
+  int iF0 = static_cast<int>(std::nearbyint(f0 / sr * fftSize));
+  for(int i = 0; i < iF0 / 2 && iF0 - 1 - i < nBin; ++i)
+    magn[i] = magn[iF0 - 1 - i];
+
+  // moving average of order bins, centered like scipy's fftconvolve mode 'full' cut at order / 2
+  RvReal orderFac = 1.0 / order;
+  for(int i = 0; i < nBin; ++i)
+  {
+    int begin = std::max(0, i + order / 2 - order + 1);
+    int end = std::min(nBin, i + order / 2 + 1);
+    RvReal v = 0.0;
+    for(int j = begin; j < end; ++j)
+      v += magn[j] * orderFac;
+    worker.spectrum[i] = std::log(std::max(v, 1e-6));
+  }
+
+  // lifter the cepstrum
+  rvDoIRFFT(worker.irfft, worker.spectrum, worker.buffer);
+  RvReal a = f0 / sr * M_PI;
+  RvReal b = 2.0 * M_PI * f0 / sr;
+  for(int i = 1; i < nBin; ++i)
+    worker.buffer[i] *= std::sin(a * i) / (a * i) * (1.18 - 2.0 * 0.09 * std::cos(b * i));
+  for(int i = nBin; i < fftSize; ++i)
+    worker.buffer[i] = worker.buffer[fftSize - i];
+  rvDoRFFT(worker.rfft, worker.buffer, worker.spectrum);
+  for(int i = 0; i < nBin; ++i)
+    out[i] = worker.spectrum[i].real();
+}
+
+RvHNMAnalyzerParameter *rvCreateHNMAnalyzerParameter(RvReal sr)
+{
+  rvAssert(sr > 0, "sr must be greater than 0");
+  auto param = new RvHNMAnalyzerParameter;
+  param->samprate = sr;
+  param->hopSize = static_cast<int>(roundUpToPowerOf2(sr * 0.0025));
+  param->fftSize = static_cast<int>(roundUpToPowerOf2(sr * 0.05));
+  param->window = rvGetWindow("blackman");
+  param->mvf = std::min(sr / 2.0 - 1e3, 20e3);
+  param->maxAvgHarmonic = 8;
+  param->maxHarmonicOffset = 0.125;
+  param->peakSearchRange = 0.3;
+  param->noiseEnvOrderFac = 1.0;
+  param->noiseEnergyThreshold = 1e-8;
+  return param;
+}
+
+void rvDestroyHNMAnalyzerParameter(RvHNMAnalyzerParameter *param)
+{
+  rvAssert(param, "param cannot be nullptr");
+  delete param;
+}
+
+int rvHNMMaxHarmonic(const RvHNMAnalyzerParameter *param, const RvReal *f0, int nHop)
+{
+  rvAssert(param, "param cannot be nullptr");
+  rvAssert(f0 || nHop == 0, "f0 cannot be nullptr");
+  rvAssert(nHop >= 0, "nHop cannot be less than 0");
+  RvReal minF0 = 0.0;
+  for(int iHop = 0; iHop < nHop; ++iHop)
+  {
+    if(f0[iHop] > 0.0 && (minF0 <= 0.0 || f0[iHop] < minF0))
+      minF0 = f0[iHop];
+  }
+  return minF0 > 0.0 ? static_cast<int>(param->mvf / minF0) : 0;
+}
+
+void rvCallHNMAnalyzer(const RvHNMAnalyzerParameter *param, const RvReal *x, int nX, const RvReal *f0, int maxHar, RvReal *refinedF0, RvReal *hFreq, RvReal *hAmp, RvReal *hPhase, RvReal *sinusoidEnergy, RvReal *noiseEnv, RvReal *noiseEnergy)
+{
+  rvAssert(param, "param cannot be nullptr");
+  rvAssert(x, "x cannot be nullptr");
+  rvAssert(nX > 0, "nX must be greater than 0");
+  rvAssert(f0, "f0 cannot be nullptr");
+  rvAssert(maxHar >= 0, "maxHar cannot be less than 0");
+  rvAssert(refinedF0 && sinusoidEnergy && noiseEnv && noiseEnergy, "outputs cannot be nullptr");
+  rvAssert(maxHar == 0 || (hFreq && hAmp && hPhase), "outputs cannot be nullptr");
+  rvAssert(param->window, "window cannot be nullptr");
+  rvAssert(param->mvf > 0.0 && param->mvf <= param->samprate / 2.0, "mvf must be in range (0, samprate / 2]");
+  rvAssert(param->hopSize > 0, "hopSize must be greater than 0");
+  rvAssert(param->fftSize >= param->hopSize * 2, "fftSize cannot be less than 2 * hopSize");
+
+  RvReal sr = param->samprate;
+  int hopSize = param->hopSize;
+  int fftSize = param->fftSize;
+  int nBin = fftSize / 2 + 1;
+  int nHop = rvGetNFrame(nX, hopSize);
+  auto pool = rvSharedThreadPool();
+
+  auto px = RVALLOC(RvReal, nX);
+  std::copy(x, x + nX, px);
+  rvSimpleDCRemove(px, nX);
+
+  // quasi-harmonic analysis of voiced hops, then the windowed resynthesis around every hop for overlap-add
+  auto olaList = RVALLOC(RvReal, static_cast<size_t>(nHop) * hopSize * 2);
+  parallelFor(pool, nHop, 16, [&](int iBegin, int iEnd)
+  {
+    auto worker = createFrameWorker(fftSize);
+    auto olaWindow = RVALLOC(RvReal, hopSize * 2);
+    rvHanning(hopSize * 2, olaWindow);
+    for(int iHop = iBegin; iHop < iEnd; ++iHop)
+    {
+      auto hopFreq = hFreq + static_cast<size_t>(iHop) * maxHar;
+      auto hopAmp = hAmp + static_cast<size_t>(iHop) * maxHar;
+      auto hopPhase = hPhase + static_cast<size_t>(iHop) * maxHar;
+      auto ola = olaList + static_cast<size_t>(iHop) * hopSize * 2;
+      std::fill(ola, ola + hopSize * 2, 0.0);
+      refinedF0[iHop] = 0.0;
+      sinusoidEnergy[iHop] = 0.0;
+      if(maxHar > 0)
+      {
+        std::fill(hopFreq, hopFreq + maxHar, 0.0);
+        std::fill(hopAmp, hopAmp + maxHar, 0.0);
+        std::fill(hopPhase, hopPhase + maxHar, 0.0);
+      }
+      if(f0[iHop] <= 0.0 || maxHar == 0)
+        continue;
+
+      RvReal magnFac = transformFrame(worker, param, px, nX, iHop * hopSize, f0[iHop]);
+      for(int i = 0; i < nBin; ++i)
+        worker.magn[i] = std::abs(worker.spectrum[i]) * magnFac;
+      unwrapPhase(worker.spectrum, nBin, worker.phase);
+      RvReal hopF0 = refineF0(worker, param, px, nX, iHop * hopSize, f0[iHop]);
+      worker.magn[0] = 0.0;
+      for(int i = 0; i < nBin; ++i)
+        worker.magn[i] = std::log(std::max(worker.magn[i], 1e-8));
+      hopF0 = findHarmonic(param, hopF0, worker.magn, worker.phase, maxHar, hopFreq, hopAmp, hopPhase);
+      for(int iHar = 0; iHar < maxHar; ++iHar)
+        hopAmp[iHar] = std::exp(hopAmp[iHar]);
+      refinedF0[iHop] = hopF0;
+      if(hopF0 <= 0.0)
+        continue;
+
+      int radius = static_cast<int>(std::nearbyint(sr / hopF0)) * 2;
+      int synthLeft = std::max(radius, hopSize);
+      int synthRight = std::max(radius + 1, hopSize);
+      auto synthed = reserve(worker.synthBuffer, worker.synthCapacity, synthLeft + synthRight);
+      synthSinusoid(hopFreq, hopAmp, hopPhase, maxHar, -synthLeft, synthLeft + synthRight, sr, synthed);
+      sinusoidEnergy[iHop] = windowedEnergy(worker, synthed + synthLeft - radius, radius * 2 + 1);
+      for(int i = 0; i < hopSize * 2; ++i)
+        ola[i] = synthed[synthLeft - hopSize + i] * olaWindow[i];
+    }
+    rvFree(olaWindow);
+    destroyFrameWorker(worker);
+  });
+
+  // hop iHop covers [(iHop - 1) * hopSize, (iHop + 1) * hopSize), every block of hopSize samples sums two of them
+  auto noise = RVALLOC(RvReal, nX);
+  parallelFor(pool, nHop, 256, [&](int iBegin, int iEnd)
+  {
+    for(int iHop = iBegin; iHop < iEnd; ++iHop)
+    {
+      auto curr = olaList + static_cast<size_t>(iHop) * hopSize * 2 + hopSize;
+      auto next = iHop + 1 < nHop ? olaList + static_cast<size_t>(iHop + 1) * hopSize * 2 : nullptr;
+      int end = std::min(hopSize, nX - iHop * hopSize);
+      for(int i = 0; i < end; ++i)
+        noise[iHop * hopSize + i] = px[iHop * hopSize + i] - curr[i] - (next ? next[i] : 0.0);
+    }
+  });
+  rvFree(olaList);
+  rvFree(px);
+
+  // noise envelope and energy, harmonics relative to f0 and the phase of the first one
+  parallelFor(pool, nHop, 16, [&](int iBegin, int iEnd)
+  {
+    auto worker = createFrameWorker(fftSize);
+    for(int iHop = iBegin; iHop < iEnd; ++iHop)
+    {
+      RvReal hopF0 = refinedF0[iHop];
+      RvReal magnFac = transformFrame(worker, param, noise, nX, iHop * hopSize, hopF0);
+      for(int i = 0; i < nBin; ++i)
+        worker.magn[i] = std::abs(worker.spectrum[i]) * magnFac;
+      RvReal envF0 = hopF0 > 0.0 ? hopF0 : noiseEnvUnvoicedF0;
+      int order = static_cast<int>(std::ceil(envF0 / sr * fftSize / 3.0) * param->noiseEnvOrderFac);
+      calcCheapTrick(worker, worker.magn, envF0, sr, std::max(1, order), noiseEnv + static_cast<size_t>(iHop) * nBin);
+
+      int energySize = hopF0 > 0.0 ? 4 * static_cast<int>(std::nearbyint(sr / hopF0)) + 1 : 2 * hopSize;
+      auto frame = reserve(worker.synthBuffer, worker.synthCapacity, energySize);
+      rvGetFrame(noise, nX, iHop * hopSize, energySize, frame);
+      noiseEnergy[iHop] = windowedEnergy(worker, frame, energySize);
+      if(noiseEnergy[iHop] < param->noiseEnergyThreshold)
+        noiseEnergy[iHop] = 0.0;
+
+      auto hopFreq = hFreq + static_cast<size_t>(iHop) * maxHar;
+      auto hopPhase = hPhase + static_cast<size_t>(iHop) * maxHar;
+      if(hopF0 > 0.0)
+      {
+        RvReal basePhase = hopPhase[0];
+        for(int iHar = 0; iHar < maxHar; ++iHar)
+        {
+          hopPhase[iHar] = wrapPhase(hopPhase[iHar] - hopFreq[iHar] / hopF0 * basePhase);
+          hopFreq[iHar] /= hopF0 * (iHar + 1);
+        }
+      }
+      for(int iHar = 0; iHar < maxHar; ++iHar)
+      {
+        if(hopFreq[iHar] <= 0.0)
+          hopFreq[iHar] = 1.0;
+      }
+    }
+    destroyFrameWorker(worker);
+  });
+  rvFree(noise);
+}
+
+RvHNMSynthesizerParameter *rvCreateHNMSynthesizerParameter(RvReal sr)
+{
+  rvAssert(sr > 0, "sr must be greater than 0");
+  auto param = new RvHNMSynthesizerParameter;
+  param->samprate = sr;
+  param->hopSize = static_cast<int>(roundUpToPowerOf2(sr * 0.0025));
+  param->mvf = std::min(sr / 2.0 - 1e3, 20e3);
+  return param;
+}
+
+void rvDestroyHNMSynthesizerParameter(RvHNMSynthesizerParameter *param)
+{
+  rvAssert(param, "param cannot be nullptr");
+  delete param;
+}
+
+void rvCallHNMSynthesizer(const RvHNMSynthesizerParameter *param, const RvReal *f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, const RvReal *sinusoidEnergy, int nHop, int maxHar, RvReal *out)
+{
+  rvAssert(param, "param cannot be nullptr");
+  rvAssert(param->samprate > 0.0, "samprate must be greater than 0");
+  rvAssert(param->hopSize > 0, "hopSize must be greater than 0");
+  rvAssert(nHop >= 0, "nHop cannot be less than 0");
+  rvAssert(maxHar >= 0, "maxHar cannot be less than 0");
+  rvAssert(nHop == 0 || (f0 && sinusoidEnergy && out), "f0, sinusoidEnergy and out cannot be nullptr");
+  rvAssert(nHop == 0 || maxHar == 0 || (hFreq && hAmp && hPhase), "hFreq, hAmp and hPhase cannot be nullptr");
+  if(nHop == 0)
+    return;
+  int hopSize = param->hopSize;
+
+  // the integrated f0 is the only state carried from hop to hop, with it every hop renders on its own
+  auto basePhase = RVALLOC(RvReal, nHop);
+  basePhase[0] = 0.0;
+  for(int iHop = 1; iHop < nHop; ++iHop)
+    basePhase[iHop] = hnmNextBasePhase(param, basePhase[iHop - 1], f0[iHop - 1], f0[iHop]);
+
+  parallelFor(rvSharedThreadPool(), nHop, 64, [&](int iBegin, int iEnd)
+  {
+    int nHar = std::max(1, maxHar);
+    auto hopList = RVALLOC(RvReal, nHar * 6);
+    auto scratch = RVALLOC(RvReal, hnmSegmentScratchSize(param, maxHar));
+    RvReal *freq = hopList, *amp = freq + nHar, *phase = amp + nHar;
+    RvReal *nextFreq = phase + nHar, *nextAmp = nextFreq + nHar, *nextPhase = nextAmp + nHar;
+    auto hopHarmonic = [&](int iHop, RvReal *outFreq, RvReal *outAmp, RvReal *outPhase)
+    {
+      size_t offset = static_cast<size_t>(iHop) * maxHar;
+      hnmHopHarmonic(param, maxHar, f0[iHop], hFreq + offset, hAmp + offset, hPhase + offset, sinusoidEnergy[iHop], basePhase[iHop], outFreq, outAmp, outPhase);
+    };
+
+    hopHarmonic(iBegin, freq, amp, phase);
+    for(int iHop = iBegin; iHop < iEnd; ++iHop)
+    {
+      if(iHop + 1 < nHop)
+        hopHarmonic(iHop + 1, nextFreq, nextAmp, nextPhase);
+      else
+      {
+        std::copy(freq, freq + maxHar, nextFreq);
+        std::copy(amp, amp + maxHar, nextAmp);
+        hnmHoldHop(param, maxHar, phase, freq, nextPhase);
+      }
+      hnmRenderSegment(param, maxHar, freq, amp, phase, nextFreq, nextAmp, nextPhase, scratch, out + static_cast<size_t>(iHop) * hopSize);
+      std::swap(freq, nextFreq);
+      std::swap(amp, nextAmp);
+      std::swap(phase, nextPhase);
+    }
+    rvFree(scratch);
+    rvFree(hopList);
+  });
+  rvFree(basePhase);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "util_p.hpp"
+#include "../yin.h"
+#include "../rtfilter.h"
+#include "../rtenergy.h"
+#include "../rthmm.h"
+#include "../rtpyin.h"
+#include "../rtmonopitch.h"
+#include "../rthnm.h"
+
+// objects that can live inside the block of their owner
+// each layout function measures while the arena is measuring and returns nullptr, otherwise it places and initializes the object
+// the owner still calls the matching rvDestroy*, which releases held references but leaves the memory to the block
+namespace ReVoice
+{
+  RvRFFT *layoutRFFT(Arena &arena, int fftSize);
+  RvIRFFT *layoutIRFFT(Arena &arena, int fftSize);
+  RvFFTConvolver *layoutFFTConvolver(Arena &arena, int maxSize);
+  RvYinDifferenceWorker *layoutYinDifferenceWorker(Arena &arena, int maxNX);
+  // with kernel == nullptr the kernel is left zeroed for the owner to write through rtFilterKernel
+  RvRTFilter *layoutRTFilter(Arena &arena, const RvReal *kernel, int kernelSize, int maxNX);
+  RvReal *rtFilterKernel(RvRTFilter *filter);
+  RvRTEnergyTracker *layoutRTEnergyTracker(Arena &arena, int hopSize, int nWindowHop, RvReal silentThreshold, RvReal voicedThreshold);
+  RvRTSparseHMM *layoutRTSparseHMM(Arena &arena, RvSparseHMM *model, int nMaxBackward);
+  RvRTPYinProcessor *layoutRTPYinProcessor(Arena &arena, const RvRTPYinProcessorParameter *param);
+  // model comes from acquireMonoPitchModel, the caller keeps it referenced over both passes
+  RvRTMonoPitchProcessor *layoutRTMonoPitchProcessor(Arena &arena, const RvRTMonoPitchProcessorParameter *param, RvSparseHMM *model);
+  RvRTHNMSynthesizer *layoutRTHNMSynthesizer(Arena &arena, const RvHNMSynthesizerParameter *param, int maxHar);
+} // namespace ReVoice
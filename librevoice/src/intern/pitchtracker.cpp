@@ -0,0 +1,314 @@
+#include "../pitchtracker.h"
+
+#include "util_p.hpp"
+#include "../rtenergy.h"
+#include "hmm_p.hpp"
+#include "threadpool_p.hpp"
+#include "stage_p.hpp"
+#include <initializer_list>
+
+using namespace ReVoice;
+
+namespace
+{
+  struct Chunk
+  {
+    // hops [coreBegin, coreEnd) are decoded as part of [decodeBegin, decodeEnd)
+    int coreBegin, coreEnd;
+    int decodeBegin, decodeEnd;
+    // hops before decodeBegin + nSettled are on the best path into every final state
+    int *path, nSettled;
+    // decoded hop i has candidateCount[i] (freq, prob) pairs at candidateList + candidateOffset[i]
+    RvReal *candidateList;
+    int *candidateOffset, *candidateCount;
+  };
+
+  // hops before leftEnd come from the left path, hops from rightBegin on from the right one, the rest is bridged
+  struct Join
+  {
+    int leftEnd, rightBegin;
+  };
+
+  struct Context
+  {
+    const RvRTPYinProcessorParameter *pyinParam;
+    const RvRTMonoPitchProcessor *monoPitchProc;
+    const RvSparseHMM *model;
+    const RvReal *x;
+    int nX, nFrame;
+  };
+} // namespace
+
+// candidates of hop iFrame, which must be decoded by chunk
+static const RvReal *chunkCandidate(const Chunk &chunk, int iFrame, int *nCandidate)
+{
+  int i = iFrame - chunk.decodeBegin;
+  *nCandidate = chunk.candidateCount[i];
+  return chunk.candidateList + chunk.candidateOffset[i];
+}
+
+// pyin from a few hops before the chunk, then viterbi over the chunk
+static void analyzeChunk(const Context &ctx, Chunk &chunk)
+{
+  int hopSize = ctx.pyinParam->hopSize;
+  int nDecode = chunk.decodeEnd - chunk.decodeBegin;
+  int nState = ctx.model->nState;
+
+  // the filter and the analysis buffer hold the same samples as in a single pass once the warmup is done
+  // the input is zero padded past its end, which is what flushing does
+  int nWarmupHop = (rvRTPYinDelay(ctx.pyinParam) + hopSize - 1) / hopSize + 1;
+  int iFrame = std::max(0, chunk.decodeBegin - nWarmupHop);
+  auto pyinProc = rvCreateRTPYinProcessor(ctx.pyinParam);
+  auto hopTemp = RVALLOC(RvReal, hopSize);
+  auto candidateTemp = RVALLOC(RvReal, static_cast<size_t>(nDecode + 1) * rtPYinMaxCandidate * 2);
+  chunk.candidateOffset = RVALLOC(int, nDecode);
+  chunk.candidateCount = RVALLOC(int, nDecode);
+  int maxCandidate = rvRTMonoPitchParam(ctx.monoPitchProc)->maxCandidate;
+  auto keepTemp = RVALLOC(RvReal, maxCandidate * 2);
+
+  int nCandidateTotal = 0;
+  for(int iX = iFrame * hopSize; iFrame < chunk.decodeEnd; iX += hopSize)
+  {
+    int n = clip(0, ctx.nX - iX, hopSize);
+    if(n > 0)
+      std::copy(ctx.x + iX, ctx.x + iX + n, hopTemp);
+    std::fill(hopTemp + n, hopTemp + hopSize, 0.0);
+    RvReal *candidate = candidateTemp + nCandidateTotal * 2;
+    int nCandidate = rvCallRTPYin(pyinProc, hopTemp, hopSize, candidate, rtPYinMaxCandidate);
+    if(nCandidate < 0)
+      continue;
+    if(iFrame >= chunk.decodeBegin)
+    {
+      // the same candidates the real-time processor keeps
+      if(nCandidate > maxCandidate)
+      {
+        nCandidate = keepProbableCandidate(candidate, nCandidate, maxCandidate, keepTemp);
+        std::copy(keepTemp, keepTemp + nCandidate * 2, candidate);
+      }
+      int i = iFrame - chunk.decodeBegin;
+      chunk.candidateOffset[i] = nCandidateTotal * 2;
+      chunk.candidateCount[i] = nCandidate;
+      nCandidateTotal += nCandidate;
+    }
+    ++iFrame;
+  }
+  rvDestroyRTPYinProcessor(pyinProc);
+  rvFree(hopTemp);
+  rvFree(keepTemp);
+
+  auto obs = RVALLOC(RvReal, static_cast<size_t>(nDecode) * nState);
+  for(int i = 0; i < nDecode; ++i)
+    monoPitchStateProb(ctx.monoPitchProc, candidateTemp + chunk.candidateOffset[i], chunk.candidateCount[i], obs + static_cast<size_t>(i) * nState);
+  chunk.path = RVALLOC(int, nDecode);
+  chunk.nSettled = sparseHMMViterbiDecodeSettled(ctx.model, obs, nDecode, chunk.path);
+  rvFree(obs);
+
+  chunk.candidateList = RVALLOC(RvReal, std::max(1, nCandidateTotal * 2));
+  std::copy(candidateTemp, candidateTemp + nCandidateTotal * 2, chunk.candidateList);
+  rvFree(candidateTemp);
+}
+
+// forced alignment of [begin, left.decodeEnd), from the left path before it into the right path after it
+// returns false when the two cannot be connected there
+static bool bridgeChunk(const Context &ctx, const Chunk &left, const Chunk &right, int begin, int *path)
+{
+  auto &model = *ctx.model;
+  int nState = model.nState;
+  int end = left.decodeEnd;
+  int prevState = left.path[begin - 1 - left.decodeBegin];
+  int nextState = end < right.decodeEnd ? right.path[end - right.decodeBegin] : -1;
+
+  auto delta = RVALLOC(RvReal, nState);
+  auto newDelta = RVALLOC(RvReal, nState);
+  auto obs = RVALLOC(RvReal, nState);
+  auto psiList = RVALLOC(int, static_cast<size_t>(end - begin) * nState);
+  std::fill(delta, delta + nState, 0.0);
+  delta[prevState] = 1.0;
+
+  bool connected = true;
+  for(int iFrame = begin; iFrame < end; ++iFrame)
+  {
+    int nCandidate;
+    const RvReal *candidate = chunkCandidate(left, iFrame, &nCandidate);
+    monoPitchStateProb(ctx.monoPitchProc, candidate, nCandidate, obs);
+    rvHMMViterbiForwardRest(&model, delta, obs, newDelta, psiList + static_cast<size_t>(iFrame - begin) * nState);
+    RvReal deltaSum = sum(newDelta, nState);
+    connected = deltaSum > 0.0;
+    if(!connected)
+      break;
+    for(int i = 0; i < nState; ++i)
+      delta[i] = newDelta[i] / deltaSum;
+  }
+
+  // the last bridged hop has to lead into the right path
+  if(connected && nextState >= 0)
+  {
+    std::fill(newDelta, newDelta + nState, 0.0);
+    for(int i = model.inBegin[nextState]; i < model.inBegin[nextState + 1]; ++i)
+      newDelta[model.inFrm[i]] = delta[model.inFrm[i]] * model.inProb[i];
+    std::copy(newDelta, newDelta + nState, delta);
+  }
+  int lastState = argmax(delta, nState);
+  connected = connected && delta[lastState] > 0.0;
+
+  if(connected)
+  {
+    path[end - 1] = lastState;
+    for(int iFrame = end - 1; iFrame > begin; --iFrame)
+      path[iFrame - 1] = psiList[static_cast<size_t>(iFrame - begin) * nState + path[iFrame]];
+  }
+
+  rvFree(psiList);
+  rvFree(obs);
+  rvFree(newDelta);
+  rvFree(delta);
+  return connected;
+}
+
+static Join joinChunk(const Context &ctx, const Chunk &left, const Chunk &right, int *path)
+{
+  int overlapBegin = right.decodeBegin;
+  int overlapEnd = left.decodeEnd;
+  int boundary = left.coreEnd;
+  // without overlap the paths are simply cut at the boundary
+  if(overlapBegin == overlapEnd)
+    return Join{boundary, boundary};
+
+  // a settled left hop is on the single decode if everything before it is, and so is the right path from there on when it agrees
+  // the agreed hop closest to the boundary is taken
+  int settledEnd = clip(overlapBegin, left.decodeBegin + left.nSettled, overlapEnd);
+  int nSearch = std::max(boundary - overlapBegin, settledEnd - boundary);
+  for(int d = 0; d <= nSearch; ++d)
+  {
+    for(int iFrame : {boundary - d, boundary + d})
+    {
+      if(iFrame < overlapBegin || iFrame >= settledEnd)
+        continue;
+      if(left.path[iFrame - left.decodeBegin] == right.path[iFrame - right.decodeBegin])
+        return Join{iFrame, iFrame};
+    }
+  }
+
+  // otherwise the settled part is kept and at least the right half of the overlap is aligned again
+  int bridgeBegin = std::min(settledEnd, boundary);
+  if(bridgeChunk(ctx, left, right, bridgeBegin, path))
+    return Join{bridgeBegin, overlapEnd};
+  warning("WARNING: pitch paths of hop %d and %d cannot be joined.", boundary - 1, boundary);
+  return Join{boundary, boundary};
+}
+
+int rvPitchTrackerNFrame(const RvRTPYinProcessorParameter *pyinParam, int nX)
+{
+  rvAssert(pyinParam, "pyinParam cannot be nullptr");
+  rvAssert(nX >= 0, "nX cannot be less than 0");
+  return rvGetNFrame(nX, pyinParam->hopSize);
+}
+
+void rvCallPitchTracker(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, const RvReal *x, int nX, int chunkSize, int overlapSize, RvReal *f0)
+{
+  rvAssert(pyinParam, "pyinParam cannot be nullptr");
+  rvAssert(!monoPitchParam || monoPitchParam->hopSize == pyinParam->hopSize, "hopSize of pyinParam and monoPitchParam must be equal");
+  rvAssert(!monoPitchParam || monoPitchParam->samprate == pyinParam->samprate, "samprate of pyinParam and monoPitchParam must be equal");
+  rvAssert(x, "x cannot be nullptr");
+  rvAssert(nX > 0, "nX must be greater than 0");
+  rvAssert(overlapSize >= 0 && chunkSize >= std::max(1, 2 * overlapSize), "chunkSize must be at least 2 * overlapSize and greater than 0");
+  rvAssert(f0, "f0 cannot be nullptr");
+
+  auto defaultParam = monoPitchParam ? nullptr : rvCreateRTMonoPitchProcessorParameterFromRTPYin(pyinParam);
+  if(defaultParam)
+    monoPitchParam = defaultParam;
+
+  int hopSize = pyinParam->hopSize;
+  int nFrame = rvPitchTrackerNFrame(pyinParam, nX);
+  // the processor is only read for its tables, so chunks share it
+  auto monoPitchProc = rvCreateRTMonoPitchProcessor(monoPitchParam);
+  auto model = acquireMonoPitchModel(monoPitchParam);
+  Context ctx = {pyinParam, monoPitchProc, model, x, nX, nFrame};
+
+  int nChunk = (nFrame + chunkSize - 1) / chunkSize;
+  auto chunkList = RVALLOC(Chunk, nChunk);
+  for(int iChunk = 0; iChunk < nChunk; ++iChunk)
+  {
+    auto &chunk = chunkList[iChunk];
+    chunk.coreBegin = iChunk * chunkSize;
+    chunk.coreEnd = std::min(nFrame, chunk.coreBegin + chunkSize);
+    chunk.decodeBegin = std::max(0, chunk.coreBegin - overlapSize);
+    chunk.decodeEnd = std::min(nFrame, chunk.coreEnd + overlapSize);
+  }
+  parallelFor(rvSharedThreadPool(), nChunk, 1, [&](int iBegin, int iEnd)
+  {
+    for(int iChunk = iBegin; iChunk < iEnd; ++iChunk)
+      analyzeChunk(ctx, chunkList[iChunk]);
+  });
+
+  // a join only touches its two chunks and writes its bridge into the overlap
+  // chunkSize >= 2 * overlapSize keeps the overlaps and the joins apart
+  auto path = RVALLOC(int, nFrame);
+  auto joinList = RVALLOC(Join, std::max(1, nChunk - 1));
+  parallelFor(rvSharedThreadPool(), nChunk - 1, 1, [&](int iBegin, int iEnd)
+  {
+    for(int iJoin = iBegin; iJoin < iEnd; ++iJoin)
+      joinList[iJoin] = joinChunk(ctx, chunkList[iJoin], chunkList[iJoin + 1], path);
+  });
+
+  // a chunk emits hops up to the right end of its join, bridged ones lie in its decode range
+  parallelFor(rvSharedThreadPool(), nChunk, 1, [&](int iBegin, int iEnd)
+  {
+    for(int iChunk = iBegin; iChunk < iEnd; ++iChunk)
+    {
+      auto &chunk = chunkList[iChunk];
+      int pathBegin = iChunk > 0 ? joinList[iChunk - 1].rightBegin : 0;
+      int pathEnd = iChunk < nChunk - 1 ? joinList[iChunk].leftEnd : nFrame;
+      int emitEnd = iChunk < nChunk - 1 ? joinList[iChunk].rightBegin : nFrame;
+      std::copy(chunk.path + pathBegin - chunk.decodeBegin, chunk.path + pathEnd - chunk.decodeBegin, path + pathBegin);
+      for(int iFrame = pathBegin; iFrame < emitEnd; ++iFrame)
+      {
+        int nCandidate;
+        const RvReal *candidate = chunkCandidate(chunk, iFrame, &nCandidate);
+        f0[iFrame] = monoPitchPathFreq(monoPitchProc, path[iFrame], candidate, nCandidate, 2);
+      }
+    }
+  });
+
+  for(int iChunk = 0; iChunk < nChunk; ++iChunk)
+  {
+    auto &chunk = chunkList[iChunk];
+    rvFree(chunk.candidateList);
+    rvFree(chunk.candidateCount);
+    rvFree(chunk.candidateOffset);
+    rvFree(chunk.path);
+  }
+  rvFree(joinList);
+  rvFree(path);
+  rvFree(chunkList);
+
+  // mark unvoiced->voiced bound as voiced
+  for(int iHop = 1; iHop < nFrame; ++iHop)
+  {
+    if(f0[iHop - 1] <= 0.0 && f0[iHop] > 0.0)
+    {
+      int frameOffset = monoPitchOnsetFrameOffset(monoPitchParam, f0[iHop]);
+      for(int i = std::max(0, iHop - frameOffset); i < iHop; ++i)
+        f0[i] = f0[iHop];
+    }
+  }
+
+  // mark silent frame as unvoiced, hop k covers the 2 * hopSize frame centered at k * hopSize like in rvCallRTPitchTracker
+  auto energyTracker = rvCreateRTEnergyTracker(hopSize, 2, monoPitchParam->energyThreshold, monoPitchParam->energyThreshold * monoPitchParam->energyHysteresis);
+  rvCallRTEnergyTracker(energyTracker, nullptr, hopSize);
+  for(int iHop = 0; iHop < nFrame; ++iHop)
+  {
+    int n = std::min(hopSize, nX - iHop * hopSize);
+    rvCallRTEnergyTracker(energyTracker, x + iHop * hopSize, n);
+    if(n < hopSize)
+      rvCallRTEnergyTracker(energyTracker, nullptr, hopSize - n);
+    if(f0[iHop] > 0.0 && rvRTEnergyTrackerIsSilent(energyTracker))
+      f0[iHop] = 0.0;
+  }
+  rvDestroyRTEnergyTracker(energyTracker);
+
+  rvReleaseSparseHMM(model);
+  rvDestroyRTMonoPitchProcessor(monoPitchProc);
+  if(defaultParam)
+    rvDestroyRTMonoPitchProcessorParameter(defaultParam);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "util_p.hpp"
+#include <mutex>
+
+namespace ReVoice
+{
+  // fixed set of processors laid out in the block of the pool
+  // released processors are reset and stacked, so acquire neither allocates nor initializes
+  template<typename T>struct ProcessorPool
+  {
+    T **processorList;
+    T **freeList;
+    int nProcessor, nFree;
+    std::mutex lock;
+  };
+
+  // layoutProcessor(arena) places one processor, see layout_p.hpp
+  template<typename Pool, typename T, typename LayoutFunc>Pool *layoutProcessorPool(Arena &arena, int nProcessor, LayoutFunc layoutProcessor)
+  {
+    rvAssert(nProcessor > 0, "nProcessor must be greater than 0");
+    auto self = arena.take<Pool>(1);
+    auto processorList = arena.take<T*>(nProcessor);
+    auto freeList = arena.take<T*>(nProcessor);
+    for(int i = 0; i < nProcessor; ++i)
+    {
+      T *processor = layoutProcessor(arena);
+      if(!arena.isMeasuring())
+        processorList[i] = processor;
+    }
+    if(arena.isMeasuring())
+      return nullptr;
+
+    self = new(self) Pool;
+    self->processorList = processorList;
+    self->freeList = freeList;
+    self->nProcessor = nProcessor;
+    self->nFree = nProcessor;
+    // first acquire gets processorList[0]
+    std::reverse_copy(processorList, processorList + nProcessor, freeList);
+    return self;
+  }
+
+  // returns nullptr when every processor is in use
+  template<typename T>T *acquireFromPool(ProcessorPool<T> *pool)
+  {
+    std::unique_lock<std::mutex> locker(pool->lock);
+    return pool->nFree > 0 ? pool->freeList[--pool->nFree] : nullptr;
+  }
+
+  template<typename T, typename ResetFunc>void releaseToPool(ProcessorPool<T> *pool, T *processor, ResetFunc reset)
+  {
+    rvAssert(std::find(pool->processorList, pool->processorList + pool->nProcessor, processor) != pool->processorList + pool->nProcessor, "processor does not belong to this pool");
+    reset(processor);
+    std::unique_lock<std::mutex> locker(pool->lock);
+    rvAssert(std::find(pool->freeList, pool->freeList + pool->nFree, processor) == pool->freeList + pool->nFree, "processor is released twice");
+    pool->freeList[pool->nFree++] = processor;
+  }
+
+  template<typename Pool, typename DestroyFunc>void destroyProcessorPool(Pool *pool, DestroyFunc destroy)
+  {
+    rvAssert(pool->nFree == pool->nProcessor, "processors are still acquired");
+    for(int i = 0; i < pool->nProcessor; ++i)
+      destroy(pool->processorList[i]);
+    pool->~Pool();
+    rvFree(pool);
+  }
+} // namespace ReVoice
@@ -0,0 +1,140 @@
+#include "../rtenergy.h"
+
+#include "util_p.hpp"
+#include "layout_p.hpp"
+
+using namespace ReVoice;
+
+// energy is the variance of the last nWindowHop complete hops
+// per-hop mean and sum of squared deviations are kept in a ring and merged pairwise, which needs no second pass over the window
+typedef struct RvRTEnergyTracker
+{
+  RvReal *hopBuffer;
+  RvReal *hopMeanList, *hopM2List;
+  RvReal silentThreshold, voicedThreshold;
+  RvReal energy;
+  int hopSize, nWindowHop;
+  int nBuffered, hopHead, nHop;
+  bool isSilent;
+  bool ownsMemory;
+} RvRTEnergyTracker;
+
+namespace ReVoice
+{
+  RvRTEnergyTracker *layoutRTEnergyTracker(Arena &arena, int hopSize, int nWindowHop, RvReal silentThreshold, RvReal voicedThreshold)
+  {
+    rvAssert(hopSize > 0, "hopSize must be greater than 0");
+    rvAssert(nWindowHop > 0, "nWindowHop must be greater than 0");
+    rvAssert(silentThreshold >= 0.0 && voicedThreshold >= silentThreshold, "invalid silentThreshold or voicedThreshold");
+
+    auto self = arena.construct<RvRTEnergyTracker>();
+    auto hopBuffer = arena.take<RvReal>(hopSize);
+    auto hopMeanList = arena.take<RvReal>(nWindowHop);
+    auto hopM2List = arena.take<RvReal>(nWindowHop);
+    if(arena.isMeasuring())
+      return nullptr;
+    self->hopBuffer = hopBuffer;
+    self->hopMeanList = hopMeanList;
+    self->hopM2List = hopM2List;
+    self->silentThreshold = silentThreshold;
+    self->voicedThreshold = voicedThreshold;
+    self->hopSize = hopSize;
+    self->nWindowHop = nWindowHop;
+    self->ownsMemory = false;
+    rvResetRTEnergyTracker(self);
+    return self;
+  }
+} // namespace ReVoice
+
+RvRTEnergyTracker *rvCreateRTEnergyTracker(int hopSize, int nWindowHop, RvReal silentThreshold, RvReal voicedThreshold)
+{
+  Arena measure;
+  layoutRTEnergyTracker(measure, hopSize, nWindowHop, silentThreshold, voicedThreshold);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTEnergyTracker(arena, hopSize, nWindowHop, silentThreshold, voicedThreshold);
+  self->ownsMemory = true;
+  return self;
+}
+
+static void finishHop(RvRTEnergyTracker *self)
+{
+  int hopSize = self->hopSize;
+  RvReal hopMean = mean(self->hopBuffer, hopSize);
+  RvReal hopM2 = 0.0;
+  for(int i = 0; i < hopSize; ++i)
+  {
+    RvReal v = self->hopBuffer[i] - hopMean;
+    hopM2 += v * v;
+  }
+  self->hopHead = (self->hopHead + 1) % self->nWindowHop;
+  self->hopMeanList[self->hopHead] = hopMean;
+  self->hopM2List[self->hopHead] = hopM2;
+  self->nHop = std::min(self->nHop + 1, self->nWindowHop);
+
+  // merge from the oldest hop on
+  RvReal n = 0.0, windowMean = 0.0, windowM2 = 0.0;
+  for(int i = self->nHop - 1; i >= 0; --i)
+  {
+    int slot = (self->hopHead - i + self->nWindowHop) % self->nWindowHop;
+    RvReal nNew = n + static_cast<RvReal>(hopSize);
+    RvReal delta = self->hopMeanList[slot] - windowMean;
+    windowMean += delta * static_cast<RvReal>(hopSize) / nNew;
+    windowM2 += self->hopM2List[slot] + delta * delta * n * static_cast<RvReal>(hopSize) / nNew;
+    n = nNew;
+  }
+  self->energy = windowM2 / n;
+
+  if(self->isSilent && self->energy >= self->voicedThreshold)
+    self->isSilent = false;
+  else if(!self->isSilent && self->energy < self->silentThreshold)
+    self->isSilent = true;
+}
+
+// x == nullptr stands for nX zeros, x may start and end anywhere within a hop
+// returns the number of hops completed by this call, energy and silent state are those after the last one
+int rvCallRTEnergyTracker(RvRTEnergyTracker *self, const RvReal *x, int nX)
+{
+  rvAssert(nX >= 0, "nX cannot be less than 0");
+  int nHopDone = 0;
+  while(nX > 0)
+  {
+    int n = std::min(nX, self->hopSize - self->nBuffered);
+    if(x)
+    {
+      std::copy(x, x + n, self->hopBuffer + self->nBuffered);
+      x += n;
+    }
+    else
+      std::fill(self->hopBuffer + self->nBuffered, self->hopBuffer + self->nBuffered + n, 0.0);
+    self->nBuffered += n;
+    nX -= n;
+    if(self->nBuffered == self->hopSize)
+    {
+      self->nBuffered = 0;
+      finishHop(self);
+      ++nHopDone;
+    }
+  }
+  return nHopDone;
+}
+
+RvReal rvRTEnergyTrackerEnergy(const RvRTEnergyTracker *self)
+{ return self->energy; }
+
+bool rvRTEnergyTrackerIsSilent(const RvRTEnergyTracker *self)
+{ return self->isSilent; }
+
+void rvResetRTEnergyTracker(RvRTEnergyTracker *self)
+{
+  self->energy = 0.0;
+  self->nBuffered = 0;
+  self->hopHead = self->nWindowHop - 1;
+  self->nHop = 0;
+  self->isSilent = true;
+}
+
+void rvDestroyRTEnergyTracker(RvRTEnergyTracker *self)
+{
+  if(self->ownsMemory)
+    rvFree(self);
+}
\ No newline at end of file
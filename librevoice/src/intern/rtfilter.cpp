@@ -1,6 +1,7 @@
 #include "../rtfilter.h"
 
 #include "util_p.hpp"
+#include "layout_p.hpp"
 
 using namespace ReVoice;
 
@@ -11,28 +12,53 @@ typedef struct RvRTFilter
   RvFFTConvolver *fftConv;
   int kernelSize, maxNX;
   int delayed;
+  bool ownsMemory;
 } RvRTFilter;
 
-RvRTFilter *rvCreateRTFilter(const RvReal *kernel, int kernelSize, int maxNX)
+namespace ReVoice
 {
-  rvAssert(kernelSize > 0, "kernelSize must be greater than 0");
-  rvAssert(maxNX > 0, "maxNX must be greater than 0");
-  rvAssert(kernel, "kernel cannot be nullptr");
-  auto self = new RvRTFilter;
-  self->kernel = RVALLOC(RvReal, kernelSize);
-  self->buffer = RVALLOC(RvReal, kernelSize - 1);
-  self->convTemp = RVALLOC(RvReal, kernelSize + maxNX - 1);
-  self->fftConv = nullptr;
-  self->kernelSize = kernelSize;
-  self->maxNX = maxNX;
-  self->delayed = 0;
+  RvRTFilter *layoutRTFilter(Arena &arena, const RvReal *kernel, int kernelSize, int maxNX)
+  {
+    rvAssert(kernelSize > 0, "kernelSize must be greater than 0");
+    rvAssert(maxNX > 0, "maxNX must be greater than 0");
+    auto self = arena.construct<RvRTFilter>();
+    auto kernelCopy = arena.take<RvReal>(kernelSize);
+    auto buffer = arena.take<RvReal>(kernelSize - 1);
+    auto convTemp = arena.take<RvReal>(kernelSize + maxNX - 1);
+    RvFFTConvolver *fftConv = nullptr;
+    if(maxNX + kernelSize - 1 >= 128)
+      fftConv = layoutFFTConvolver(arena, roundUpToPowerOf2(maxNX + kernelSize - 1));
+    if(arena.isMeasuring())
+      return nullptr;
 
-  if(maxNX + kernelSize - 1 >= 128)
-    self->fftConv = rvCreateFFTConvolver(roundUpToPowerOf2(maxNX + kernelSize - 1));
+    self->kernel = kernelCopy;
+    self->buffer = buffer;
+    self->convTemp = convTemp;
+    self->fftConv = fftConv;
+    self->kernelSize = kernelSize;
+    self->maxNX = maxNX;
+    self->ownsMemory = false;
 
-  std::copy(kernel, kernel + kernelSize, self->kernel);
-  std::fill(self->buffer, self->buffer + kernelSize - 1, 0.0);
+    if(kernel)
+      std::copy(kernel, kernel + kernelSize, self->kernel);
+    else
+      std::fill(self->kernel, self->kernel + kernelSize, 0.0);
+    rvResetRTFilter(self);
+    return self;
+  }
 
+  RvReal *rtFilterKernel(RvRTFilter *filter)
+  { return filter->kernel; }
+} // namespace ReVoice
+
+RvRTFilter *rvCreateRTFilter(const RvReal *kernel, int kernelSize, int maxNX)
+{
+  rvAssert(kernel, "kernel cannot be nullptr");
+  Arena measure;
+  layoutRTFilter(measure, kernel, kernelSize, maxNX);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTFilter(arena, kernel, kernelSize, maxNX);
+  self->ownsMemory = true;
   return self;
 }
 
@@ -92,13 +118,32 @@ int rvCallRTFilter(RvRTFilter *self, const RvReal *x, int nX, RvReal *out)
   }  
 }
 
+void rvResetRTFilter(RvRTFilter *self)
+{
+  std::fill(self->buffer, self->buffer + self->kernelSize - 1, 0.0);
+  self->delayed = 0;
+}
+
 void rvDestroyRTFilter(RvRTFilter *self)
 {
   if(self->fftConv)
     rvDestroyFFTConvolver(self->fftConv);
-  rvFree(self->convTemp);
-  rvFree(self->buffer);
-  rvFree(self->kernel);
+  if(self->ownsMemory)
+    rvFree(self);
+}
+
+size_t rvRTFilterRequiredSize(int kernelSize, int maxNX)
+{
+  Arena measure;
+  layoutRTFilter(measure, nullptr, kernelSize, maxNX);
+  return measure.size();
+}
+
+RvRTFilter *rvInitRTFilterInPlace(void *mem, const RvReal *kernel, int kernelSize, int maxNX)
+{
+  rvAssert(kernel, "kernel cannot be nullptr");
+  Arena arena = Arena::inPlace(mem);
+  return layoutRTFilter(arena, kernel, kernelSize, maxNX);
 }
 
 int rvRTFilterDelay(int kernelSize)
@@ -2,63 +2,136 @@
 
 #include "util_p.hpp"
 #include "hmm_p.hpp"
+#include "layout_p.hpp"
 
+#include <cmath>
 #include <vector>
 
 using namespace ReVoice;
 
 typedef struct RvRTSparseHMM
 {
-  RvSparseHMM sparseHMM;
+  RvSparseHMM *model;
 
+  // psiList is a ring of nMaxBackward frames, psiHead is the slot of the newest one
   RvReal *oldDelta, *deltaTemp;
   int *psiList;
-  int nMaxBackward, psiUsed;
+  int nMaxBackward, psiUsed, psiHead;
+
+  // beam pruning is disabled when logBeam <= 0
+  RvReal logBeam;
+  int *activeList, *activeTemp;
+  int nActive;
+
+  bool ownsMemory;
 } RvRTSparseHMM;
 
+// delta and psi are stream-interleaved: element (iState, iStream) lives at iState * nStream + iStream
+typedef struct RvRTSparseHMMBank
+{
+  RvSparseHMM *model;
+
+  RvReal *oldDelta, *deltaTemp, *deltaSum;
+  int *psiList, *psiUsed;
+  int nStream, nMaxBackward, psiHead;
+} RvRTSparseHMMBank;
+
+// alpha and obs of the last (lag + 1) frames are kept in rings indexed by iFrame % (lag + 1)
+typedef struct RvRTSparseHMMSmoother
+{
+  RvSparseHMM *model;
+
+  RvReal *alphaList, *obsList;
+  RvReal *betaTemp, *betaNextTemp, *obsTemp;
+  int lag, nFed, nEmitted;
+} RvRTSparseHMMSmoother;
+
 RvRTSparseHMM *rvCreateRTSparseHMM(RvReal *init, int *frm, int *to, RvReal *transProb, int nState, int nTrans, int nMaxBackward)
 {
-  auto self = new RvRTSparseHMM;
-  ctorSparseHMM(self->sparseHMM, init, frm, to, transProb, nState, nTrans);
-  self->oldDelta = RVALLOC(RvReal, nState);
-  self->deltaTemp = RVALLOC(RvReal, nState);
-  self->psiList = RVALLOC(int, nMaxBackward * nState);
-  self->nMaxBackward = nMaxBackward;
-  self->psiUsed = 0;
+  auto model = rvCreateSparseHMM(init, frm, to, transProb, nState, nTrans);
+  auto self = rvCreateRTSparseHMMFromModel(model, nMaxBackward);
+  rvReleaseSparseHMM(model);
+  return self;
+}
+
+namespace ReVoice
+{
+  RvRTSparseHMM *layoutRTSparseHMM(Arena &arena, RvSparseHMM *model, int nMaxBackward)
+  {
+    rvAssert(model, "model cannot be nullptr");
+    rvAssert(nMaxBackward > 0, "nMaxBackward must be greater than 0");
+    int nState = model->nState;
+    auto self = arena.construct<RvRTSparseHMM>();
+    auto oldDelta = arena.take<RvReal>(nState);
+    auto deltaTemp = arena.take<RvReal>(nState);
+    auto psiList = arena.take<int>(static_cast<size_t>(nMaxBackward) * static_cast<size_t>(nState));
+    auto activeList = arena.take<int>(nState);
+    auto activeTemp = arena.take<int>(nState);
+    if(arena.isMeasuring())
+      return nullptr;
+    self->model = rvRetainSparseHMM(model);
+    self->oldDelta = oldDelta;
+    self->deltaTemp = deltaTemp;
+    self->psiList = psiList;
+    self->nMaxBackward = nMaxBackward;
+    self->logBeam = 0.0;
+    self->activeList = activeList;
+    self->activeTemp = activeTemp;
+    self->ownsMemory = false;
+    rvResetRTSparseHMM(self);
+    return self;
+  }
+} // namespace ReVoice
+
+RvRTSparseHMM *rvCreateRTSparseHMMFromModel(RvSparseHMM *model, int nMaxBackward)
+{
+  Arena measure;
+  layoutRTSparseHMM(measure, model, nMaxBackward);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTSparseHMM(arena, model, nMaxBackward);
+  self->ownsMemory = true;
   return self;
 }
 
+const RvSparseHMM *rvRTSparseHMMModel(const RvRTSparseHMM *self)
+{ return self->model; }
+
 bool rvRTSparseHMMFeed(RvRTSparseHMM *self, RvReal *obs)
 {
   rvAssert(obs, "obs cannot be nullptr");
-  int nState = self->sparseHMM.nState;
+  int nState = self->model->nState;
+  self->psiHead = (self->psiHead + 1) % self->nMaxBackward;
+  int *psi = self->psiList + self->psiHead * nState;
   if(self->psiUsed == 0)
   {
     for(int i = 0; i < nState; ++i)
     {
-      RvReal v = self->sparseHMM.init[i] * obs[i];
+      RvReal v = self->model->init[i] * obs[i];
       self->oldDelta[i] = v;
     }
+    if(self->logBeam > 0.0)
+      self->nActive = rvHMMPruneBeam(self->oldDelta, nState, self->logBeam, self->activeList);
     RvReal deltaSum = sum(self->oldDelta, nState);
     if(deltaSum > 0.0)
     {
       for(int i = 0; i < nState; ++i)
         self->oldDelta[i] /= deltaSum;
     }
-    std::fill(self->psiList + self->psiUsed * nState, self->psiList + (self->psiUsed + 1) * nState, 0);
+    std::fill(psi, psi + nState, 0);
     ++self->psiUsed;
     return true;
   }
   else
   {
     rvAssert(self->psiUsed <= self->nMaxBackward, "internal error");
-    if(self->psiUsed == self->nMaxBackward)
+    if(self->logBeam > 0.0)
     {
-      std::copy(self->psiList + nState, self->psiList + self->psiUsed * nState, self->psiList);
-      --self->psiUsed;
+      self->nActive = rvHMMViterbiForwardBeam(self->model, self->oldDelta, self->activeList, self->nActive, obs, self->logBeam, self->deltaTemp, psi, self->activeTemp);
+      std::swap(self->activeList, self->activeTemp);
     }
-    rvHMMViterbiForwardRest(&self->sparseHMM, self->oldDelta, obs, self->deltaTemp, self->psiList + self->psiUsed * nState);
-    ++self->psiUsed;
+    else
+      rvHMMViterbiForwardRest(self->model, self->oldDelta, obs, self->deltaTemp, psi);
+    self->psiUsed = std::min(self->psiUsed + 1, self->nMaxBackward);
 
     RvReal deltaSum = sum(self->deltaTemp, nState);
     if(deltaSum > 0.0)
@@ -69,8 +142,10 @@ bool rvRTSparseHMMFeed(RvRTSparseHMM *self, RvReal *obs)
     }
     else
     {
-      warning("WARNING: Viterbi decoder has been fed some zero probabilities.");
+      // reported by the return value only, this runs on the audio thread
       std::fill(self->oldDelta, self->oldDelta + nState, 1.0 / static_cast<RvReal>(nState));
+      self->nActive = nState;
+      arange(0, nState, self->activeList);
       return false;
     }
   }
@@ -80,22 +155,326 @@ int rvRTSparseHMMViterbiDecode(RvRTSparseHMM *self, int *out, int nBackward)
 {
   rvAssert(nBackward > 0 && nBackward <= self->nMaxBackward, "nBackward must be in range (0, nMaxBackward]");
   nBackward = std::min(self->psiUsed, nBackward);
-  int nState = self->sparseHMM.nState;
+  int nState = self->model->nState;
   
   out[nBackward - 1] = argmax(self->oldDelta, nState);
+  int slot = self->psiHead;
   for(int i = nBackward - 2; i >= 0; --i)
-     out[i] = self->psiList[(i + 1) * nState + out[i + 1]];
+  {
+    out[i] = self->psiList[slot * nState + out[i + 1]];
+    slot = slot == 0 ? self->nMaxBackward - 1 : slot - 1;
+  }
 
   return nBackward;
 }
 
+// pathIO holds the previous decode of the same frames (the newest entry is ignored)
+// backtracking stops at the first frame whose state is unchanged, since every older frame follows the same psi
+// returns the index of the oldest changed frame
+int rvRTSparseHMMViterbiDecodeUpdate(RvRTSparseHMM *self, int *pathIO, int nBackward)
+{
+  rvAssert(nBackward > 0 && nBackward <= self->nMaxBackward, "nBackward must be in range (0, nMaxBackward]");
+  rvAssert(nBackward <= self->psiUsed, "nBackward must not exceed currently available frames");
+  int nState = self->model->nState;
+
+  pathIO[nBackward - 1] = argmax(self->oldDelta, nState);
+  int slot = self->psiHead;
+  for(int i = nBackward - 2; i >= 0; --i)
+  {
+    int state = self->psiList[slot * nState + pathIO[i + 1]];
+    if(state == pathIO[i])
+      return i + 1;
+    pathIO[i] = state;
+    slot = slot == 0 ? self->nMaxBackward - 1 : slot - 1;
+  }
+
+  return 0;
+}
+
 int rvRTSparseHMMCurrentAvailable(RvRTSparseHMM *self)
 { return self->psiUsed; }
 
+void rvRTSparseHMMSetBeam(RvRTSparseHMM *self, RvReal logBeam)
+{
+  rvAssert(!std::isnan(logBeam), "logBeam cannot be nan");
+  self->logBeam = logBeam;
+  if(logBeam <= 0.0)
+  {
+    self->nActive = self->model->nState;
+    arange(0, self->nActive, self->activeList);
+  }
+}
+
+int rvRTSparseHMMActiveCount(const RvRTSparseHMM *self)
+{ return self->nActive; }
+
+void rvResetRTSparseHMM(RvRTSparseHMM *self)
+{
+  int nState = self->model->nState;
+  self->psiUsed = 0;
+  self->psiHead = self->nMaxBackward - 1;
+  self->nActive = nState;
+  arange(0, nState, self->activeList);
+}
+
 void rvDestroyRTSparseHMM(RvRTSparseHMM *self)
 {
+  rvReleaseSparseHMM(self->model);
+  if(self->ownsMemory)
+    rvFree(self);
+}
+
+size_t rvRTSparseHMMRequiredSize(RvSparseHMM *model, int nMaxBackward)
+{
+  Arena measure;
+  layoutRTSparseHMM(measure, model, nMaxBackward);
+  return measure.size();
+}
+
+RvRTSparseHMM *rvInitRTSparseHMMInPlace(void *mem, RvSparseHMM *model, int nMaxBackward)
+{
+  Arena arena = Arena::inPlace(mem);
+  return layoutRTSparseHMM(arena, model, nMaxBackward);
+}
+
+RvRTSparseHMMBank *rvCreateRTSparseHMMBank(RvSparseHMM *model, int nStream, int nMaxBackward)
+{
+  rvAssert(model, "model cannot be nullptr");
+  rvAssert(nStream > 0, "nStream must be greater than 0");
+  rvAssert(nMaxBackward > 0, "nMaxBackward must be greater than 0");
+  int nState = model->nState;
+  auto self = new RvRTSparseHMMBank;
+  self->model = rvRetainSparseHMM(model);
+  self->oldDelta = RVALLOC(RvReal, nState * nStream);
+  self->deltaTemp = RVALLOC(RvReal, nState * nStream);
+  self->deltaSum = RVALLOC(RvReal, nStream);
+  self->psiList = RVALLOC(int, nMaxBackward * nState * nStream);
+  self->psiUsed = RVALLOC(int, nStream);
+  self->nStream = nStream;
+  self->nMaxBackward = nMaxBackward;
+  self->psiHead = nMaxBackward - 1;
+  std::fill(self->oldDelta, self->oldDelta + nState * nStream, 0.0);
+  std::fill(self->psiUsed, self->psiUsed + nStream, 0);
+  return self;
+}
+
+int rvRTSparseHMMBankNStream(const RvRTSparseHMMBank *self)
+{ return self->nStream; }
+
+void rvRTSparseHMMBankFeed(RvRTSparseHMMBank *self, const RvReal *obs, bool *ok)
+{
+  rvAssert(obs, "obs cannot be nullptr");
+  const RvSparseHMM &model = *self->model;
+  int nState = model.nState;
+  int nTrans = model.nTrans;
+  int nStream = self->nStream;
+
+  self->psiHead = (self->psiHead + 1) % self->nMaxBackward;
+  auto psi = self->psiList + self->psiHead * nState * nStream;
+  auto oldDelta = self->oldDelta;
+  auto newDelta = self->deltaTemp;
+  auto deltaSum = self->deltaSum;
+
+  // max-product step, the inner loop runs across streams
+  std::fill(newDelta, newDelta + nState * nStream, 0.0);
+  std::fill(psi, psi + nState * nStream, 0);
+  for(int iTrans = 0; iTrans < nTrans; ++iTrans)
+  {
+    int fs = model.frm[iTrans];
+    RvReal p = model.transProb[iTrans];
+    const RvReal *src = oldDelta + fs * nStream;
+    RvReal *dst = newDelta + model.to[iTrans] * nStream;
+    int *dstPsi = psi + model.to[iTrans] * nStream;
+    for(int iStream = 0; iStream < nStream; ++iStream)
+    {
+      RvReal v = src[iStream] * p;
+      bool better = v > dst[iStream];
+      dst[iStream] = better ? v : dst[iStream];
+      dstPsi[iStream] = better ? fs : dstPsi[iStream];
+    }
+  }
+
+  std::fill(deltaSum, deltaSum + nStream, 0.0);
+  for(int iState = 0; iState < nState; ++iState)
+  {
+    const RvReal *o = obs + iState * nStream;
+    RvReal *d = newDelta + iState * nStream;
+    for(int iStream = 0; iStream < nStream; ++iStream)
+    {
+      d[iStream] *= o[iStream];
+      deltaSum[iStream] += d[iStream];
+    }
+  }
+
+  // streams without history start from the initial distribution
+  for(int iStream = 0; iStream < nStream; ++iStream)
+  {
+    if(self->psiUsed[iStream] > 0)
+      continue;
+    deltaSum[iStream] = 0.0;
+    for(int iState = 0; iState < nState; ++iState)
+    {
+      RvReal v = model.init[iState] * obs[iState * nStream + iStream];
+      newDelta[iState * nStream + iStream] = v;
+      psi[iState * nStream + iStream] = 0;
+      deltaSum[iStream] += v;
+    }
+    if(deltaSum[iStream] <= 0.0)
+      deltaSum[iStream] = 1.0;
+  }
+
+  for(int iStream = 0; iStream < nStream; ++iStream)
+  {
+    bool streamOk = deltaSum[iStream] > 0.0;
+    if(ok)
+      ok[iStream] = streamOk;
+    deltaSum[iStream] = streamOk ? 1.0 / deltaSum[iStream] : 0.0;
+    self->psiUsed[iStream] = std::min(self->psiUsed[iStream] + 1, self->nMaxBackward);
+  }
+  RvReal uniform = 1.0 / static_cast<RvReal>(nState);
+  for(int iState = 0; iState < nState; ++iState)
+  {
+    const RvReal *d = newDelta + iState * nStream;
+    RvReal *od = oldDelta + iState * nStream;
+    for(int iStream = 0; iStream < nStream; ++iStream)
+      od[iStream] = deltaSum[iStream] > 0.0 ? d[iStream] * deltaSum[iStream] : uniform;
+  }
+}
+
+int rvRTSparseHMMBankViterbiDecode(const RvRTSparseHMMBank *self, int iStream, int *out, int nBackward)
+{
+  rvAssert(iStream >= 0 && iStream < self->nStream, "iStream must be in range [0, nStream)");
+  rvAssert(nBackward > 0 && nBackward <= self->nMaxBackward, "nBackward must be in range (0, nMaxBackward]");
+  rvAssert(out, "out cannot be nullptr");
+  nBackward = std::min(self->psiUsed[iStream], nBackward);
+  if(nBackward == 0)
+    return 0;
+  int nState = self->model->nState;
+  int nStream = self->nStream;
+
+  int bestState = 0;
+  for(int iState = 1; iState < nState; ++iState)
+  {
+    if(self->oldDelta[iState * nStream + iStream] > self->oldDelta[bestState * nStream + iStream])
+      bestState = iState;
+  }
+  out[nBackward - 1] = bestState;
+  int slot = self->psiHead;
+  for(int i = nBackward - 2; i >= 0; --i)
+  {
+    out[i] = self->psiList[(slot * nState + out[i + 1]) * nStream + iStream];
+    slot = slot == 0 ? self->nMaxBackward - 1 : slot - 1;
+  }
+
+  return nBackward;
+}
+
+int rvRTSparseHMMBankCurrentAvailable(const RvRTSparseHMMBank *self, int iStream)
+{
+  rvAssert(iStream >= 0 && iStream < self->nStream, "iStream must be in range [0, nStream)");
+  return self->psiUsed[iStream];
+}
+
+void rvRTSparseHMMBankResetStream(RvRTSparseHMMBank *self, int iStream)
+{
+  rvAssert(iStream >= 0 && iStream < self->nStream, "iStream must be in range [0, nStream)");
+  self->psiUsed[iStream] = 0;
+}
+
+void rvDestroyRTSparseHMMBank(RvRTSparseHMMBank *self)
+{
+  rvFree(self->psiUsed);
   rvFree(self->psiList);
+  rvFree(self->deltaSum);
   rvFree(self->deltaTemp);
   rvFree(self->oldDelta);
-  dtorSparseHMM(self->sparseHMM);
+  rvReleaseSparseHMM(self->model);
+  delete self;
+}
+
+RvRTSparseHMMSmoother *rvCreateRTSparseHMMSmoother(RvSparseHMM *model, int lag)
+{
+  rvAssert(model, "model cannot be nullptr");
+  rvAssert(lag >= 0, "lag cannot be less than 0");
+  int nState = model->nState;
+  auto self = new RvRTSparseHMMSmoother;
+  self->model = rvRetainSparseHMM(model);
+  self->alphaList = RVALLOC(RvReal, (lag + 1) * nState);
+  self->obsList = RVALLOC(RvReal, (lag + 1) * nState);
+  self->betaTemp = RVALLOC(RvReal, nState);
+  self->betaNextTemp = RVALLOC(RvReal, nState);
+  self->obsTemp = RVALLOC(RvReal, nState);
+  self->lag = lag;
+  self->nFed = 0;
+  self->nEmitted = 0;
+  return self;
+}
+
+int rvRTSparseHMMSmootherLag(const RvRTSparseHMMSmoother *self)
+{ return self->lag; }
+
+int rvRTSparseHMMSmootherFeed(RvRTSparseHMMSmoother *self, const RvReal *obs, RvReal *out)
+{
+  rvAssert(out, "out cannot be nullptr");
+  int nState = self->model->nState;
+  int nSlot = self->lag + 1;
+
+  if(obs)
+  {
+    RvReal *alpha = self->alphaList + (self->nFed % nSlot) * nState;
+    std::copy(obs, obs + nState, self->obsList + (self->nFed % nSlot) * nState);
+    if(self->nFed == 0)
+    {
+      for(int i = 0; i < nState; ++i)
+        alpha[i] = self->model->init[i] * obs[i];
+    }
+    else
+    {
+      // with lag == 0 the previous alpha shares the slot
+      rvHMMForwardRest(self->model, self->alphaList + ((self->nFed - 1) % nSlot) * nState, obs, self->betaTemp);
+      std::copy(self->betaTemp, self->betaTemp + nState, alpha);
+    }
+    normalizeProb(alpha, nState);
+    ++self->nFed;
+    if(self->nFed - self->nEmitted <= self->lag)
+      return -1;
+  }
+  else if(self->nFed == self->nEmitted)
+    return -1;
+
+  // backward pass from the newest frame down to the emitted one
+  int iFrame = self->nEmitted;
+  RvReal *beta = self->betaTemp;
+  RvReal *nextBeta = self->betaNextTemp;
+  std::fill(beta, beta + nState, 1.0 / static_cast<RvReal>(nState));
+  for(int i = self->nFed - 1; i > iFrame; --i)
+  {
+    std::swap(beta, nextBeta);
+    rvHMMBackwardRest(self->model, nextBeta, self->obsList + (i % nSlot) * nState, beta, self->obsTemp);
+    normalizeProb(beta, nState);
+  }
+
+  const RvReal *alpha = self->alphaList + (iFrame % nSlot) * nState;
+  for(int i = 0; i < nState; ++i)
+    out[i] = alpha[i] * beta[i];
+  normalizeProb(out, nState);
+
+  ++self->nEmitted;
+  if(!obs && self->nEmitted == self->nFed)
+  {
+    self->nFed = 0;
+    self->nEmitted = 0;
+  }
+  return iFrame;
+}
+
+void rvDestroyRTSparseHMMSmoother(RvRTSparseHMMSmoother *self)
+{
+  rvFree(self->obsTemp);
+  rvFree(self->betaNextTemp);
+  rvFree(self->betaTemp);
+  rvFree(self->obsList);
+  rvFree(self->alphaList);
+  rvReleaseSparseHMM(self->model);
+  delete self;
 }
\ No newline at end of file
@@ -0,0 +1,290 @@
+#define _USE_MATH_DEFINES
+#include "../rthnm.h"
+
+#include "util_p.hpp"
+#include "layout_p.hpp"
+#include "stage_p.hpp"
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ReVoice;
+
+typedef struct RvRTHNMSynthesizer
+{
+  RvHNMSynthesizerParameter param;
+  int maxHar;
+  // harmonics of the last hop, which is rendered once the next one arrives
+  RvReal *freq, *amp, *phase;
+  RvReal *nextFreq, *nextAmp, *nextPhase;
+  RvReal *scratch;
+  RvReal f0, basePhase;
+  bool hasHop;
+  bool ownsMemory;
+} RvRTHNMSynthesizer;
+
+namespace
+{
+  // oscillators run in groups of this many harmonics, two independent pairs hide the latency of the rotation
+  constexpr int oscillatorGroupSize = 4;
+} // namespace
+
+static int paddedHarmonicCount(int maxHar)
+{ return (maxHar + oscillatorGroupSize - 1) / oscillatorGroupSize * oscillatorGroupSize; }
+
+// sums amp * re over nOsc oscillators for n samples, rotating re + j * im by stepRe + j * stepIm and ramping amp by dAmp each sample
+// acc holds 2 * n partial sums, lane i % 2 of each group
+static void runOscillatorBank(const RvReal *re, const RvReal *im, const RvReal *stepRe, const RvReal *stepIm, const RvReal *amp, const RvReal *dAmp, int nOsc, int n, RvReal *acc, RvReal *out)
+{
+  std::fill(acc, acc + 2 * n, 0.0);
+#ifdef __SSE2__
+  for(int k = 0; k < nOsc; k += oscillatorGroupSize)
+  {
+    __m128d re0 = _mm_loadu_pd(re + k), re1 = _mm_loadu_pd(re + k + 2);
+    __m128d im0 = _mm_loadu_pd(im + k), im1 = _mm_loadu_pd(im + k + 2);
+    __m128d c0 = _mm_loadu_pd(stepRe + k), c1 = _mm_loadu_pd(stepRe + k + 2);
+    __m128d s0 = _mm_loadu_pd(stepIm + k), s1 = _mm_loadu_pd(stepIm + k + 2);
+    __m128d a0 = _mm_loadu_pd(amp + k), a1 = _mm_loadu_pd(amp + k + 2);
+    __m128d d0 = _mm_loadu_pd(dAmp + k), d1 = _mm_loadu_pd(dAmp + k + 2);
+    for(int i = 0; i < n; ++i)
+    {
+      __m128d v = _mm_add_pd(_mm_mul_pd(a0, re0), _mm_mul_pd(a1, re1));
+      _mm_storeu_pd(acc + 2 * i, _mm_add_pd(_mm_loadu_pd(acc + 2 * i), v));
+      __m128d nextRe0 = _mm_sub_pd(_mm_mul_pd(re0, c0), _mm_mul_pd(im0, s0));
+      __m128d nextRe1 = _mm_sub_pd(_mm_mul_pd(re1, c1), _mm_mul_pd(im1, s1));
+      im0 = _mm_add_pd(_mm_mul_pd(re0, s0), _mm_mul_pd(im0, c0));
+      im1 = _mm_add_pd(_mm_mul_pd(re1, s1), _mm_mul_pd(im1, c1));
+      re0 = nextRe0;
+      re1 = nextRe1;
+      a0 = _mm_add_pd(a0, d0);
+      a1 = _mm_add_pd(a1, d1);
+    }
+  }
+#else
+  for(int k = 0; k < nOsc; k += oscillatorGroupSize)
+  {
+    RvReal r[oscillatorGroupSize], m[oscillatorGroupSize], a[oscillatorGroupSize];
+    std::copy(re + k, re + k + oscillatorGroupSize, r);
+    std::copy(im + k, im + k + oscillatorGroupSize, m);
+    std::copy(amp + k, amp + k + oscillatorGroupSize, a);
+    for(int i = 0; i < n; ++i)
+    {
+      for(int lane = 0; lane < 2; ++lane)
+        acc[2 * i + lane] += a[lane] * r[lane] + a[lane + 2] * r[lane + 2];
+      for(int j = 0; j < oscillatorGroupSize; ++j)
+      {
+        RvReal nextRe = r[j] * stepRe[k + j] - m[j] * stepIm[k + j];
+        m[j] = r[j] * stepIm[k + j] + m[j] * stepRe[k + j];
+        r[j] = nextRe;
+        a[j] += dAmp[k + j];
+      }
+    }
+  }
+#endif
+  for(int i = 0; i < n; ++i)
+    out[i] = acc[2 * i] + acc[2 * i + 1];
+}
+
+namespace ReVoice
+{
+  RvReal hnmNextBasePhase(const RvHNMSynthesizerParameter *param, RvReal basePhase, RvReal f0, RvReal nextF0)
+  {
+    RvReal freq;
+    if(f0 > 0.0 && nextF0 > 0.0)
+      freq = (f0 + nextF0) * 0.5;
+    else
+      freq = std::max(0.0, std::max(f0, nextF0));
+    return basePhase + 2.0 * M_PI * freq * param->hopSize / param->samprate;
+  }
+
+  void hnmHopHarmonic(const RvHNMSynthesizerParameter *param, int maxHar, RvReal f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, RvReal sinusoidEnergy, RvReal basePhase, RvReal *freq, RvReal *amp, RvReal *phase)
+  {
+    RvReal maxFreq = std::min(param->mvf, param->samprate / 2.0);
+    RvReal power = 0.0;
+    for(int iHar = 0; iHar < maxHar; ++iHar)
+    {
+      freq[iHar] = amp[iHar] = phase[iHar] = 0.0;
+      if(f0 <= 0.0 || sinusoidEnergy <= 0.0)
+        continue;
+      RvReal ratio = hFreq[iHar] * (iHar + 1);
+      RvReal harFreq = ratio * f0;
+      if(harFreq <= 0.0 || harFreq >= maxFreq || hAmp[iHar] <= 0.0)
+        continue;
+      freq[iHar] = harFreq;
+      amp[iHar] = hAmp[iHar];
+      phase[iHar] = hPhase[iHar] + std::fmod(ratio * basePhase, 2.0 * M_PI);
+      power += hAmp[iHar] * hAmp[iHar] * 0.5;
+    }
+    if(power <= 0.0)
+      return;
+    RvReal gain = std::sqrt(sinusoidEnergy / power);
+    for(int iHar = 0; iHar < maxHar; ++iHar)
+      amp[iHar] *= gain;
+  }
+
+  void hnmHoldHop(const RvHNMSynthesizerParameter *param, int maxHar, const RvReal *phase, const RvReal *freq, RvReal *nextPhase)
+  {
+    for(int iHar = 0; iHar < maxHar; ++iHar)
+      nextPhase[iHar] = phase[iHar] + 2.0 * M_PI * freq[iHar] * param->hopSize / param->samprate;
+  }
+
+  int hnmSegmentScratchSize(const RvHNMSynthesizerParameter *param, int maxHar)
+  { return paddedHarmonicCount(maxHar) * 6 + param->hopSize * 2; }
+
+  // harmonics present on both sides take the frequency closest to their mean that ends on the next phase
+  // the others keep their frequency and fade in or out
+  void hnmRenderSegment(const RvHNMSynthesizerParameter *param, int maxHar, const RvReal *freq, const RvReal *amp, const RvReal *phase, const RvReal *nextFreq, const RvReal *nextAmp, const RvReal *nextPhase, RvReal *scratch, RvReal *out)
+  {
+    int n = param->hopSize;
+    RvReal sr = param->samprate;
+    int nPadded = paddedHarmonicCount(maxHar);
+    RvReal *re = scratch, *im = re + nPadded;
+    RvReal *stepRe = im + nPadded, *stepIm = stepRe + nPadded;
+    RvReal *oscAmp = stepIm + nPadded, *dAmp = oscAmp + nPadded;
+    RvReal *acc = dAmp + nPadded;
+
+    int nOsc = 0;
+    for(int iHar = 0; iHar < maxHar; ++iHar)
+    {
+      bool curr = amp[iHar] > 0.0, next = nextAmp[iHar] > 0.0;
+      if(!curr && !next)
+        continue;
+      RvReal omega, beginPhase;
+      if(curr && next)
+      {
+        RvReal meanOmega = M_PI * (freq[iHar] + nextFreq[iHar]) / sr;
+        RvReal nCycle = std::nearbyint((phase[iHar] + meanOmega * n - nextPhase[iHar]) / (2.0 * M_PI));
+        omega = (nextPhase[iHar] + 2.0 * M_PI * nCycle - phase[iHar]) / n;
+        beginPhase = phase[iHar];
+      }
+      else if(curr)
+      {
+        omega = 2.0 * M_PI * freq[iHar] / sr;
+        beginPhase = phase[iHar];
+      }
+      else
+      {
+        omega = 2.0 * M_PI * nextFreq[iHar] / sr;
+        beginPhase = nextPhase[iHar] - omega * n;
+      }
+      re[nOsc] = std::cos(beginPhase);
+      im[nOsc] = std::sin(beginPhase);
+      stepRe[nOsc] = std::cos(omega);
+      stepIm[nOsc] = std::sin(omega);
+      oscAmp[nOsc] = amp[iHar];
+      dAmp[nOsc] = (nextAmp[iHar] - amp[iHar]) / n;
+      ++nOsc;
+    }
+    int nGroup = paddedHarmonicCount(nOsc);
+    for(int i = nOsc; i < nGroup; ++i)
+    {
+      re[i] = stepRe[i] = 1.0;
+      im[i] = stepIm[i] = 0.0;
+      oscAmp[i] = dAmp[i] = 0.0;
+    }
+    runOscillatorBank(re, im, stepRe, stepIm, oscAmp, dAmp, nGroup, n, acc, out);
+  }
+
+  RvRTHNMSynthesizer *layoutRTHNMSynthesizer(Arena &arena, const RvHNMSynthesizerParameter *param, int maxHar)
+  {
+    rvAssert(param, "param cannot be nullptr");
+    rvAssert(param->samprate > 0.0, "samprate must be greater than 0");
+    rvAssert(param->hopSize > 0, "hopSize must be greater than 0");
+    rvAssert(maxHar >= 0, "maxHar cannot be less than 0");
+    auto self = arena.construct<RvRTHNMSynthesizer>();
+    RvReal *hopList[6];
+    for(auto &hop : hopList)
+      hop = arena.take<RvReal>(std::max(1, maxHar));
+    auto scratch = arena.take<RvReal>(hnmSegmentScratchSize(param, maxHar));
+    if(arena.isMeasuring())
+      return nullptr;
+
+    self->param = *param;
+    self->maxHar = maxHar;
+    self->freq = hopList[0];
+    self->amp = hopList[1];
+    self->phase = hopList[2];
+    self->nextFreq = hopList[3];
+    self->nextAmp = hopList[4];
+    self->nextPhase = hopList[5];
+    self->scratch = scratch;
+    self->ownsMemory = false;
+    rvResetRTHNMSynthesizer(self);
+    return self;
+  }
+} // namespace ReVoice
+
+RvRTHNMSynthesizer *rvCreateRTHNMSynthesizer(const RvHNMSynthesizerParameter *param, int maxHar)
+{
+  Arena measure;
+  layoutRTHNMSynthesizer(measure, param, maxHar);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTHNMSynthesizer(arena, param, maxHar);
+  self->ownsMemory = true;
+  return self;
+}
+
+size_t rvRTHNMSynthesizerRequiredSize(const RvHNMSynthesizerParameter *param, int maxHar)
+{
+  Arena measure;
+  layoutRTHNMSynthesizer(measure, param, maxHar);
+  return measure.size();
+}
+
+RvRTHNMSynthesizer *rvInitRTHNMSynthesizerInPlace(void *mem, const RvHNMSynthesizerParameter *param, int maxHar)
+{
+  Arena arena = Arena::inPlace(mem);
+  return layoutRTHNMSynthesizer(arena, param, maxHar);
+}
+
+int rvCallRTHNMSynthesizer(RvRTHNMSynthesizer *self, RvReal f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, RvReal sinusoidEnergy, RvReal *out)
+{
+  rvAssert(self, "synth cannot be nullptr");
+  rvAssert(!hFreq || ((hAmp && hPhase) || self->maxHar == 0), "hAmp and hPhase cannot be nullptr");
+  rvAssert(out, "out cannot be nullptr");
+  auto param = &self->param;
+  int maxHar = self->maxHar;
+
+  if(!hFreq)
+  {
+    if(!self->hasHop)
+      return 0;
+    hnmHoldHop(param, maxHar, self->phase, self->freq, self->nextPhase);
+    hnmRenderSegment(param, maxHar, self->freq, self->amp, self->phase, self->freq, self->amp, self->nextPhase, self->scratch, out);
+    rvResetRTHNMSynthesizer(self);
+    return param->hopSize;
+  }
+
+  if(!self->hasHop)
+  {
+    hnmHopHarmonic(param, maxHar, f0, hFreq, hAmp, hPhase, sinusoidEnergy, self->basePhase, self->freq, self->amp, self->phase);
+    self->f0 = f0;
+    self->hasHop = true;
+    return 0;
+  }
+  self->basePhase = hnmNextBasePhase(param, self->basePhase, self->f0, f0);
+  hnmHopHarmonic(param, maxHar, f0, hFreq, hAmp, hPhase, sinusoidEnergy, self->basePhase, self->nextFreq, self->nextAmp, self->nextPhase);
+  hnmRenderSegment(param, maxHar, self->freq, self->amp, self->phase, self->nextFreq, self->nextAmp, self->nextPhase, self->scratch, out);
+  std::swap(self->freq, self->nextFreq);
+  std::swap(self->amp, self->nextAmp);
+  std::swap(self->phase, self->nextPhase);
+  self->f0 = f0;
+  return param->hopSize;
+}
+
+void rvResetRTHNMSynthesizer(RvRTHNMSynthesizer *self)
+{
+  rvAssert(self, "synth cannot be nullptr");
+  self->f0 = 0.0;
+  self->basePhase = 0.0;
+  self->hasHop = false;
+}
+
+void rvDestroyRTHNMSynthesizer(RvRTHNMSynthesizer *self)
+{
+  rvAssert(self, "synth cannot be nullptr");
+  if(self->ownsMemory)
+    rvFree(self);
+}
\ No newline at end of file
@@ -0,0 +1,408 @@
+#include "../rtmononote.h"
+
+#include "util_p.hpp"
+#include "../rtpyin.h"
+#include "../rthmm.h"
+#include "../rtenergy.h"
+#include "stage_p.hpp"
+
+using namespace ReVoice;
+
+// state % 3 is 0 for attack, 1 for stable and 2 for silent
+// possible transitions are attack -> attack, attack -> stable, stable -> stable, stable -> silent, silent -> silent, silent -> attack
+enum
+{
+  AttackState = 0,
+  StableState,
+  SilentState
+};
+
+typedef struct RvRTMonoNoteProcessor
+{
+  RvRTMonoNoteProcessorParameter param;
+  RvRTSparseHMM *hmmModel;
+  RvRTEnergyTracker *energyTracker;
+  RvReal *obsTemp;
+  RvReal *candidateTemp, *candidatePitchTemp, *candidateWeightTemp;
+
+  // decodeTemp holds the current decode of the last historyUsed frames
+  // a frame is final once it is the oldest one of a full window
+  int *decodeTemp;
+  int historyUsed, nFrame, nFinal;
+  int nState, nBin;
+
+  // note tracking over final frames
+  RvReal notePitch;
+  int noteBegin, lastStateKind;
+  bool noteActive, flushed;
+} RvRTMonoNoteProcessor;
+
+static inline RvReal freqToSemitone(RvReal freq)
+{ return std::log2(freq / 440.0) * 12.0 + 69.0; }
+
+static inline RvReal normPdf(RvReal x, RvReal loc, RvReal scale)
+{
+  RvReal z = (x - loc) / scale;
+  return std::exp(-0.5 * z * z) / (scale * 2.5066282746310002);
+}
+
+RvRTMonoNoteProcessorParameter *rvCreateRTMonoNoteProcessorParameter(int hopSize, int minSemitone, int nSemitone)
+{
+  rvAssert(hopSize > 0, "invalid hopSize");
+  rvAssert(nSemitone > 0, "invalid nSemitone");
+
+  auto p = new RvRTMonoNoteProcessorParameter;
+  p->hopSize = hopSize;
+  p->minSemitone = minSemitone;
+  p->nSemitone = nSemitone;
+
+  p->binPerSemitone = 5;
+  p->probAttackTransSelf = 0.9;
+  p->probStableTransSelf = 0.99;
+  p->probSilentTransSelf = 0.9999;
+  p->probStableToSilent = 0.1;
+  p->noteSigma = 0.7;
+  p->priorPitchedProb = 0.7;
+  p->priorWeight = 0.5;
+  p->minTransSemitone = 0.5;
+  p->maxTransSemitone = 13.0;
+  p->yinAttackSigma = 5.0;
+  p->yinStableSigma = 0.8;
+  p->yinTrust = 0.1;
+  p->maxObsLength = 128;
+  p->maxCandidate = 128;
+
+  return p;
+}
+
+RvRTMonoNoteProcessorParameter *rvCreateRTMonoNoteProcessorParameterFromRTPYin(const RvRTPYinProcessorParameter *param)
+{
+  int minSemitone = static_cast<int>(freqToSemitone(param->minFreq));
+  int nSemitone = static_cast<int>(std::ceil(freqToSemitone(param->maxFreq))) - minSemitone;
+  return rvCreateRTMonoNoteProcessorParameter(param->hopSize, minSemitone, nSemitone);
+}
+
+void rvDestroyRTMonoNoteProcessorParameter(RvRTMonoNoteProcessorParameter *param)
+{
+  rvAssert(param, "param cannot be nullptr");
+  delete param;
+}
+
+static RvSparseHMM *buildModel(const RvRTMonoNoteProcessorParameter &p)
+{
+  int nBin = p.nSemitone * p.binPerSemitone;
+  // rounds half to even like the reference implementation, 0.5 semitone * 5 bins must give 2
+  int minTransBin = static_cast<int>(std::nearbyint(p.minTransSemitone * static_cast<RvReal>(p.binPerSemitone)));
+  int maxTransBin = static_cast<int>(std::nearbyint(p.maxTransSemitone * static_cast<RvReal>(p.binPerSemitone)));
+
+  // silent -> attack only goes to bins in [iBin - maxTransBin + 1, iBin + maxTransBin - 1] except those within minTransBin
+  int nState = nBin * 3;
+  int nTrans = nBin * 5;
+  for(int iBin = 0; iBin < nBin; ++iBin)
+  {
+    int begin = std::max(0, iBin - maxTransBin + 1);
+    int end = std::min(nBin - 1, iBin + maxTransBin);
+    for(int jBin = begin; jBin < end; ++jBin)
+    {
+      int distance = std::abs(iBin - jBin);
+      if(distance > minTransBin || distance == 0)
+        ++nTrans;
+    }
+  }
+
+  auto init = RVALLOC(RvReal, nState);
+  auto frm = RVALLOC(int, nTrans);
+  auto to = RVALLOC(int, nTrans);
+  auto transProb = RVALLOC(RvReal, nTrans);
+
+  // only start from silent state
+  std::fill(init, init + nState, 0.0);
+  for(int iBin = 0; iBin < nBin; ++iBin)
+    init[iBin * 3 + SilentState] = 1.0 / static_cast<RvReal>(nBin);
+
+  int iA = 0;
+  for(int iBin = 0; iBin < nBin; ++iBin)
+  {
+    int idx = iBin * 3;
+
+    // trans to self
+    frm[iA] = idx;
+    to[iA] = idx;
+    transProb[iA] = p.probAttackTransSelf;
+
+    frm[iA + 1] = idx;
+    to[iA + 1] = idx + 1;
+    transProb[iA + 1] = 1.0 - p.probAttackTransSelf;
+
+    frm[iA + 2] = idx + 1;
+    to[iA + 2] = idx + 1;
+    transProb[iA + 2] = p.probStableTransSelf;
+
+    frm[iA + 3] = idx + 1;
+    to[iA + 3] = idx + 2;
+    transProb[iA + 3] = p.probStableToSilent;
+
+    frm[iA + 4] = idx + 2;
+    to[iA + 4] = idx + 2;
+    transProb[iA + 4] = p.probSilentTransSelf;
+
+    iA += 5;
+
+    // silent to attack
+    int beginIA = iA;
+    RvReal silentProbSum = 0.0;
+    int begin = std::max(0, iBin - maxTransBin + 1);
+    int end = std::min(nBin - 1, iBin + maxTransBin);
+    for(int jBin = begin; jBin < end; ++jBin)
+    {
+      int distance = std::abs(iBin - jBin);
+      if(distance > minTransBin || distance == 0)
+      {
+        RvReal prob = normPdf(static_cast<RvReal>(distance) / static_cast<RvReal>(p.binPerSemitone), 0.0, p.noteSigma);
+        silentProbSum += prob;
+        frm[iA] = idx + 2;
+        to[iA] = jBin * 3;
+        transProb[iA] = (1.0 - p.probSilentTransSelf) * prob;
+        ++iA;
+      }
+    }
+    for(int i = beginIA; i < iA; ++i)
+      transProb[i] /= silentProbSum;
+  }
+  rvAssert(iA == nTrans, "internal error");
+
+  auto model = rvCreateSparseHMM(init, frm, to, transProb, nState, nTrans);
+  rvFree(transProb);
+  rvFree(to);
+  rvFree(frm);
+  rvFree(init);
+  return model;
+}
+
+RvRTMonoNoteProcessor *rvCreateRTMonoNoteProcessor(const RvRTMonoNoteProcessorParameter *param)
+{
+  rvAssert(param, "param cannot be nullptr");
+  rvAssert(param->hopSize > 0, "invalid hopSize");
+  rvAssert(param->nSemitone > 0, "invalid nSemitone");
+  rvAssert(param->binPerSemitone > 0, "invalid binPerSemitone");
+  rvAssert(param->probAttackTransSelf >= 0.0 && param->probAttackTransSelf <= 1.0, "invalid probAttackTransSelf");
+  rvAssert(param->probStableTransSelf >= 0.0 && param->probStableTransSelf <= 1.0, "invalid probStableTransSelf");
+  rvAssert(param->probSilentTransSelf >= 0.0 && param->probSilentTransSelf <= 1.0, "invalid probSilentTransSelf");
+  rvAssert(param->probStableToSilent >= 0.0 && param->probStableToSilent <= 1.0, "invalid probStableToSilent");
+  rvAssert(param->noteSigma > 0.0, "invalid noteSigma");
+  rvAssert(param->priorPitchedProb >= 0.0 && param->priorPitchedProb <= 1.0, "invalid priorPitchedProb");
+  rvAssert(param->priorWeight >= 0.0 && param->priorWeight <= 1.0, "invalid priorWeight");
+  rvAssert(param->minTransSemitone >= 0.0 && param->maxTransSemitone > param->minTransSemitone, "invalid minTransSemitone or maxTransSemitone");
+  rvAssert(param->yinAttackSigma > 0.0 && param->yinStableSigma > 0.0, "invalid yinAttackSigma or yinStableSigma");
+  rvAssert(param->yinTrust >= 0.0, "invalid yinTrust");
+  rvAssert(param->maxObsLength > 0, "invalid maxObsLength");
+  rvAssert(param->maxCandidate > 0, "invalid maxCandidate");
+
+  auto self = new RvRTMonoNoteProcessor;
+  self->param = *param;
+
+  {
+    RvSparseHMM *model = buildModel(*param);
+    self->hmmModel = rvCreateRTSparseHMMFromModel(model, param->maxObsLength);
+    self->nState = rvSparseHMMNState(model);
+    rvReleaseSparseHMM(model);
+  }
+  self->nBin = param->nSemitone * param->binPerSemitone;
+
+  // energy of the 2 * hopSize frame, thresholds are unused
+  self->energyTracker = rvCreateRTEnergyTracker(param->hopSize, 2, 0.0, 0.0);
+  self->obsTemp = RVALLOC(RvReal, self->nState);
+  self->candidateTemp = RVALLOC(RvReal, param->maxCandidate * 2);
+  self->candidatePitchTemp = RVALLOC(RvReal, param->maxCandidate);
+  self->candidateWeightTemp = RVALLOC(RvReal, param->maxCandidate);
+  self->decodeTemp = RVALLOC(int, param->maxObsLength);
+  self->historyUsed = 0;
+  self->nFrame = 0;
+  self->nFinal = 0;
+
+  self->notePitch = 0.0;
+  self->noteBegin = 0;
+  self->lastStateKind = SilentState;
+  self->noteActive = false;
+  self->flushed = false;
+  return self;
+}
+
+const RvRTMonoNoteProcessorParameter *rvRTMonoNoteParam(const RvRTMonoNoteProcessor *self)
+{ return &(self->param); }
+
+int rvMonoNoteMaxOutputLength(const RvRTMonoNoteProcessor *self)
+{ return self->param.maxObsLength / 2 + 1; }
+
+// returns the state kind of the newest frame in the current decode, or -1 before the first frame
+int rvMonoNoteCurrentState(const RvRTMonoNoteProcessor *self, RvReal *pitch)
+{
+  if(self->historyUsed == 0)
+    return -1;
+  int state = self->decodeTemp[self->historyUsed - 1];
+  if(pitch)
+    *pitch = static_cast<RvReal>(state / 3) / static_cast<RvReal>(self->param.binPerSemitone) + static_cast<RvReal>(self->param.minSemitone);
+  return state % 3;
+}
+
+static void calcStateProb(RvRTMonoNoteProcessor *self, const RvReal *obsProb, int nObsProb, RvReal meanEnergy)
+{
+  auto &p = self->param;
+  int nBin = self->nBin;
+  RvReal *out = self->obsTemp;
+
+  RvReal probYinSum = 0.0;
+  for(int i = 0; i < nObsProb; ++i)
+    probYinSum += obsProb[i * 2 + 1];
+  RvReal probPitched = probYinSum * (1.0 - p.priorWeight) + p.priorPitchedProb * p.priorWeight;
+
+  RvReal probSum;
+  if(nObsProb > 0)
+  {
+    for(int i = 0; i < nObsProb; ++i)
+    {
+      self->candidatePitchTemp[i] = freqToSemitone(obsProb[i * 2]);
+      self->candidateWeightTemp[i] = std::pow(obsProb[i * 2 + 1], p.yinTrust);
+    }
+    probSum = 0.0;
+    for(int iBin = 0; iBin < nBin; ++iBin)
+    {
+      RvReal pitch = static_cast<RvReal>(p.minSemitone) + static_cast<RvReal>(iBin) / static_cast<RvReal>(p.binPerSemitone);
+      int iBest = 0;
+      RvReal bestDistance = std::abs(self->candidatePitchTemp[0] - pitch);
+      for(int i = 1; i < nObsProb; ++i)
+      {
+        RvReal distance = std::abs(self->candidatePitchTemp[i] - pitch);
+        if(distance < bestDistance)
+        {
+          bestDistance = distance;
+          iBest = i;
+        }
+      }
+      RvReal attackProb = self->candidateWeightTemp[iBest] * normPdf(self->candidatePitchTemp[iBest], pitch, p.yinAttackSigma);
+      probSum += attackProb;
+      RvReal stableProb = self->candidateWeightTemp[iBest] * normPdf(self->candidatePitchTemp[iBest], pitch, p.yinStableSigma);
+      probSum += stableProb;
+      out[iBin * 3 + AttackState] = attackProb;
+      out[iBin * 3 + StableState] = stableProb;
+    }
+  }
+  else
+  {
+    probSum = 2.0 * static_cast<RvReal>(nBin);
+    for(int iBin = 0; iBin < nBin; ++iBin)
+    {
+      out[iBin * 3 + AttackState] = 1.0;
+      out[iBin * 3 + StableState] = 1.0;
+    }
+  }
+
+  RvReal scale = probSum > 0.0 ? probPitched / probSum : 1.0;
+  RvReal energyProb = meanEnergy / static_cast<RvReal>(nBin) / 2.0;
+  probPitched = std::min(probPitched + meanEnergy, 0.9999);
+  RvReal silentProb = (1.0 - probPitched) / static_cast<RvReal>(nBin);
+  for(int iBin = 0; iBin < nBin; ++iBin)
+  {
+    out[iBin * 3 + AttackState] = out[iBin * 3 + AttackState] * scale + energyProb;
+    out[iBin * 3 + StableState] = out[iBin * 3 + StableState] * scale + energyProb;
+    out[iBin * 3 + SilentState] = silentProb;
+  }
+}
+
+static int trackFrame(RvRTMonoNoteProcessor *self, int iFrame, int state, RvRTMonoNoteEvent *out)
+{
+  int nOut = 0;
+  int kind = state % 3;
+  if(kind == AttackState)
+  {
+    self->noteActive = true;
+    self->noteBegin = iFrame;
+    self->notePitch = static_cast<RvReal>(state / 3) / static_cast<RvReal>(self->param.binPerSemitone) + static_cast<RvReal>(self->param.minSemitone);
+  }
+  else if(kind == SilentState && self->lastStateKind == StableState && self->noteActive)
+  {
+    out[0].pitch = self->notePitch;
+    out[0].begin = self->noteBegin;
+    out[0].end = iFrame + 1;
+    self->noteActive = false;
+    nOut = 1;
+  }
+  self->lastStateKind = kind;
+  return nOut;
+}
+
+// x is the 2 * hopSize frame centered at the current hop, like rvCallRTMonoPitch
+// returns the number of notes that became final, a frame is final after maxObsLength - 1 more hops
+// only the maxCandidate most probable (freq, prob) pairs of obsProb are used
+int rvCallRTMonoNote(RvRTMonoNoteProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, RvRTMonoNoteEvent *out)
+{
+  rvAssert(!self->flushed, "processor has been flushed");
+  rvAssert(x, "x cannot be nullptr");
+  rvAssert(obsProb || nObsProb == 0, "obsProb cannot be nullptr with non-zero nObsProb");
+  rvAssert(nObsProb >= 0, "nObsProb cannot be negative");
+  rvAssert(out, "out cannot be nullptr");
+
+  auto &p = self->param;
+  if(nObsProb > p.maxCandidate)
+  {
+    nObsProb = keepProbableCandidate(obsProb, nObsProb, p.maxCandidate, self->candidateTemp);
+    obsProb = self->candidateTemp;
+  }
+  if(self->nFrame == 0)
+    rvCallRTEnergyTracker(self->energyTracker, x, p.hopSize);
+  rvCallRTEnergyTracker(self->energyTracker, x + p.hopSize, p.hopSize);
+  calcStateProb(self, obsProb, nObsProb, rvRTEnergyTrackerEnergy(self->energyTracker));
+  rvRTSparseHMMFeed(self->hmmModel, self->obsTemp);
+
+  // keep decodeTemp aligned with the window of the new hop
+  if(self->historyUsed == p.maxObsLength)
+    std::copy(self->decodeTemp + 1, self->decodeTemp + p.maxObsLength, self->decodeTemp);
+  self->historyUsed = std::min(self->historyUsed + 1, p.maxObsLength);
+  ++self->nFrame;
+  rvRTSparseHMMViterbiDecodeUpdate(self->hmmModel, self->decodeTemp, self->historyUsed);
+
+  int nOut = 0;
+  if(self->historyUsed == p.maxObsLength)
+  {
+    int iFrame = self->nFrame - self->historyUsed;
+    nOut += trackFrame(self, iFrame, self->decodeTemp[0], out + nOut);
+    self->nFinal = iFrame + 1;
+  }
+  return nOut;
+}
+
+// finalizes every remaining frame, a note still sounding ends at the last frame
+// the processor cannot be fed after flushing
+int rvFlushRTMonoNote(RvRTMonoNoteProcessor *self, RvRTMonoNoteEvent *out)
+{
+  rvAssert(!self->flushed, "processor has been flushed");
+  rvAssert(out, "out cannot be nullptr");
+
+  int nOut = 0;
+  int iFirstFrame = self->nFrame - self->historyUsed;
+  for(int iFrame = self->nFinal; iFrame < self->nFrame; ++iFrame)
+    nOut += trackFrame(self, iFrame, self->decodeTemp[iFrame - iFirstFrame], out + nOut);
+  self->nFinal = self->nFrame;
+  if(self->noteActive)
+  {
+    out[nOut].pitch = self->notePitch;
+    out[nOut].begin = self->noteBegin;
+    out[nOut].end = self->nFrame - 1;
+    self->noteActive = false;
+    ++nOut;
+  }
+  self->flushed = true;
+  return nOut;
+}
+
+void rvDestroyRTMonoNoteProcessor(RvRTMonoNoteProcessor *self)
+{
+  rvFree(self->decodeTemp);
+  rvFree(self->candidateWeightTemp);
+  rvFree(self->candidatePitchTemp);
+  rvFree(self->candidateTemp);
+  rvFree(self->obsTemp);
+  rvDestroyRTEnergyTracker(self->energyTracker);
+  rvDestroyRTSparseHMM(self->hmmModel);
+  delete self;
+}
\ No newline at end of file
@@ -3,7 +3,16 @@
 #include "util_p.hpp"
 #include "../rtpyin.h"
 #include "../rthmm.h"
+#include "../rtenergy.h"
+#include "hmm_p.hpp"
+#include "layout_p.hpp"
+#include "pool_p.hpp"
+#include "stage_p.hpp"
 #include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <limits>
 
 using namespace ReVoice;
 
@@ -11,14 +20,32 @@ typedef struct RvRTMonoPitchProcessor
 {
   RvRTMonoPitchProcessorParameter param;
   RvRTSparseHMM *hmmModel;
-  RvReal *obsTemp;
+  RvRTEnergyTracker *energyTracker;
+  RvReal *obsTemp, *candidateTemp;
   int *decodeTemp;
-  std::vector<std::vector<std::pair<RvReal, RvReal>>> obsProbList;
-  std::vector<bool> obsSilentList;
+
+  // ring of the last maxObsLength hops, historyHead is the slot of the newest one
+  RvReal *obsFreqList;
+  int *obsCountList;
+  int historyHead, historyUsed;
   int nState, nTrans;
 
+  // binFreqList[i] is the center frequency of bin i, binEdgeList[i] is the bound between bin i and i + 1
+  RvReal *binFreqList, *binEdgeList;
+  RvReal maxFreq, binRatio;
+
+  // per-frame rings indexed by iFrame % frameRingSize, covering the history plus the widest voiced onset extension
+  // raw and emitted values are only valid from deltaBegin, rvCallRTMonoPitch invalidates them
+  RvReal *rawFreqList, *emittedFreqList, *processedTemp;
+  bool *silentList;
+  int maxFrameOffset, frameRingSize;
+  int nFrame, deltaBegin;
+  bool ownsMemory;
 } RvRTMonoPitchProcessor;
 
+typedef struct RvRTMonoPitchProcessorPool : ProcessorPool<RvRTMonoPitchProcessor>
+{} RvRTMonoPitchProcessorPool;
+
 RvRTMonoPitchProcessorParameter *rvCreateRTMonoPitchProcessorParameter(int hopSize, RvReal samprate, int nSemitone, RvReal maxTransSemitone, RvReal minFreq)
 {
   RvReal nyq = samprate / 2.0;
@@ -39,7 +66,10 @@ RvRTMonoPitchProcessorParameter *rvCreateRTMonoPitchProcessorParameter(int hopSi
   p->transSelf = 0.999;
   p->yinTrust = 0.5;
   p->energyThreshold = 1e-8;
+  p->viterbiBeam = 0.0;
+  p->energyHysteresis = 1.0;
   p->maxObsLength = 128;
+  p->maxCandidate = 128;
 
   return p;
 }
@@ -60,7 +90,214 @@ void rvDestroyRTMonoPitchProcessorParameter(RvRTMonoPitchProcessorParameter *par
   delete param;
 }
 
-RvRTMonoPitchProcessor *rvCreateRTMonoPitchProcessor(const RvRTMonoPitchProcessorParameter *param)
+// number of frames before an unvoiced->voiced bound that are marked as voiced
+static int calcOnsetFrameOffset(const RvRTMonoPitchProcessorParameter &p, RvReal freq)
+{
+  int windowSize = std::max(static_cast<int>(std::ceil(p.samprate / freq * 4.0)), p.hopSize * 2);
+  if(windowSize % 2 != 0)
+    windowSize += 1;
+  return static_cast<int>(std::round(static_cast<RvReal>(windowSize) / static_cast<RvReal>(p.hopSize * 2)));
+}
+
+static RvSparseHMM *buildModel(const RvRTMonoPitchProcessorParameter &p)
+{
+  int nBin = p.nSemitone * p.binPerSemitone;
+  int halfMaxTransBin = static_cast<int>(std::round(p.maxTransSemitone * static_cast<RvReal>(p.binPerSemitone) / 2.0));
+  int nState = 2 * nBin;
+  int nTrans = 4 * (nBin * (2 * halfMaxTransBin + 1) - halfMaxTransBin * (halfMaxTransBin + 1));
+
+  auto init = RVALLOC(RvReal, nState);
+  auto frm = RVALLOC(int, nTrans);
+  auto to = RVALLOC(int, nTrans);
+  auto transProb = RVALLOC(RvReal, nTrans);
+
+  std::fill(init, init + nState, 1.0 / static_cast<RvReal>(nState));
+  int iA = 0;
+  for(int iBin = 0; iBin < nBin; ++iBin)
+  {
+    int theoreticalMinNextBin = iBin - halfMaxTransBin;
+    int minNextBin = std::max(iBin - halfMaxTransBin, 0);
+    int maxNextBin = std::min(iBin + halfMaxTransBin, nBin - 1);
+    auto weight = [&](int i) { return i <= iBin ? (i - theoreticalMinNextBin + 1.0) : (iBin - theoreticalMinNextBin + 1.0 - (i - iBin)); };
+    RvReal weightSum = 0.0;
+    for(int i = minNextBin; i < maxNextBin + 1; ++i)
+      weightSum += weight(i);
+
+    // trans to close pitch
+    for(int i = minNextBin; i < maxNextBin + 1; ++i)
+    {
+      RvReal w = weight(i) / weightSum;
+      frm[iA] = iBin;
+      to[iA] = i;
+      transProb[iA] = w * p.transSelf;
+
+      frm[iA + 1] = iBin;
+      to[iA + 1] = i + nBin;
+      transProb[iA + 1] = w * (1.0 - p.transSelf);
+
+      frm[iA + 2] = iBin + nBin;
+      to[iA + 2] = i + nBin;
+      transProb[iA + 2] = w * p.transSelf;
+
+      frm[iA + 3] = iBin + nBin;
+      to[iA + 3] = i;
+      transProb[iA + 3] = w * (1.0 - p.transSelf);
+      iA += 4;
+    }
+  }
+  rvAssert(iA == nTrans, "internal error");
+
+  auto model = rvCreateSparseHMM(init, frm, to, transProb, nState, nTrans);
+  rvFree(transProb);
+  rvFree(to);
+  rvFree(frm);
+  rvFree(init);
+  return model;
+}
+
+// the cache only holds weak references, entries are erased by the model release hook
+// pinned models are strong references taken by rvPrebuildRTMonoPitchModel
+typedef std::tuple<int, int, RvReal, RvReal> ModelKey;
+static std::mutex g_modelCacheLock;
+static std::map<ModelKey, RvSparseHMM*> g_modelCache;
+static std::vector<RvSparseHMM*> g_pinnedModelList;
+
+static ModelKey modelKey(const RvRTMonoPitchProcessorParameter &p)
+{ return ModelKey(p.nSemitone, p.binPerSemitone, p.maxTransSemitone, p.transSelf); }
+
+static void onModelRelease(RvSparseHMM *model)
+{
+  std::unique_lock<std::mutex> locker(g_modelCacheLock);
+  for(auto it = g_modelCache.begin(); it != g_modelCache.end(); ++it)
+  {
+    if(it->second == model)
+    {
+      g_modelCache.erase(it);
+      break;
+    }
+  }
+}
+
+// returns a new reference
+// the model is built without the lock, a thread that loses the race to insert it adopts the winner's
+static RvSparseHMM *acquireModel(const RvRTMonoPitchProcessorParameter &p)
+{
+  ModelKey key = modelKey(p);
+  {
+    std::unique_lock<std::mutex> locker(g_modelCacheLock);
+    auto it = g_modelCache.find(key);
+    if(it != g_modelCache.end() && retainSparseHMMIfAlive(it->second))
+      return it->second;
+  }
+
+  RvSparseHMM *model = buildModel(p);
+  RvSparseHMM *adopted;
+  {
+    std::unique_lock<std::mutex> locker(g_modelCacheLock);
+    auto &entry = g_modelCache[key];
+    if(!entry || !retainSparseHMMIfAlive(entry))
+    {
+      entry = model;
+      entry->releaseHook = onModelRelease;
+      return entry;
+    }
+    adopted = entry;
+  }
+  // never in the cache, so it has no release hook
+  rvReleaseSparseHMM(model);
+  return adopted;
+}
+
+void rvPrebuildRTMonoPitchModel(const RvRTMonoPitchProcessorParameter *param)
+{
+  rvAssert(param, "param cannot be nullptr");
+  rvAssert(param->nSemitone > 0, "invalid nSemitone");
+  rvAssert(param->maxTransSemitone > 0.0, "invalid maxTransSemitone");
+  rvAssert(param->binPerSemitone > 0, "invalid binPerSemitone");
+  rvAssert(param->transSelf >= 0.0 && param->transSelf <= 1.0, "invalid transSelf");
+
+  RvSparseHMM *model = acquireModel(*param);
+  std::unique_lock<std::mutex> locker(g_modelCacheLock);
+  if(std::find(g_pinnedModelList.cbegin(), g_pinnedModelList.cend(), model) == g_pinnedModelList.cend())
+    g_pinnedModelList.push_back(model);
+  else
+  {
+    locker.unlock();
+    rvReleaseSparseHMM(model);
+  }
+}
+
+void rvReleaseRTMonoPitchModelCache()
+{
+  std::vector<RvSparseHMM*> pinnedModelList;
+  {
+    std::unique_lock<std::mutex> locker(g_modelCacheLock);
+    pinnedModelList.swap(g_pinnedModelList);
+  }
+  for(auto model : pinnedModelList)
+    rvReleaseSparseHMM(model);
+}
+
+// processor, its subobjects and buffers share one block, the model is referenced
+static RvRTMonoPitchProcessor *layoutRTMonoPitch(Arena &arena, const RvRTMonoPitchProcessorParameter &param, RvSparseHMM *model)
+{
+  int nBin = param.nSemitone * param.binPerSemitone;
+  int maxFrameOffset = calcOnsetFrameOffset(param, param.minFreq);
+  int frameRingSize = param.maxObsLength + maxFrameOffset;
+
+  auto self = arena.construct<RvRTMonoPitchProcessor>();
+  auto hmmModel = layoutRTSparseHMM(arena, model, param.maxObsLength);
+  // consecutive 2 * hopSize frames overlap by one hop, so the silence test only needs the newer half of each
+  auto energyTracker = layoutRTEnergyTracker(arena, param.hopSize, 2, param.energyThreshold, param.energyThreshold * param.energyHysteresis);
+  auto obsTemp = arena.take<RvReal>(model->nState);
+  auto candidateTemp = arena.take<RvReal>(param.maxCandidate * 2);
+  auto decodeTemp = arena.take<int>(param.maxObsLength);
+  auto obsFreqList = arena.take<RvReal>(param.maxObsLength * param.maxCandidate);
+  auto obsCountList = arena.take<int>(param.maxObsLength);
+  auto binFreqList = arena.take<RvReal>(nBin);
+  auto binEdgeList = arena.take<RvReal>(nBin);
+  auto rawFreqList = arena.take<RvReal>(frameRingSize);
+  auto emittedFreqList = arena.take<RvReal>(frameRingSize);
+  auto processedTemp = arena.take<RvReal>(frameRingSize);
+  auto silentList = arena.take<bool>(frameRingSize);
+  if(arena.isMeasuring())
+    return nullptr;
+
+  self->param = param;
+  self->hmmModel = hmmModel;
+  rvRTSparseHMMSetBeam(self->hmmModel, param.viterbiBeam);
+  self->nState = model->nState;
+  self->nTrans = model->nTrans;
+
+  self->energyTracker = energyTracker;
+  self->obsTemp = obsTemp;
+  self->candidateTemp = candidateTemp;
+  self->decodeTemp = decodeTemp;
+  self->obsFreqList = obsFreqList;
+  self->obsCountList = obsCountList;
+
+  RvReal binPerOctave = 12.0 * static_cast<RvReal>(param.binPerSemitone);
+  self->binFreqList = binFreqList;
+  self->binEdgeList = binEdgeList;
+  for(int i = 0; i < nBin; ++i)
+    self->binFreqList[i] = param.minFreq * std::pow(2.0, static_cast<RvReal>(i) / binPerOctave);
+  for(int i = 0; i < nBin - 1; ++i)
+    self->binEdgeList[i] = param.minFreq * std::pow(2.0, (static_cast<RvReal>(i) + 0.5) / binPerOctave);
+  self->maxFreq = param.minFreq * std::pow(2.0, static_cast<RvReal>(param.nSemitone) / 12.0);
+  self->binRatio = std::pow(2.0, 1.0 / binPerOctave);
+
+  self->maxFrameOffset = maxFrameOffset;
+  self->frameRingSize = frameRingSize;
+  self->rawFreqList = rawFreqList;
+  self->emittedFreqList = emittedFreqList;
+  self->processedTemp = processedTemp;
+  self->silentList = silentList;
+  self->ownsMemory = false;
+  rvResetRTMonoPitchProcessor(self);
+  return self;
+}
+
+static void checkParameter(const RvRTMonoPitchProcessorParameter *param)
 {
   rvAssert(param, "param cannot be nullptr");
   RvReal nyq = param->samprate / 2.0;
@@ -73,69 +310,61 @@ RvRTMonoPitchProcessor *rvCreateRTMonoPitchProcessor(const RvRTMonoPitchProcesso
   rvAssert(param->transSelf >= 0.0 && param->transSelf <= 1.0, "invalid transSelf");
   rvAssert(param->yinTrust >= 0.0 && param->yinTrust <= 1.0, "invalid yinTrust");
   rvAssert(param->energyThreshold >= 0.0, "invalid energyThreshold");
+  rvAssert(param->energyHysteresis >= 1.0, "invalid energyHysteresis");
+  rvAssert(!std::isnan(param->viterbiBeam), "invalid viterbiBeam");
   rvAssert(param->maxObsLength > 0, "invalid maxObsLength");
+  rvAssert(param->maxCandidate > 0, "invalid maxCandidate");
+}
 
-  auto self = new RvRTMonoPitchProcessor;
-  self->param = *param;
+namespace ReVoice
+{
+  RvRTMonoPitchProcessor *layoutRTMonoPitchProcessor(Arena &arena, const RvRTMonoPitchProcessorParameter *param, RvSparseHMM *model)
+  {
+    checkParameter(param);
+    return layoutRTMonoPitch(arena, *param, model);
+  }
 
-  // create model
+  RvSparseHMM *acquireMonoPitchModel(const RvRTMonoPitchProcessorParameter *param)
   {
-    int nBin = param->nSemitone * param->binPerSemitone;
-    int halfMaxTransBin = static_cast<int>(std::round(param->maxTransSemitone * static_cast<RvReal>(param->binPerSemitone) / 2.0));
-    int nState = 2 * nBin;
-    int nTrans = 4 * (nBin * (2 * halfMaxTransBin + 1) - halfMaxTransBin * (halfMaxTransBin + 1));
-
-    auto init = RVALLOC(RvReal, nState);
-    auto frm = RVALLOC(int, nTrans);
-    auto to = RVALLOC(int, nTrans);
-    auto transProb = RVALLOC(RvReal, nTrans);
-
-    std::fill(init, init + nState, 1.0 / static_cast<RvReal>(nState));
-    int iA = 0;
-    for(int iBin = 0; iBin < nBin; ++iBin)
-    {
-      int theoreticalMinNextBin = iBin - halfMaxTransBin;
-      int minNextBin = std::max(iBin - halfMaxTransBin, 0);
-      int maxNextBin = std::min(iBin + halfMaxTransBin, nBin - 1);
-      std::vector<RvReal> weights(maxNextBin - minNextBin + 1, 0.0);
-      for(int i = minNextBin; i < maxNextBin + 1; ++i)
-        weights[i - minNextBin] = i <= iBin ? (i - theoreticalMinNextBin + 1.0) : (iBin - theoreticalMinNextBin + 1.0 - (i - iBin));
-      RvReal weightSum = std::accumulate(weights.cbegin(), weights.cend(), 0.0);
-
-      // trans to close pitch
-      for(int i = minNextBin; i < maxNextBin + 1; ++i)
-      {
-        frm[iA] = iBin;
-        to[iA] = i;
-        transProb[iA] = weights[i - minNextBin] / weightSum * param->transSelf;
-
-        frm[iA + 1] = iBin;
-        to[iA + 1] = i + nBin;
-        transProb[iA + 1] = weights[i - minNextBin] / weightSum * (1.0 - param->transSelf);
-
-        frm[iA + 2] = iBin + nBin;
-        to[iA + 2] = i + nBin;
-        transProb[iA + 2] = weights[i - minNextBin] / weightSum * param->transSelf;
-
-        frm[iA + 3] = iBin + nBin;
-        to[iA + 3] = i;
-        transProb[iA + 3] = weights[i - minNextBin] / weightSum * (1.0 - param->transSelf);
-        iA += 4;
-      }
-    }
+    checkParameter(param);
+    return acquireModel(*param);
+  }
 
-    self->hmmModel = rvCreateRTSparseHMM(init, frm, to, transProb, nState, nTrans, param->maxObsLength);
-    self->nState = nState;
-    self->nTrans = nTrans;
+  int monoPitchOnsetFrameOffset(const RvRTMonoPitchProcessorParameter *param, RvReal freq)
+  { return calcOnsetFrameOffset(*param, freq); }
+} // namespace ReVoice
 
-    rvFree(transProb);
-    rvFree(to);
-    rvFree(frm);
-    rvFree(init);
-  }
+RvRTMonoPitchProcessor *rvCreateRTMonoPitchProcessor(const RvRTMonoPitchProcessorParameter *param)
+{
+  checkParameter(param);
+  // models are shared between processors with identical transition parameters
+  RvSparseHMM *model = acquireModel(*param);
+  Arena measure;
+  layoutRTMonoPitch(measure, *param, model);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTMonoPitch(arena, *param, model);
+  self->ownsMemory = true;
+  rvReleaseSparseHMM(model);
+  return self;
+}
 
-  self->obsTemp = RVALLOC(RvReal, self->nState);
-  self->decodeTemp = RVALLOC(int, param->maxObsLength);
+size_t rvRTMonoPitchProcessorRequiredSize(const RvRTMonoPitchProcessorParameter *param)
+{
+  checkParameter(param);
+  RvSparseHMM *model = acquireModel(*param);
+  Arena measure;
+  layoutRTMonoPitch(measure, *param, model);
+  rvReleaseSparseHMM(model);
+  return measure.size();
+}
+
+RvRTMonoPitchProcessor *rvInitRTMonoPitchProcessorInPlace(void *mem, const RvRTMonoPitchProcessorParameter *param)
+{
+  checkParameter(param);
+  Arena arena = Arena::inPlace(mem);
+  RvSparseHMM *model = acquireModel(*param);
+  auto self = layoutRTMonoPitch(arena, *param, model);
+  rvReleaseSparseHMM(model);
   return self;
 }
 
@@ -143,38 +372,43 @@ const RvRTMonoPitchProcessorParameter *rvRTMonoPitchParam(const RvRTMonoPitchPro
 { return &(self->param); }
 
 int rvMonoPitchNextOutputLength(const RvRTMonoPitchProcessor *self)
-{ return std::min(static_cast<int>(self->obsProbList.size() + 1), self->param.maxObsLength); }
+{ return std::min(self->historyUsed + 1, self->param.maxObsLength); }
+
+int rvMonoPitchMaxDeltaOutputLength(const RvRTMonoPitchProcessor *self)
+{ return self->frameRingSize; }
+
+int rvMonoPitchActiveStateCount(const RvRTMonoPitchProcessor *self)
+{ return rvRTSparseHMMActiveCount(self->hmmModel); }
+
+const RvSparseHMM *rvMonoPitchModel(const RvRTMonoPitchProcessor *self)
+{ return rvRTSparseHMMModel(self->hmmModel); }
 
 void rvMonoPitchDumpObsTemp(const RvRTMonoPitchProcessor *self, RvReal *out)
 { std::copy(self->obsTemp, self->obsTemp + self->nState, out); }
 
-int rvCallRTMonoPitch(RvRTMonoPitchProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, RvReal *out)
+namespace ReVoice
 {
-  rvAssert(x, "x cannot be nullptr");
-  rvAssert(obsProb || nObsProb == 0, "obsProb cannot be nullptr with non-zero nObsProb");
-  rvAssert(nObsProb >= 0, "invalid nObsProb");
-  rvAssert(out, "out cannot be nullptr");
-
-  auto &p = self->param;
-  int nBin = p.nSemitone * p.binPerSemitone;
-  int nState = self->nState;
-  RvReal maxFreq = p.minFreq * std::pow(2.0, static_cast<RvReal>(p.nSemitone) / 12.0);
-  // calc state prob
+  void monoPitchStateProb(const RvRTMonoPitchProcessor *self, const RvReal *obsProb, int nObsProb, RvReal *out)
   {
-    std::fill(self->obsTemp, self->obsTemp + self->nState, 0.0);
+    auto &p = self->param;
+    int nBin = p.nSemitone * p.binPerSemitone;
+    int nState = self->nState;
+
+    std::fill(out, out + nState, 0.0);
     RvReal probYinPitched = 0.0;
     for(int i = 0; i < nObsProb; ++i)
     {
       RvReal freq = obsProb[i * 2];
       RvReal prob = obsProb[i * 2 + 1];
-      if(freq < p.minFreq || freq > maxFreq)
+      if(freq < p.minFreq || freq > self->maxFreq)
       {
         if(freq <= 0.0)
           break;
         continue;
       }
-      int iBin = clip(0, static_cast<int>(std::round(std::log2(freq / p.minFreq) * 12.0 * static_cast<RvReal>(p.binPerSemitone))), nBin - 1);
-      self->obsTemp[iBin] = prob;
+      // nearest bin in log scale, i.e. the number of bounds below freq
+      int iBin = static_cast<int>(std::upper_bound(self->binEdgeList, self->binEdgeList + nBin - 1, freq) - self->binEdgeList);
+      out[iBin] = prob;
       probYinPitched += prob;
     }
     RvReal probReallyPitched = p.yinTrust * probYinPitched;
@@ -182,111 +416,256 @@ int rvCallRTMonoPitch(RvRTMonoPitchProcessor *self, const RvReal *x, const RvRea
     {
       RvReal v = probReallyPitched / probYinPitched;
       for(int i = 0; i < nBin; ++i)
-        self->obsTemp[i] *= v;
+        out[i] *= v;
     }
     RvReal v = (1.0 - probReallyPitched) / static_cast<RvReal>(nBin);
     for(int i = nBin; i < nState; ++i)
-      self->obsTemp[i] = v;
+      out[i] = v;
     for(int i = 0; i < nState; ++i)
-      self->obsTemp[i] = std::max(0.0, self->obsTemp[i]) + 1e-5;
+      out[i] = std::max(0.0, out[i]) + 1e-5;
   }
+} // namespace ReVoice
 
-  // feed and decode
-  int currObsLength = std::min(static_cast<int>(self->obsProbList.size() + 1), p.maxObsLength);
-  rvRTSparseHMMFeed(self->hmmModel, self->obsTemp);
-  
-  int nDecoded = rvRTSparseHMMViterbiDecode(self->hmmModel, self->decodeTemp, currObsLength);
-  rvAssert(nDecoded == currObsLength, "internal error");
-
-  // save state
-  bool isSilent;
+namespace ReVoice
+{
+  int keepProbableCandidate(const RvReal *obsProb, int nObsProb, int maxCandidate, RvReal *out)
   {
-    RvReal dcOffset = mean(x, p.hopSize * 2);
-    RvReal meanEnergy = 0.0;
-    for(int i = 0; i < p.hopSize * 2; ++i)
+    int nKept = 0;
+    for(int i = 0; i < nObsProb && nKept < maxCandidate; ++i)
     {
-      RvReal v = x[i] - dcOffset;
-      meanEnergy += v * v;
+      // candidates more probable than this one, ties go to the earlier one
+      RvReal prob = obsProb[i * 2 + 1];
+      int rank = 0;
+      for(int j = 0; j < nObsProb && rank < maxCandidate; ++j)
+      {
+        RvReal otherProb = obsProb[j * 2 + 1];
+        if(otherProb > prob || (otherProb == prob && j < i))
+          ++rank;
+      }
+      if(rank < maxCandidate)
+      {
+        out[nKept * 2] = obsProb[i * 2];
+        out[nKept * 2 + 1] = prob;
+        ++nKept;
+      }
     }
-    meanEnergy /= static_cast<RvReal>(p.hopSize * 2);
-    isSilent = meanEnergy < p.energyThreshold;
-  }
-  if(self->obsProbList.size() >= p.maxObsLength)
-  {
-    self->obsProbList.erase(self->obsProbList.begin());
-    self->obsSilentList.erase(self->obsSilentList.begin());
+    return nKept;
   }
-  rvAssert(self->obsProbList.size() < p.maxObsLength && self->obsProbList.size() == self->obsSilentList.size(), "internal error");
+} // namespace ReVoice
+
+static void calcStateProb(RvRTMonoPitchProcessor *self, const RvReal *obsProb, int nObsProb)
+{ monoPitchStateProb(self, obsProb, nObsProb, self->obsTemp); }
+
+static bool isSilentFrame(RvRTMonoPitchProcessor *self, const RvReal *x)
+{
+  int hopSize = self->param.hopSize;
+  if(self->nFrame == 0)
+    rvCallRTEnergyTracker(self->energyTracker, x, hopSize);
+  rvCallRTEnergyTracker(self->energyTracker, x + hopSize, hopSize);
+  return rvRTEnergyTrackerIsSilent(self->energyTracker);
+}
 
+// feeds one hop into the decoder and the history rings, returns the current observation length
+static int feedFrame(RvRTMonoPitchProcessor *self, bool isSilent, const RvReal *obsProb, int nObsProb)
+{
+  auto &p = self->param;
+  if(nObsProb > p.maxCandidate)
   {
-    std::vector<std::pair<RvReal, RvReal>> obsProbVec(nObsProb);
-    for(int i = 0; i < nObsProb; ++i)
-      obsProbVec[i] = std::make_pair(obsProb[i * 2], obsProb[i * 2 + 1]);
-    self->obsProbList.push_back(std::move(obsProbVec));
-    self->obsSilentList.push_back(isSilent);
+    nObsProb = keepProbableCandidate(obsProb, nObsProb, p.maxCandidate, self->candidateTemp);
+    obsProb = self->candidateTemp;
   }
+  calcStateProb(self, obsProb, nObsProb);
+  rvRTSparseHMMFeed(self->hmmModel, self->obsTemp);
 
-  // extract frequency from path
-  for(int iHop = 0; iHop < currObsLength; ++iHop)
+  int currObsLength = std::min(self->historyUsed + 1, p.maxObsLength);
+  self->historyHead = (self->historyHead + 1) % p.maxObsLength;
+  self->historyUsed = currObsLength;
+  RvReal *obsFreq = self->obsFreqList + self->historyHead * p.maxCandidate;
+  for(int i = 0; i < nObsProb; ++i)
+    obsFreq[i] = obsProb[i * 2];
+  self->obsCountList[self->historyHead] = nObsProb;
+  self->silentList[self->nFrame % self->frameRingSize] = isSilent;
+  ++self->nFrame;
+  return currObsLength;
+}
+
+namespace ReVoice
+{
+  RvReal monoPitchPathFreq(const RvRTMonoPitchProcessor *self, int state, const RvReal *obsFreq, int nObsFreq, int stride)
   {
-    RvReal bestFreq;
-    if(self->decodeTemp[iHop] < nBin)
+    auto &p = self->param;
+    int nBin = p.nSemitone * p.binPerSemitone;
+
+    if(state >= nBin)
+      return -self->binFreqList[state - nBin];
+    RvReal hmmFreq = self->binFreqList[state];
+    if(nObsFreq == 0)
+      return hmmFreq;
+
+    int iNearest = -1;
+    RvReal nearestDistance = std::numeric_limits<RvReal>::infinity();
+    for(int i = 0; i < nObsFreq; ++i)
     {
-      RvReal hmmFreq = p.minFreq * std::pow(2.0, static_cast<RvReal>(self->decodeTemp[iHop]) / (12.0 * static_cast<RvReal>(p.binPerSemitone)));
-      if(self->obsProbList[iHop].size() == 0)
-        bestFreq = hmmFreq;
-      else
+      RvReal distance = std::abs(obsFreq[i * stride] - hmmFreq);
+      if(distance < nearestDistance)
       {
-        int iNearest = -1;
-        RvReal nearestDistance = std::numeric_limits<RvReal>::infinity();
-        int n = static_cast<int>(self->obsProbList[iHop].size());
-        for(int i = 0; i < n; ++i)
-        {
-          RvReal distance = std::abs(self->obsProbList[iHop][i].first - hmmFreq);
-          if(distance < nearestDistance)
-          {
-            nearestDistance = distance;
-            iNearest = i;
-          }
-        }
-        rvAssert(iNearest >= 0, "internal error");
-        bestFreq = self->obsProbList[iHop][iNearest].first;
-        if(bestFreq < p.minFreq || bestFreq > maxFreq || std::abs(std::log2(bestFreq / p.minFreq) * 12.0 * static_cast<RvReal>(p.binPerSemitone) - self->decodeTemp[iHop] > 1.0))
-          bestFreq = hmmFreq;
+        nearestDistance = distance;
+        iNearest = i;
       }
     }
-    else
-      bestFreq = -p.minFreq * std::pow(2.0, (static_cast<RvReal>(self->decodeTemp[iHop] - nBin)) / (12.0 * static_cast<RvReal>(p.binPerSemitone)));
-    out[iHop] = bestFreq;
+    rvAssert(iNearest >= 0, "internal error");
+    RvReal bestFreq = obsFreq[iNearest * stride];
+    if(bestFreq < p.minFreq || bestFreq > self->maxFreq || bestFreq < hmmFreq / self->binRatio || bestFreq > hmmFreq * self->binRatio)
+      return hmmFreq;
+    return bestFreq;
   }
+} // namespace ReVoice
+
+// frequency of a decoded state, snapped to the nearest observed candidate of the hop in history slot
+static RvReal calcPathFreq(const RvRTMonoPitchProcessor *self, int state, int slot)
+{ return monoPitchPathFreq(self, state, self->obsFreqList + slot * self->param.maxCandidate, self->obsCountList[slot], 1); }
 
-  // mark unvoiced->voiced bound as voiced
-  for(int iHop = 1; iHop < currObsLength; ++iHop)
+// mark unvoiced->voiced bound as voiced and silent frame as unvoiced, in place
+// frames are iFirstFrame, iFirstFrame + 1, ..., and bounds before the first one are not visible
+static void postProcess(const RvRTMonoPitchProcessor *self, RvReal *io, int n, int iFirstFrame)
+{
+  for(int iHop = 1; iHop < n; ++iHop)
   {
-    if(out[iHop - 1] <= 0.0 && out[iHop] > 0.0)
+    if(io[iHop - 1] <= 0.0 && io[iHop] > 0.0)
     {
-      int windowSize = std::max(static_cast<int>(std::ceil(p.samprate / out[iHop] * 4.0)), p.hopSize * 2);
-      if(windowSize % 2 != 0)
-        windowSize += 1;
-      int frameOffset = static_cast<int>(std::round(static_cast<RvReal>(windowSize) / static_cast<RvReal>(p.hopSize * 2)));
+      int frameOffset = calcOnsetFrameOffset(self->param, io[iHop]);
       for(int i = std::max(0, iHop - frameOffset); i < iHop; ++i)
-        out[i] = out[iHop];
+        io[i] = io[iHop];
     }
   }
+  for(int iHop = 0; iHop < n; ++iHop)
+  {
+    if(io[iHop] > 0.0 && self->silentList[(iFirstFrame + iHop) % self->frameRingSize])
+      io[iHop] = 0.0;
+  }
+}
 
-  // mark silent frame as unvoiced
+int rvCallRTMonoPitch(RvRTMonoPitchProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, RvReal *out)
+{
+  rvAssert(x, "x cannot be nullptr");
+  rvAssert(obsProb || nObsProb == 0, "obsProb cannot be nullptr with non-zero nObsProb");
+  rvAssert(nObsProb >= 0, "nObsProb cannot be negative");
+  rvAssert(out, "out cannot be nullptr");
+
+  auto &p = self->param;
+  int currObsLength = feedFrame(self, isSilentFrame(self, x), obsProb, nObsProb);
+  int nDecoded = rvRTSparseHMMViterbiDecode(self->hmmModel, self->decodeTemp, currObsLength);
+  rvAssert(nDecoded == currObsLength, "internal error");
+  self->deltaBegin = self->nFrame;
+
+  int firstSlot = (self->historyHead - currObsLength + 1 + p.maxObsLength) % p.maxObsLength;
   for(int iHop = 0; iHop < currObsLength; ++iHop)
+    out[iHop] = calcPathFreq(self, self->decodeTemp[iHop], (firstSlot + iHop) % p.maxObsLength);
+  postProcess(self, out, currObsLength, self->nFrame - currObsLength);
+
+  return currObsLength;
+}
+
+int rvCallRTMonoPitchDelta(RvRTMonoPitchProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, int *frameIndex, RvReal *value)
+{
+  rvAssert(x, "x cannot be nullptr");
+  return rvCallRTMonoPitchDeltaWithSilence(self, isSilentFrame(self, x), obsProb, nObsProb, frameIndex, value);
+}
+
+int rvCallRTMonoPitchDeltaWithSilence(RvRTMonoPitchProcessor *self, bool isSilent, const RvReal *obsProb, int nObsProb, int *frameIndex, RvReal *value)
+{
+  rvAssert(obsProb || nObsProb == 0, "obsProb cannot be nullptr with non-zero nObsProb");
+  rvAssert(nObsProb >= 0, "nObsProb cannot be negative");
+  rvAssert(frameIndex, "frameIndex cannot be nullptr");
+  rvAssert(value, "value cannot be nullptr");
+
+  auto &p = self->param;
+  int ringSize = self->frameRingSize;
+
+  // keep decodeTemp aligned with the window of the new hop
+  if(self->historyUsed == p.maxObsLength)
+    std::copy(self->decodeTemp + 1, self->decodeTemp + p.maxObsLength, self->decodeTemp);
+  int currObsLength = feedFrame(self, isSilent, obsProb, nObsProb);
+  int iLastFrame = self->nFrame - 1;
+  int iFirstObsFrame = self->nFrame - currObsLength;
+  int iChanged = iFirstObsFrame + rvRTSparseHMMViterbiDecodeUpdate(self->hmmModel, self->decodeTemp, currObsLength);
+  self->emittedFreqList[iLastFrame % ringSize] = std::numeric_limits<RvReal>::quiet_NaN();
+
+  // nothing before the window is known after a full-mode call or at startup
+  if(self->deltaBegin > iFirstObsFrame)
   {
-    if(out[iHop] > 0.0 && self->obsSilentList[iHop])
-      out[iHop] = 0.0;
+    iChanged = iFirstObsFrame;
+    self->deltaBegin = iFirstObsFrame;
+    for(int i = iFirstObsFrame; i < iLastFrame; ++i)
+      self->emittedFreqList[i % ringSize] = std::numeric_limits<RvReal>::quiet_NaN();
   }
 
-  return currObsLength;
+  int firstSlot = (self->historyHead - currObsLength + 1 + p.maxObsLength) % p.maxObsLength;
+  for(int i = iChanged; i <= iLastFrame; ++i)
+  {
+    int iHop = i - iFirstObsFrame;
+    self->rawFreqList[i % ringSize] = calcPathFreq(self, self->decodeTemp[iHop], (firstSlot + iHop) % p.maxObsLength);
+  }
+
+  // an onset can only move frames up to maxFrameOffset before itself
+  int iBegin = std::max(iChanged - self->maxFrameOffset, self->deltaBegin);
+  int n = iLastFrame - iBegin + 1;
+  for(int i = 0; i < n; ++i)
+    self->processedTemp[i] = self->rawFreqList[(iBegin + i) % ringSize];
+  postProcess(self, self->processedTemp, n, iBegin);
+
+  int nOut = 0;
+  for(int i = 0; i < n; ++i)
+  {
+    RvReal &emitted = self->emittedFreqList[(iBegin + i) % ringSize];
+    if(self->processedTemp[i] != emitted)
+    {
+      emitted = self->processedTemp[i];
+      frameIndex[nOut] = iBegin + i;
+      value[nOut] = emitted;
+      ++nOut;
+    }
+  }
+
+  return nOut;
+}
+
+RvRTMonoPitchProcessorPool *rvCreateRTMonoPitchProcessorPool(const RvRTMonoPitchProcessorParameter *param, int nProcessor)
+{
+  checkParameter(param);
+  RvSparseHMM *model = acquireModel(*param);
+  auto layoutProcessor = [param, model](Arena &arena) { return layoutRTMonoPitch(arena, *param, model); };
+  Arena measure;
+  layoutProcessorPool<RvRTMonoPitchProcessorPool, RvRTMonoPitchProcessor>(measure, nProcessor, layoutProcessor);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutProcessorPool<RvRTMonoPitchProcessorPool, RvRTMonoPitchProcessor>(arena, nProcessor, layoutProcessor);
+  rvReleaseSparseHMM(model);
+  return self;
+}
+
+RvRTMonoPitchProcessor *rvRTMonoPitchProcessorPoolAcquire(RvRTMonoPitchProcessorPool *pool)
+{ return acquireFromPool(pool); }
+
+void rvRTMonoPitchProcessorPoolRelease(RvRTMonoPitchProcessorPool *pool, RvRTMonoPitchProcessor *self)
+{ releaseToPool(pool, self, rvResetRTMonoPitchProcessor); }
+
+void rvDestroyRTMonoPitchProcessorPool(RvRTMonoPitchProcessorPool *pool)
+{ destroyProcessorPool(pool, rvDestroyRTMonoPitchProcessor); }
+
+void rvResetRTMonoPitchProcessor(RvRTMonoPitchProcessor *self)
+{
+  rvResetRTSparseHMM(self->hmmModel);
+  rvResetRTEnergyTracker(self->energyTracker);
+  self->historyHead = self->param.maxObsLength - 1;
+  self->historyUsed = 0;
+  self->nFrame = 0;
+  self->deltaBegin = 0;
 }
 
 void rvDestroyRTMonoPitchProcessor(RvRTMonoPitchProcessor *self)
 {
-  rvFree(self->obsTemp);
-  rvFree(self->decodeTemp);
+  rvDestroyRTEnergyTracker(self->energyTracker);
   rvDestroyRTSparseHMM(self->hmmModel);
-}
\ No newline at end of file
+  if(self->ownsMemory)
+    rvFree(self);
+}
@@ -0,0 +1,280 @@
+#include "../rtpitchpipeline.h"
+
+#include "util_p.hpp"
+#include "../rtpitchtracker.h"
+#include "spscring_p.hpp"
+#include "stage_p.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace ReVoice;
+
+namespace
+{
+  // x is the raw input, which the hmm stage needs for its silence test
+  // data is the prefiltered audio after the prefilter stage and nData (freq, prob) pairs after the yin stage
+  struct PipelineBlock
+  {
+    RvReal *x, *data;
+    int nX, nData;
+    bool endOfStream;
+  };
+
+  // nOut == -1 marks the end of stream
+  struct PipelineOutput
+  {
+    int *frameIndex;
+    RvReal *f0;
+    int nOut;
+  };
+} // namespace
+
+typedef struct RvRTPitchPipeline
+{
+  RvRTPitchTracker *tracker;
+  int hopSize, maxOutput, maxCandidate;
+  bool ended;
+
+  // input -> prefilter -> filtered -> yin -> analyzed -> hmm -> output
+  SpscRing<PipelineBlock> inputRing, filteredRing, analyzedRing;
+  SpscRing<PipelineOutput> outputRing;
+
+  // stages that find their rings empty or full sleep here
+  // push and pop notify without the lock, so a missed wakeup only costs the wait timeout
+  std::thread stageThreadList[3];
+  std::mutex wakeLock;
+  std::condition_variable wakeCond;
+  std::atomic<int> nSleeping;
+  std::atomic<bool> stopping;
+} RvRTPitchPipeline;
+
+static PipelineBlock *layoutBlockList(Arena &arena, int nBlock, int maxX, int maxData)
+{
+  auto blockList = arena.take<PipelineBlock>(nBlock);
+  for(int i = 0; i < nBlock; ++i)
+  {
+    auto x = arena.take<RvReal>(maxX);
+    auto data = maxData > 0 ? arena.take<RvReal>(maxData) : nullptr;
+    if(!arena.isMeasuring())
+    {
+      blockList[i].x = x;
+      blockList[i].data = data;
+    }
+  }
+  return blockList;
+}
+
+// pipeline and all queue blocks share one block, the tracker has its own
+static RvRTPitchPipeline *layoutRTPitchPipeline(Arena &arena, int nQueueBlock, int hopSize, int maxFiltered, int maxCandidate, int maxOutput)
+{
+  auto self = arena.construct<RvRTPitchPipeline>();
+  auto inputBlockList = layoutBlockList(arena, nQueueBlock, hopSize, 0);
+  auto filteredBlockList = layoutBlockList(arena, nQueueBlock, hopSize, maxFiltered);
+  auto analyzedBlockList = layoutBlockList(arena, nQueueBlock, hopSize, maxCandidate * 2);
+  auto outputList = arena.take<PipelineOutput>(nQueueBlock);
+  for(int i = 0; i < nQueueBlock; ++i)
+  {
+    auto frameIndex = arena.take<int>(maxOutput);
+    auto f0 = arena.take<RvReal>(maxOutput);
+    if(!arena.isMeasuring())
+    {
+      outputList[i].frameIndex = frameIndex;
+      outputList[i].f0 = f0;
+    }
+  }
+  if(arena.isMeasuring())
+    return nullptr;
+
+  self->hopSize = hopSize;
+  self->maxOutput = maxOutput;
+  self->maxCandidate = maxCandidate;
+  self->ended = false;
+  self->inputRing.init(inputBlockList, nQueueBlock);
+  self->filteredRing.init(filteredBlockList, nQueueBlock);
+  self->analyzedRing.init(analyzedBlockList, nQueueBlock);
+  self->outputRing.init(outputList, nQueueBlock);
+  self->nSleeping = 0;
+  self->stopping = false;
+  return self;
+}
+
+static void wake(RvRTPitchPipeline *self)
+{
+  // orders the ring update before reading nSleeping, pairs with the increment in waitFor
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if(self->nSleeping.load(std::memory_order_relaxed) > 0)
+    self->wakeCond.notify_all();
+}
+
+// spins briefly before sleeping, returns nullptr once the pipeline is stopping
+template<typename F>static auto waitFor(RvRTPitchPipeline *self, F poll) -> decltype(poll())
+{
+  for(int iSpin = 0; iSpin < 64; ++iSpin)
+  {
+    auto p = poll();
+    if(p)
+      return p;
+    std::this_thread::yield();
+  }
+  std::unique_lock<std::mutex> locker(self->wakeLock);
+  while(!self->stopping.load(std::memory_order_relaxed))
+  {
+    self->nSleeping.fetch_add(1);
+    auto p = poll();
+    if(!p)
+      self->wakeCond.wait_for(locker, std::chrono::milliseconds(1));
+    self->nSleeping.fetch_sub(1);
+    if(p)
+      return p;
+  }
+  return nullptr;
+}
+
+static void prefilterStage(RvRTPitchPipeline *self)
+{
+  RvRTPYinProcessor *pyin = rtPitchTrackerPYin(self->tracker);
+  while(true)
+  {
+    PipelineBlock *in = waitFor(self, [self]() { return self->inputRing.peek(); });
+    if(!in)
+      return;
+    // at the end of stream the filter tail comes out in one call, the next one forwards the end
+    bool done = false;
+    while(!done)
+    {
+      PipelineBlock *out = waitFor(self, [self]() { return self->filteredRing.beginWrite(); });
+      if(!out)
+        return;
+      out->nX = in->nX;
+      std::copy(in->x, in->x + in->nX, out->x);
+      out->nData = prefilterRTPYin(pyin, in->endOfStream ? nullptr : in->x, in->nX, out->data);
+      out->endOfStream = in->endOfStream && out->nData == 0;
+      done = !in->endOfStream || out->endOfStream;
+      self->filteredRing.commitWrite();
+      wake(self);
+    }
+    self->inputRing.release();
+    wake(self);
+  }
+}
+
+static void yinStage(RvRTPitchPipeline *self)
+{
+  RvRTPYinProcessor *pyin = rtPitchTrackerPYin(self->tracker);
+  while(true)
+  {
+    PipelineBlock *in = waitFor(self, [self]() { return self->analyzedRing.beginWrite() ? self->filteredRing.peek() : nullptr; });
+    if(!in)
+      return;
+    // past the end of stream every call flushes one hop until pyin runs dry
+    bool done = false;
+    while(!done)
+    {
+      PipelineBlock *out = waitFor(self, [self]() { return self->analyzedRing.beginWrite(); });
+      if(!out)
+        return;
+      out->nX = in->nX;
+      std::copy(in->x, in->x + in->nX, out->x);
+      out->nData = analyzeRTPYin(pyin, in->data, in->nData, out->data, self->maxCandidate);
+      out->endOfStream = in->endOfStream && out->nData < 0;
+      done = !in->endOfStream || out->endOfStream;
+      self->analyzedRing.commitWrite();
+      wake(self);
+    }
+    self->filteredRing.release();
+    wake(self);
+  }
+}
+
+static void hmmStage(RvRTPitchPipeline *self)
+{
+  while(true)
+  {
+    PipelineBlock *in = waitFor(self, [self]() { return self->outputRing.beginWrite() ? self->analyzedRing.peek() : nullptr; });
+    if(!in)
+      return;
+    PipelineOutput *out = self->outputRing.beginWrite();
+    out->nOut = in->endOfStream ? -1 : trackRTPitchTracker(self->tracker, in->x, in->nX, in->data, in->nData, out->frameIndex, out->f0);
+    if(in->endOfStream || out->nOut > 0)
+      self->outputRing.commitWrite();
+    self->analyzedRing.release();
+    wake(self);
+  }
+}
+
+RvRTPitchPipeline *rvCreateRTPitchPipeline(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, int nQueueBlock)
+{
+  rvAssert(nQueueBlock > 0, "nQueueBlock must be greater than 0");
+  auto tracker = rvCreateRTPitchTracker(pyinParam, monoPitchParam);
+  int hopSize = rvRTPitchTrackerPYinParam(tracker)->hopSize;
+  int maxFiltered = rtPYinMaxPrefilterOutput(rtPitchTrackerPYin(tracker));
+  int maxCandidate = rtPitchTrackerMaxCandidate(tracker);
+  int maxOutput = rvRTPitchTrackerMaxOutputLength(tracker);
+
+  Arena measure;
+  layoutRTPitchPipeline(measure, nQueueBlock, hopSize, maxFiltered, maxCandidate, maxOutput);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTPitchPipeline(arena, nQueueBlock, hopSize, maxFiltered, maxCandidate, maxOutput);
+  self->tracker = tracker;
+  self->stageThreadList[0] = std::thread(prefilterStage, self);
+  self->stageThreadList[1] = std::thread(yinStage, self);
+  self->stageThreadList[2] = std::thread(hmmStage, self);
+  return self;
+}
+
+int rvRTPitchPipelineHopSize(const RvRTPitchPipeline *self)
+{ return self->hopSize; }
+
+int rvRTPitchPipelineMaxOutputLength(const RvRTPitchPipeline *self)
+{ return self->maxOutput; }
+
+bool rvRTPitchPipelinePush(RvRTPitchPipeline *self, const RvReal *x, int nX)
+{
+  rvAssert(x || nX == 0, "x cannot be nullptr with non-zero nX");
+  rvAssert(nX >= 0 && nX <= self->hopSize, "nX must be in range [0, hopSize]");
+  rvAssert(!self->ended, "the stream has ended");
+
+  PipelineBlock *block = self->inputRing.beginWrite();
+  if(!block)
+    return false;
+  std::copy(x, x + nX, block->x);
+  block->nX = nX;
+  block->endOfStream = nX == 0;
+  self->inputRing.commitWrite();
+  self->ended = nX == 0;
+  wake(self);
+  return true;
+}
+
+bool rvRTPitchPipelinePop(RvRTPitchPipeline *self, int *frameIndex, RvReal *f0, int *nOut)
+{
+  rvAssert(frameIndex && f0 && nOut, "frameIndex, f0 or nOut cannot be nullptr");
+  PipelineOutput *out = self->outputRing.peek();
+  if(!out)
+    return false;
+  *nOut = out->nOut;
+  if(out->nOut > 0)
+  {
+    std::copy(out->frameIndex, out->frameIndex + out->nOut, frameIndex);
+    std::copy(out->f0, out->f0 + out->nOut, f0);
+  }
+  self->outputRing.release();
+  wake(self);
+  return true;
+}
+
+void rvDestroyRTPitchPipeline(RvRTPitchPipeline *self)
+{
+  {
+    std::unique_lock<std::mutex> locker(self->wakeLock);
+    self->stopping = true;
+  }
+  self->wakeCond.notify_all();
+  for(auto &thread : self->stageThreadList)
+    thread.join();
+  rvDestroyRTPitchTracker(self->tracker);
+  self->~RvRTPitchPipeline();
+  rvFree(self);
+}
@@ -0,0 +1,285 @@
+#include "../rtpitchtracker.h"
+
+#include "util_p.hpp"
+#include "../rtenergy.h"
+#include "layout_p.hpp"
+#include "threadpool_p.hpp"
+#include "stage_p.hpp"
+
+using namespace ReVoice;
+
+typedef struct RvRTPitchTracker
+{
+  RvRTPYinProcessor *pyinProc;
+  RvRTMonoPitchProcessor *monoPitchProc;
+  int hopSize, maxCandidate;
+
+  // silent flag of hop k covers the 2 * hopSize frame centered at k * hopSize, kept in a ring indexed by k % silentRingSize
+  // flags run ahead of pyin output by its delay
+  RvRTEnergyTracker *energyTracker;
+  bool *silentList;
+  int silentRingSize, nHopDone, nPartial, nFrameDone;
+
+  RvReal *candidateTemp;
+  bool ownsMemory;
+} RvRTPitchTracker;
+
+// channels are deinterleaved into channelTemp, one aligned row per channel
+typedef struct RvRTPitchTrackerBank
+{
+  RvRTPitchTracker **trackerList;
+  int nChannel, hopSize, maxOutput;
+  RvReal *channelTemp;
+  int channelStride;
+  RvThreadPool *pool;
+} RvRTPitchTrackerBank;
+
+// tracker, both stages and buffers share one block
+static RvRTPitchTracker *layoutRTPitchTracker(Arena &arena, const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, RvSparseHMM *model)
+{
+  int hopSize = pyinParam->hopSize;
+  // the monopitch stage keeps its own maxCandidate of them
+  int maxCandidate = rtPYinMaxCandidate;
+  int silentRingSize = (rvRTPYinDelay(pyinParam) + hopSize - 1) / hopSize + 4;
+
+  auto self = arena.construct<RvRTPitchTracker>();
+  auto pyinProc = layoutRTPYinProcessor(arena, pyinParam);
+  auto monoPitchProc = layoutRTMonoPitchProcessor(arena, monoPitchParam, model);
+  auto energyTracker = layoutRTEnergyTracker(arena, hopSize, 2, monoPitchParam->energyThreshold, monoPitchParam->energyThreshold * monoPitchParam->energyHysteresis);
+  auto silentList = arena.take<bool>(silentRingSize);
+  auto candidateTemp = arena.take<RvReal>(maxCandidate * 2);
+  if(arena.isMeasuring())
+    return nullptr;
+
+  self->pyinProc = pyinProc;
+  self->monoPitchProc = monoPitchProc;
+  self->hopSize = hopSize;
+  self->maxCandidate = maxCandidate;
+  self->energyTracker = energyTracker;
+  self->silentRingSize = silentRingSize;
+  self->silentList = silentList;
+  self->candidateTemp = candidateTemp;
+  self->ownsMemory = false;
+  rvResetRTPitchTracker(self);
+  return self;
+}
+
+static void checkParameter(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam)
+{
+  rvAssert(pyinParam, "pyinParam cannot be nullptr");
+  rvAssert(pyinParam->maxWindowSize >= pyinParam->hopSize * 2, "maxWindowSize must be at least 2 * hopSize");
+  rvAssert(!monoPitchParam || monoPitchParam->hopSize == pyinParam->hopSize, "hopSize of pyinParam and monoPitchParam must be equal");
+  rvAssert(!monoPitchParam || monoPitchParam->samprate == pyinParam->samprate, "samprate of pyinParam and monoPitchParam must be equal");
+}
+
+RvRTPitchTracker *rvCreateRTPitchTracker(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam)
+{
+  checkParameter(pyinParam, monoPitchParam);
+  auto defaultParam = monoPitchParam ? nullptr : rvCreateRTMonoPitchProcessorParameterFromRTPYin(pyinParam);
+  if(defaultParam)
+    monoPitchParam = defaultParam;
+
+  // one model reference over both passes, so an unpinned model is not rebuilt in between
+  RvSparseHMM *model = acquireMonoPitchModel(monoPitchParam);
+  Arena measure;
+  layoutRTPitchTracker(measure, pyinParam, monoPitchParam, model);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTPitchTracker(arena, pyinParam, monoPitchParam, model);
+  self->ownsMemory = true;
+  rvReleaseSparseHMM(model);
+  if(defaultParam)
+    rvDestroyRTMonoPitchProcessorParameter(defaultParam);
+  return self;
+}
+
+const RvRTPYinProcessorParameter *rvRTPitchTrackerPYinParam(const RvRTPitchTracker *self)
+{ return rvRTPYinParam(self->pyinProc); }
+
+const RvRTMonoPitchProcessorParameter *rvRTPitchTrackerMonoPitchParam(const RvRTPitchTracker *self)
+{ return rvRTMonoPitchParam(self->monoPitchProc); }
+
+int rvRTPitchTrackerMaxOutputLength(const RvRTPitchTracker *self)
+{ return rvMonoPitchMaxDeltaOutputLength(self->monoPitchProc); }
+
+// x == nullptr stands for zeros
+static void pushAudio(RvRTPitchTracker *self, const RvReal *x, int nX)
+{
+  while(nX > 0)
+  {
+    int n = std::min(nX, self->hopSize - self->nPartial);
+    if(rvCallRTEnergyTracker(self->energyTracker, x, n) > 0)
+    {
+      rvAssert(self->nHopDone - self->nFrameDone < self->silentRingSize, "internal error");
+      self->silentList[self->nHopDone % self->silentRingSize] = rvRTEnergyTrackerIsSilent(self->energyTracker);
+      ++self->nHopDone;
+    }
+    self->nPartial = (self->nPartial + n) % self->hopSize;
+    if(x)
+      x += n;
+    nX -= n;
+  }
+}
+
+namespace ReVoice
+{
+  RvRTPYinProcessor *rtPitchTrackerPYin(RvRTPitchTracker *self)
+  { return self->pyinProc; }
+
+  int rtPitchTrackerMaxCandidate(const RvRTPitchTracker *self)
+  { return self->maxCandidate; }
+
+  int trackRTPitchTracker(RvRTPitchTracker *self, const RvReal *x, int nX, const RvReal *candidate, int nCandidate, int *frameIndex, RvReal *f0)
+  {
+    if(nX > 0)
+      pushAudio(self, x, nX);
+    if(nCandidate < 0)
+      return nX > 0 ? 0 : -1;
+
+    // past the end of input the frame is zero padded
+    if(nX == 0 && self->nHopDone <= self->nFrameDone)
+      pushAudio(self, nullptr, self->hopSize - self->nPartial);
+    rvAssert(self->nHopDone > self->nFrameDone, "internal error");
+    bool isSilent = self->silentList[self->nFrameDone % self->silentRingSize];
+    int nOut = rvCallRTMonoPitchDeltaWithSilence(self->monoPitchProc, isSilent, candidate, nCandidate, frameIndex, f0);
+    ++self->nFrameDone;
+
+    return nOut;
+  }
+} // namespace ReVoice
+
+// x == nullptr or nX == 0 flushes one hop, returns -1 once everything has been flushed
+// otherwise returns the number of (frameIndex, f0) pairs changed by this call, see rvCallRTMonoPitchDelta
+int rvCallRTPitchTracker(RvRTPitchTracker *self, const RvReal *x, int nX, int *frameIndex, RvReal *f0)
+{
+  rvAssert(x || nX == 0, "x cannot be nullptr with non-zero nX");
+  rvAssert(nX >= 0 && nX <= self->hopSize, "nX must be in range [0, hopSize]");
+  rvAssert(frameIndex && f0, "frameIndex or f0 cannot be nullptr");
+
+  int nCandidate = rvCallRTPYin(self->pyinProc, x, nX, self->candidateTemp, self->maxCandidate);
+  return trackRTPitchTracker(self, x, nX, self->candidateTemp, nCandidate, frameIndex, f0);
+}
+
+void rvResetRTPitchTracker(RvRTPitchTracker *self)
+{
+  rvResetRTPYinProcessor(self->pyinProc);
+  rvResetRTMonoPitchProcessor(self->monoPitchProc);
+  rvResetRTEnergyTracker(self->energyTracker);
+  // the frame of hop 0 starts one hop before the input
+  rvCallRTEnergyTracker(self->energyTracker, nullptr, self->hopSize);
+  self->nHopDone = 0;
+  self->nPartial = 0;
+  self->nFrameDone = 0;
+}
+
+void rvDestroyRTPitchTracker(RvRTPitchTracker *self)
+{
+  rvDestroyRTEnergyTracker(self->energyTracker);
+  rvDestroyRTMonoPitchProcessor(self->monoPitchProc);
+  rvDestroyRTPYinProcessor(self->pyinProc);
+  if(self->ownsMemory)
+    rvFree(self);
+}
+
+RvRTPitchTrackerBank *rvCreateRTPitchTrackerBank(int nChannel, const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, RvThreadPool *pool)
+{
+  rvAssert(nChannel > 0, "nChannel must be greater than 0");
+  checkParameter(pyinParam, monoPitchParam);
+  auto defaultParam = monoPitchParam ? nullptr : rvCreateRTMonoPitchProcessorParameterFromRTPYin(pyinParam);
+  if(defaultParam)
+    monoPitchParam = defaultParam;
+
+  // channels follow each other in one block, every tracker starts on its own cache line
+  int hopSize = pyinParam->hopSize;
+  int channelStride = (hopSize + 7) / 8 * 8;
+  RvSparseHMM *model = acquireMonoPitchModel(monoPitchParam);
+  auto layoutBank = [&](Arena &arena)
+  {
+    auto self = arena.construct<RvRTPitchTrackerBank>();
+    auto trackerList = arena.take<RvRTPitchTracker*>(nChannel);
+    auto channelTemp = arena.take<RvReal>(nChannel * channelStride);
+    for(int i = 0; i < nChannel; ++i)
+    {
+      auto tracker = layoutRTPitchTracker(arena, pyinParam, monoPitchParam, model);
+      if(!arena.isMeasuring())
+        trackerList[i] = tracker;
+    }
+    if(arena.isMeasuring())
+      return static_cast<RvRTPitchTrackerBank*>(nullptr);
+    self->trackerList = trackerList;
+    self->nChannel = nChannel;
+    self->hopSize = hopSize;
+    self->maxOutput = rvRTPitchTrackerMaxOutputLength(trackerList[0]);
+    self->channelTemp = channelTemp;
+    self->channelStride = channelStride;
+    self->pool = pool;
+    return self;
+  };
+  Arena measure;
+  layoutBank(measure);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutBank(arena);
+  rvReleaseSparseHMM(model);
+  if(defaultParam)
+    rvDestroyRTMonoPitchProcessorParameter(defaultParam);
+  return self;
+}
+
+int rvRTPitchTrackerBankChannelCount(const RvRTPitchTrackerBank *self)
+{ return self->nChannel; }
+
+int rvRTPitchTrackerBankMaxOutputLength(const RvRTPitchTrackerBank *self)
+{ return self->maxOutput; }
+
+// x holds nX interleaved frames of nChannel samples, x == nullptr or nX == 0 flushes one hop of every channel
+// channel i writes its pairs to frameIndex and f0 at i * rvRTPitchTrackerBankMaxOutputLength and its count to nOut[i]
+// returns the total number of pairs, or -1 once everything has been flushed
+int rvCallRTPitchTrackerBank(RvRTPitchTrackerBank *self, const RvReal *x, int nX, int *frameIndex, RvReal *f0, int *nOut)
+{
+  rvAssert(x || nX == 0, "x cannot be nullptr with non-zero nX");
+  rvAssert(nX >= 0 && nX <= self->hopSize, "nX must be in range [0, hopSize]");
+  rvAssert(frameIndex && f0 && nOut, "frameIndex, f0 or nOut cannot be nullptr");
+
+  int nChannel = self->nChannel;
+  int stride = self->channelStride;
+  // one sequential pass over the interleaved block
+  for(int i = 0; i < nX; ++i)
+  {
+    const RvReal *frame = x + i * nChannel;
+    for(int iChannel = 0; iChannel < nChannel; ++iChannel)
+      self->channelTemp[iChannel * stride + i] = frame[iChannel];
+  }
+
+  auto runChannel = [&](int iBegin, int iEnd)
+  {
+    for(int iChannel = iBegin; iChannel < iEnd; ++iChannel)
+    {
+      int iOut = iChannel * self->maxOutput;
+      nOut[iChannel] = rvCallRTPitchTracker(self->trackerList[iChannel], nX > 0 ? self->channelTemp + iChannel * stride : nullptr, nX, frameIndex + iOut, f0 + iOut);
+    }
+  };
+  if(self->pool && nChannel > 1)
+    parallelFor(self->pool, nChannel, 1, runChannel);
+  else
+    runChannel(0, nChannel);
+
+  // channels share their parameters, so they flush in the same call
+  if(nOut[0] < 0)
+    return -1;
+  int nTotal = 0;
+  for(int iChannel = 0; iChannel < nChannel; ++iChannel)
+    nTotal += nOut[iChannel];
+  return nTotal;
+}
+
+void rvResetRTPitchTrackerBank(RvRTPitchTrackerBank *self)
+{
+  for(int i = 0; i < self->nChannel; ++i)
+    rvResetRTPitchTracker(self->trackerList[i]);
+}
+
+void rvDestroyRTPitchTrackerBank(RvRTPitchTrackerBank *self)
+{
+  for(int i = 0; i < self->nChannel; ++i)
+    rvDestroyRTPitchTracker(self->trackerList[i]);
+  rvFree(self);
+}
@@ -4,6 +4,10 @@
 #include "../yin.h"
 #include "../pyin.h"
 #include "../rtfilter.h"
+#include "../rtenergy.h"
+#include "layout_p.hpp"
+#include "pool_p.hpp"
+#include "stage_p.hpp"
 
 using namespace ReVoice;
 
@@ -12,11 +16,77 @@ typedef struct RvRTPYinProcessor
   RvRTPYinProcessorParameter param;
   RvRTFilter *filterProc;
   RvYinDifferenceWorker *differenceWorker;
+  RvRTEnergyTracker *gateTracker;
   RvReal *buffer, *differenceTemp;
   int internalDelayed, bufferUsed;
   int bufferSize;
+  int gateHold, nSkipped;
+  bool ownsMemory;
 } RvRTPYinProcessor;
 
+typedef struct RvRTPYinProcessorPool : ProcessorPool<RvRTPYinProcessor>
+{} RvRTPYinProcessorPool;
+
+static int prefilterOrder(const RvRTPYinProcessorParameter &param)
+{
+  int filterOrder = static_cast<int>(2048.0 * param.samprate / 44100.0);
+  if(filterOrder % 2 == 0)
+    filterOrder += 1;
+  return filterOrder;
+}
+
+// feeds samples entering the buffer to the gate, x == nullptr stands for zeros
+static void feedGate(RvRTPYinProcessor *self, const RvReal *x, int nX)
+{ rvCallRTEnergyTracker(self->gateTracker, x, nX); }
+
+static void shiftBuffer(RvRTPYinProcessor *self)
+{
+  std::copy(self->buffer + self->param.hopSize, self->buffer + self->bufferUsed, self->buffer);
+  std::fill(self->buffer + self->bufferUsed, self->buffer + self->bufferSize, 0.0);
+  self->internalDelayed -= self->param.hopSize;
+  self->bufferUsed -= self->param.hopSize;
+}
+
+// processor, its subobjects and buffers share one block
+static RvRTPYinProcessor *layoutRTPYin(Arena &arena, const RvRTPYinProcessorParameter &param)
+{
+  int filterOrder = param.prefilter ? prefilterOrder(param) : 1;
+  auto self = arena.construct<RvRTPYinProcessor>();
+  auto pdf = arena.take<RvReal>(param.pdfSize);
+  auto filterProc = param.prefilter ? layoutRTFilter(arena, nullptr, filterOrder, param.hopSize) : nullptr;
+  auto differenceWorker = layoutYinDifferenceWorker(arena, param.maxWindowSize);
+  int bufferSize = param.maxWindowSize + std::max(param.hopSize, rvRTFilterMaxOutputSize(param.hopSize, filterOrder));
+  auto buffer = arena.take<RvReal>(bufferSize);
+  auto differenceTemp = arena.take<RvReal>(param.maxWindowSize / 2);
+
+  // gate is disabled with zero threshold
+  // its window spans the whole analysis buffer, starting with the same leading zeros
+  RvRTEnergyTracker *gateTracker = nullptr;
+  if(param.gateThreshold > 0.0)
+  {
+    int nGateHop = (param.maxWindowSize + param.hopSize - 1) / param.hopSize;
+    gateTracker = layoutRTEnergyTracker(arena, param.hopSize, nGateHop, param.gateThreshold, param.gateThreshold * param.gateHysteresis);
+  }
+  if(arena.isMeasuring())
+    return nullptr;
+
+  self->param = param;
+  self->param.pdf = pdf;
+  std::copy(param.pdf, param.pdf + param.pdfSize, self->param.pdf);
+  // the kernel is designed straight into the filter
+  if(filterProc)
+    rvFirwinSingleBand(filterOrder, 0.0, std::max(param.maxFreq + 500.0, param.maxFreq * 3.0), "blackman", true, param.samprate / 2.0, rtFilterKernel(filterProc));
+  self->filterProc = filterProc;
+  self->differenceWorker = differenceWorker;
+  self->bufferSize = bufferSize;
+  self->buffer = buffer;
+  self->differenceTemp = differenceTemp;
+  self->gateTracker = gateTracker;
+  self->ownsMemory = false;
+  rvResetRTPYinProcessor(self);
+  return self;
+}
+
 RvRTPYinProcessorParameter *rvCreateRTPYinProcessorParameter(RvReal minFreq, RvReal maxFreq, RvReal sr, RvReal *pdf, int pdfSize)
 {
   RvReal nyq = sr / 2.0;
@@ -41,8 +111,10 @@ RvRTPYinProcessorParameter *rvCreateRTPYinProcessorParameter(RvReal minFreq, RvR
     1.0, 0.01,
     0.02, 5.0,
     1.0,
+    0.0, 2.0,
     hopSize, std::max(static_cast<int>(roundUpToPowerOf2(sr / minFreq * 4.0)), hopSize),
     4, pdfSize,
+    4,
     true, selfAllocPdf
   });
 }
@@ -57,8 +129,9 @@ void rvDestroyRTPYinProcessorParameter(RvRTPYinProcessorParameter *param)
 const RvRTPYinProcessorParameter *rvRTPYinParam(const RvRTPYinProcessor *self)
 { return &(self->param); }
 
-RvRTPYinProcessor *rvCreateRTPYinProcessor(const RvRTPYinProcessorParameter *param)
+static void checkParameter(const RvRTPYinProcessorParameter *param)
 {
+  rvAssert(param, "param cannot be nullptr");
   RvReal nyq = param->samprate / 2.0;
   rvAssert(param->pdf && param->pdfSize > 0, "pdf cannot be nullptr and pdfSize must be greater than 0");
   rvAssert(param->samprate > 0.0, "samprate must be greater than 0");
@@ -68,162 +141,235 @@ RvRTPYinProcessor *rvCreateRTPYinProcessor(const RvRTPYinProcessorParameter *par
   rvAssert(param->bias > 0.0, "invalid bias");
   rvAssert(param->hopSize > 0 && param->maxWindowSize >= param->hopSize, "invalid hopSize or maxWindowSize");
   rvAssert(param->maxIter >= 1 && param->pdfSize > 0, "invalid maxIter or pdfSize");
+  rvAssert(param->gateThreshold >= 0.0 && param->gateHysteresis >= 1.0 && param->gateHangover >= 0, "invalid gateThreshold, gateHysteresis or gateHangover");
+}
 
-  auto self = new RvRTPYinProcessor;
-  self->param = *param;
-  auto pdf = self->param.pdf;
-  self->param.pdf = RVALLOC(RvReal, self->param.pdfSize);
-  std::copy(pdf, pdf + self->param.pdfSize, self->param.pdf);
-
-  int filterOrder = 1;
-  if(param->prefilter)
+namespace ReVoice
+{
+  RvRTPYinProcessor *layoutRTPYinProcessor(Arena &arena, const RvRTPYinProcessorParameter *param)
   {
-    filterOrder = static_cast<int>(2048.0 * param->samprate / 44100.0);
-    if(filterOrder % 2 == 0)
-      filterOrder += 1;
-    auto kernel = RVALLOC(RvReal, filterOrder);
-    rvFirwinSingleBand(filterOrder, 0.0, std::max(param->maxFreq + 500.0, param->maxFreq * 3.0), "blackman", true, param->samprate / 2.0, kernel);
-    self->filterProc = rvCreateRTFilter(kernel, filterOrder, param->hopSize);
-    rvFree(kernel);
+    checkParameter(param);
+    return layoutRTPYin(arena, *param);
   }
-  self->differenceWorker = rvCreateYinDifferenceWorker(param->maxWindowSize);
-  self->internalDelayed = false;
-  self->bufferUsed = self->param.maxWindowSize / 2;
+} // namespace ReVoice
 
-  self->bufferSize = param->maxWindowSize + std::max(param->hopSize, rvRTFilterMaxOutputSize(param->hopSize, filterOrder));
-  self->buffer = RVALLOC(RvReal, self->bufferSize);
-  std::fill(self->buffer, self->buffer + self->param.maxWindowSize / 2, 0.0);
-  std::fill(self->buffer + self->param.maxWindowSize / 2, self->buffer + self->bufferSize, 0.0);
+RvRTPYinProcessor *rvCreateRTPYinProcessor(const RvRTPYinProcessorParameter *param)
+{
+  checkParameter(param);
+  Arena measure;
+  layoutRTPYin(measure, *param);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto self = layoutRTPYin(arena, *param);
+  self->ownsMemory = true;
+  return self;
+}
 
-  self->differenceTemp = RVALLOC(RvReal, param->maxWindowSize / 2);
+size_t rvRTPYinProcessorRequiredSize(const RvRTPYinProcessorParameter *param)
+{
+  checkParameter(param);
+  Arena measure;
+  layoutRTPYin(measure, *param);
+  return measure.size();
+}
 
-  return self;
+RvRTPYinProcessor *rvInitRTPYinProcessorInPlace(void *mem, const RvRTPYinProcessorParameter *param)
+{
+  checkParameter(param);
+  Arena arena = Arena::inPlace(mem);
+  return layoutRTPYin(arena, *param);
 }
 
 int rvRTPYinDelayed(const RvRTPYinProcessor *self)
 { return self->param.prefilter ? self->internalDelayed + rvRTFilterDelayed(self->filterProc) : self->internalDelayed; }
 
+int rvRTPYinSkippedFrames(const RvRTPYinProcessor *self)
+{ return self->nSkipped; }
+
 int rvRTPYinBufferUsed(RvRTPYinProcessor *self)
 { return self->bufferUsed; }
 
 void rvRTPYinDumpBuffer(RvRTPYinProcessor *self, RvReal *out)
 { std::copy(self->buffer, self->buffer + self->bufferUsed, out); }
 
-int rvCallRTPYin(RvRTPYinProcessor *self, const RvReal *x, int nX, RvReal *out, int maxOut)
+namespace ReVoice
 {
-  rvAssert(x || nX == 0, "x cannot be nullptr with non-zero nX");
-  rvAssert(nX >= 0 && nX <= self->param.hopSize, "invalid nX");
-  rvAssert(maxOut > 0 && maxOut <= 128, "maxOut must be in range (0, 128]");
-  rvAssert(out, "out cannot be nullptr");
-  int halfMaxWindowSize = self->param.maxWindowSize / 2;
+  int rtPYinMaxPrefilterOutput(const RvRTPYinProcessor *self)
+  { return self->bufferSize - self->param.maxWindowSize; }
 
-  int nAppended;
-  if(self->param.prefilter)
-    nAppended = rvCallRTFilter(self->filterProc, x, nX, self->buffer + self->bufferUsed);
-  else
+  int prefilterRTPYin(RvRTPYinProcessor *self, const RvReal *x, int nX, RvReal *out)
   {
-    std::copy(x, x + nX, self->buffer + self->bufferUsed);
-    nAppended = nX;
+    if(self->param.prefilter)
+      return rvCallRTFilter(self->filterProc, x, nX, out);
+    std::copy(x, x + nX, out);
+    return nX;
   }
-  if(nAppended == 0)
+
+  int analyzeRTPYin(RvRTPYinProcessor *self, const RvReal *appended, int nAppended, RvReal *out, int maxOut)
   {
-    if(self->internalDelayed > 0)
+    rvAssert(nAppended >= 0 && nAppended <= rtPYinMaxPrefilterOutput(self), "invalid nAppended");
+    rvAssert(appended || nAppended == 0, "appended cannot be nullptr with non-zero nAppended");
+    rvAssert(maxOut > 0 && maxOut <= 128, "maxOut must be in range (0, 128]");
+    rvAssert(out, "out cannot be nullptr");
+
+    if(nAppended == 0)
     {
-      std::fill(self->buffer + self->bufferUsed, self->buffer + self->bufferUsed + self->param.hopSize, 0.0);
-      self->bufferUsed += self->param.hopSize;
+      if(self->internalDelayed > 0)
+      {
+        std::fill(self->buffer + self->bufferUsed, self->buffer + self->bufferUsed + self->param.hopSize, 0.0);
+        if(self->gateTracker)
+          feedGate(self, nullptr, self->param.hopSize);
+        self->bufferUsed += self->param.hopSize;
+      }
+      else
+        return -1;
     }
     else
-      return -1;
-  }
-  else
-  {
-    self->internalDelayed += nAppended;
-    self->bufferUsed += nAppended;
-    if(self->bufferUsed < self->param.maxWindowSize)
-      return -1;
-  }
-
-  rvAssert(self->bufferUsed >= self->param.maxWindowSize, "internal error");
+    {
+      // rvCallRTPYin prefilters in place
+      if(appended != self->buffer + self->bufferUsed)
+        std::copy(appended, appended + nAppended, self->buffer + self->bufferUsed);
+      if(self->gateTracker)
+        feedGate(self, self->buffer + self->bufferUsed, nAppended);
+      self->internalDelayed += nAppended;
+      self->bufferUsed += nAppended;
+      if(self->bufferUsed < self->param.maxWindowSize)
+        return -1;
+    }
 
-  /* do pyin */
-  int windowSize = 0;
-  int newWindowSize = std::max(static_cast<int>(roundUpToPowerOf2(self->param.samprate / self->param.minFreq * 4.0)), self->param.hopSize * 2);
-  int iIter = 0;
+    rvAssert(self->bufferUsed >= self->param.maxWindowSize, "internal error");
 
-  int valleyIndexList[127];
-  int nValley;
-  while(newWindowSize != windowSize && iIter < self->param.maxIter)
-  {
-    windowSize = newWindowSize;
-    int halfDelta = (self->param.maxWindowSize - windowSize) / 2;
-    RvReal *frame = self->buffer + halfDelta;
-    rvYinDoDifference(self->differenceWorker, frame, windowSize, self->differenceTemp);
-    rvYinCumulativeDifference(self->differenceTemp, windowSize / 2);
-    nValley = rvYinFindValleys(self->differenceTemp, windowSize / 2, self->param.minFreq, self->param.maxFreq, self->param.samprate, self->param.valleyThreshold, self->param.valleyStep, valleyIndexList, 127);
-    if(nValley > 0)
+    /* skip silent frame, keeping analysis alive for gateHangover frames after the gate closes */
+    if(self->gateTracker)
     {
-      RvReal possibleFreq = clip(self->param.minFreq, self->param.samprate / valleyIndexList[nValley - 1] - 20.0, self->param.maxFreq);
-      newWindowSize = std::max(static_cast<int>(std::ceil(self->param.samprate / possibleFreq * 4.0)), self->param.hopSize * 2);
-      if(newWindowSize % 2 != 0)
-        newWindowSize += 1;
-      iIter += 1;
+      if(!rvRTEnergyTrackerIsSilent(self->gateTracker))
+        self->gateHold = self->param.gateHangover;
+      else if(self->gateHold > 0)
+        --self->gateHold;
+      else
+      {
+        ++self->nSkipped;
+        shiftBuffer(self);
+        return 0;
+      }
     }
-  }
 
-  RvReal probTotal = 0.0;
-  RvReal weightedProbTotal = 0.0;
-  for(int iValley = 0; iValley < nValley; ++iValley)
-  {
-    auto result = rvParabolicInterp(self->differenceTemp, windowSize / 2, valleyIndexList[iValley], false);
-    RvReal freq = self->param.samprate / result.x;
-    RvReal v0 = iValley == 0 ? 1.0 : std::min(1.0, self->differenceTemp[valleyIndexList[iValley - 1]] + 1e-10);
-    RvReal v1 = iValley == nValley - 1 ? 0.0 : std::max(0.0, self->differenceTemp[valleyIndexList[iValley + 1]]) + 1e-10;
-    RvReal prob = 0.0;
-    for(int i = static_cast<int>(v1 * self->param.pdfSize); i < static_cast<int>(v0 * self->param.pdfSize); ++i)
-      prob += self->param.pdf[i] * (result.y < static_cast<RvReal>(i) / static_cast<RvReal>(self->param.pdfSize) ? 1.0 : 0.01);
-    prob = std::min(prob, 0.99);
-    prob *= self->param.bias;
-    probTotal += prob;
-    if(result.y < self->param.probThreshold)
-      prob *= self->param.weightPrior;
-    weightedProbTotal += prob;
-    out[iValley * 2] = freq;
-    out[iValley * 2 + 1] = prob;
-  }
+    /* do pyin */
+    int windowSize = 0;
+    int newWindowSize = std::max(static_cast<int>(roundUpToPowerOf2(self->param.samprate / self->param.minFreq * 4.0)), self->param.hopSize * 2);
+    int iIter = 0;
 
-  if(nValley > 0 && weightedProbTotal != 0.0)
-  {
+    int valleyIndexList[127];
+    int nValley;
+    while(newWindowSize != windowSize && iIter < self->param.maxIter)
+    {
+      windowSize = newWindowSize;
+      int halfDelta = (self->param.maxWindowSize - windowSize) / 2;
+      RvReal *frame = self->buffer + halfDelta;
+      rvYinDoDifference(self->differenceWorker, frame, windowSize, self->differenceTemp);
+      rvYinCumulativeDifference(self->differenceTemp, windowSize / 2);
+      nValley = rvYinFindValleys(self->differenceTemp, windowSize / 2, self->param.minFreq, self->param.maxFreq, self->param.samprate, self->param.valleyThreshold, self->param.valleyStep, valleyIndexList, 127);
+      if(nValley > 0)
+      {
+        RvReal possibleFreq = clip(self->param.minFreq, self->param.samprate / valleyIndexList[nValley - 1] - 20.0, self->param.maxFreq);
+        newWindowSize = std::max(static_cast<int>(std::ceil(self->param.samprate / possibleFreq * 4.0)), self->param.hopSize * 2);
+        if(newWindowSize % 2 != 0)
+          newWindowSize += 1;
+        iIter += 1;
+      }
+    }
+
+    RvReal probTotal = 0.0;
+    RvReal weightedProbTotal = 0.0;
     for(int iValley = 0; iValley < nValley; ++iValley)
-      out[iValley * 2 + 1] *= probTotal / weightedProbTotal;
+    {
+      auto result = rvParabolicInterp(self->differenceTemp, windowSize / 2, valleyIndexList[iValley], false);
+      RvReal freq = self->param.samprate / result.x;
+      RvReal v0 = iValley == 0 ? 1.0 : std::min(1.0, self->differenceTemp[valleyIndexList[iValley - 1]] + 1e-10);
+      RvReal v1 = iValley == nValley - 1 ? 0.0 : std::max(0.0, self->differenceTemp[valleyIndexList[iValley + 1]]) + 1e-10;
+      RvReal prob = 0.0;
+      for(int i = static_cast<int>(v1 * self->param.pdfSize); i < static_cast<int>(v0 * self->param.pdfSize); ++i)
+        prob += self->param.pdf[i] * (result.y < static_cast<RvReal>(i) / static_cast<RvReal>(self->param.pdfSize) ? 1.0 : 0.01);
+      prob = std::min(prob, 0.99);
+      prob *= self->param.bias;
+      probTotal += prob;
+      if(result.y < self->param.probThreshold)
+        prob *= self->param.weightPrior;
+      weightedProbTotal += prob;
+      out[iValley * 2] = freq;
+      out[iValley * 2 + 1] = prob;
+    }
+
+    if(nValley > 0 && weightedProbTotal != 0.0)
+    {
+      for(int iValley = 0; iValley < nValley; ++iValley)
+        out[iValley * 2 + 1] *= probTotal / weightedProbTotal;
+    }
+
+    shiftBuffer(self);
+
+    return nValley;
   }
+} // namespace ReVoice
 
-  std::copy(self->buffer + self->param.hopSize, self->buffer + self->bufferUsed, self->buffer);
-  std::fill(self->buffer + self->bufferUsed, self->buffer + self->bufferSize, 0.0);
-  self->internalDelayed -= self->param.hopSize;
-  self->bufferUsed -= self->param.hopSize;
+int rvCallRTPYin(RvRTPYinProcessor *self, const RvReal *x, int nX, RvReal *out, int maxOut)
+{
+  rvAssert(x || nX == 0, "x cannot be nullptr with non-zero nX");
+  rvAssert(nX >= 0 && nX <= self->param.hopSize, "invalid nX");
+  RvReal *appended = self->buffer + self->bufferUsed;
+  return analyzeRTPYin(self, appended, prefilterRTPYin(self, x, nX, appended), out, maxOut);
+}
+
+void rvResetRTPYinProcessor(RvRTPYinProcessor *self)
+{
+  if(self->filterProc)
+    rvResetRTFilter(self->filterProc);
+  self->internalDelayed = 0;
+  self->bufferUsed = self->param.maxWindowSize / 2;
+  std::fill(self->buffer, self->buffer + self->bufferSize, 0.0);
 
-  return nValley;
+  self->gateHold = 0;
+  self->nSkipped = 0;
+  if(self->gateTracker)
+  {
+    rvResetRTEnergyTracker(self->gateTracker);
+    feedGate(self, nullptr, self->param.maxWindowSize / 2);
+  }
 }
 
 void rvDestroyRTPYinProcessor(RvRTPYinProcessor *self)
 {
-  rvFree(self->param.pdf);
   if(self->param.prefilter)
     rvDestroyRTFilter(self->filterProc);
   rvDestroyYinDifferenceWorker(self->differenceWorker);
-  rvFree(self->buffer);
-  rvFree(self->differenceTemp);
+  if(self->gateTracker)
+    rvDestroyRTEnergyTracker(self->gateTracker);
+  if(self->ownsMemory)
+    rvFree(self);
+}
+
+RvRTPYinProcessorPool *rvCreateRTPYinProcessorPool(const RvRTPYinProcessorParameter *param, int nProcessor)
+{
+  checkParameter(param);
+  auto layoutProcessor = [param](Arena &arena) { return layoutRTPYin(arena, *param); };
+  Arena measure;
+  layoutProcessorPool<RvRTPYinProcessorPool, RvRTPYinProcessor>(measure, nProcessor, layoutProcessor);
+  Arena arena(RVALLOC(char, measure.size()));
+  return layoutProcessorPool<RvRTPYinProcessorPool, RvRTPYinProcessor>(arena, nProcessor, layoutProcessor);
 }
 
+RvRTPYinProcessor *rvRTPYinProcessorPoolAcquire(RvRTPYinProcessorPool *pool)
+{ return acquireFromPool(pool); }
+
+void rvRTPYinProcessorPoolRelease(RvRTPYinProcessorPool *pool, RvRTPYinProcessor *rtpyin)
+{ releaseToPool(pool, rtpyin, rvResetRTPYinProcessor); }
+
+void rvDestroyRTPYinProcessorPool(RvRTPYinProcessorPool *pool)
+{ destroyProcessorPool(pool, rvDestroyRTPYinProcessor); }
+
 int rvRTPYinDelay(const RvRTPYinProcessorParameter *param)
 {
   int delay = param->maxWindowSize / 2;
   if(param->prefilter)
-  {
-    int filterOrder = static_cast<int>(2048.0 * param->samprate / 44100.0);
-    if(filterOrder % 2 == 0)
-      filterOrder += 1;
-    delay += filterOrder;
-  }
+    delay += prefilterOrder(*param);
   return delay;
 }
\ No newline at end of file
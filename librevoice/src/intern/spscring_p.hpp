@@ -0,0 +1,53 @@
+#pragma once
+
+#include "util_p.hpp"
+#include <atomic>
+
+namespace ReVoice
+{
+  // bounded single-producer single-consumer ring over preallocated slots, neither side blocks or allocates
+  // the producer fills the slot from beginWrite and publishes it with commitWrite, the consumer reads peek() until release()
+  template<typename T>class SpscRing
+  {
+  public:
+    void init(T *slotList, int capacity)
+    {
+      rvAssert(capacity > 0, "capacity must be greater than 0");
+      this->slotList = slotList;
+      this->capacity = static_cast<size_t>(capacity);
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+    }
+
+    // nullptr when full
+    T *beginWrite()
+    {
+      size_t iTail = tail.load(std::memory_order_relaxed);
+      if(iTail - head.load(std::memory_order_acquire) == capacity)
+        return nullptr;
+      return slotList + iTail % capacity;
+    }
+
+    void commitWrite()
+    { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // nullptr when empty
+    T *peek()
+    {
+      size_t iHead = head.load(std::memory_order_relaxed);
+      if(iHead == tail.load(std::memory_order_acquire))
+        return nullptr;
+      return slotList + iHead % capacity;
+    }
+
+    void release()
+    { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  private:
+    T *slotList;
+    size_t capacity;
+    // indices only grow, each on its own cache line so the two sides do not contend
+    RV_ALIGNED(64) std::atomic<size_t> head;
+    RV_ALIGNED(64) std::atomic<size_t> tail;
+  };
+} // namespace ReVoice
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "util_p.hpp"
+#include "../rtpyin.h"
+#include "../rtpitchtracker.h"
+#include "../hmm.h"
+#include "../hnm.h"
+
+// processors split into stages that can run on different threads, see rtpitchpipeline.cpp
+// calling the stages in order on the same data is what the public call does
+namespace ReVoice
+{
+  // rvCallRTPYin writes at most 127 (freq, prob) pairs whatever maxOut is, buffers for its output hold this many
+  constexpr int rtPYinMaxCandidate = 128;
+
+  // prefilterRTPYin writes what rvCallRTPYin would append to the analysis buffer, at most rtPYinMaxPrefilterOutput samples
+  // analyzeRTPYin consumes it and returns what rvCallRTPYin returns
+  int rtPYinMaxPrefilterOutput(const RvRTPYinProcessor *rtpyin);
+  int prefilterRTPYin(RvRTPYinProcessor *rtpyin, const RvReal *x, int nX, RvReal *out);
+  int analyzeRTPYin(RvRTPYinProcessor *rtpyin, const RvReal *appended, int nAppended, RvReal *out, int maxOut);
+
+  // rvCallRTPitchTracker after its pyin call, candidate holds nCandidate (freq, prob) pairs
+  RvRTPYinProcessor *rtPitchTrackerPYin(RvRTPitchTracker *tracker);
+  int rtPitchTrackerMaxCandidate(const RvRTPitchTracker *tracker);
+  int trackRTPitchTracker(RvRTPitchTracker *tracker, const RvReal *x, int nX, const RvReal *candidate, int nCandidate, int *frameIndex, RvReal *f0);
+
+  // copies the maxCandidate most probable (freq, prob) pairs to out in their order and returns how many it kept
+  // the monopitch and mononote processors see no more candidates than this
+  int keepProbableCandidate(const RvReal *obsProb, int nObsProb, int maxCandidate, RvReal *out);
+
+  // per-hop pieces of rvCallRTMonoPitch for decoders that keep their own history, see pitchtracker.cpp
+  // they only read the processor, obsFreq holds nObsFreq frequencies stride values apart
+  RvSparseHMM *acquireMonoPitchModel(const RvRTMonoPitchProcessorParameter *param);
+  int monoPitchOnsetFrameOffset(const RvRTMonoPitchProcessorParameter *param, RvReal freq);
+  void monoPitchStateProb(const RvRTMonoPitchProcessor *self, const RvReal *obsProb, int nObsProb, RvReal *out);
+  RvReal monoPitchPathFreq(const RvRTMonoPitchProcessor *self, int state, const RvReal *obsFreq, int nObsFreq, int stride);
+
+  // per-hop pieces of rvCallRTHNMSynthesizer, which rvCallHNMSynthesizer runs on ranges of hops
+  // basePhase is the integrated f0 at a hop, hnmHopHarmonic turns the analyzer output into absolute harmonics with zero amplitude for missing ones
+  // hnmHoldHop gives the hop after one that is held, hnmRenderSegment renders hopSize samples from one hop to the next
+  RvReal hnmNextBasePhase(const RvHNMSynthesizerParameter *param, RvReal basePhase, RvReal f0, RvReal nextF0);
+  void hnmHopHarmonic(const RvHNMSynthesizerParameter *param, int maxHar, RvReal f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, RvReal sinusoidEnergy, RvReal basePhase, RvReal *freq, RvReal *amp, RvReal *phase);
+  void hnmHoldHop(const RvHNMSynthesizerParameter *param, int maxHar, const RvReal *phase, const RvReal *freq, RvReal *nextPhase);
+  int hnmSegmentScratchSize(const RvHNMSynthesizerParameter *param, int maxHar);
+  void hnmRenderSegment(const RvHNMSynthesizerParameter *param, int maxHar, const RvReal *freq, const RvReal *amp, const RvReal *phase, const RvReal *nextFreq, const RvReal *nextAmp, const RvReal *nextPhase, RvReal *scratch, RvReal *out);
+} // namespace ReVoice
@@ -0,0 +1,278 @@
+#include "../threadpool.h"
+
+#include "util_p.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+using namespace ReVoice;
+
+namespace
+{
+  struct Job
+  {
+    RvRangeFunc *func;
+    void *userData;
+    // chunks not finished yet, only changed under doneLock
+    int nRemaining;
+    std::mutex doneLock;
+    std::condition_variable doneCond;
+  };
+
+  struct Task
+  {
+    Job *job;
+    int iBegin, iEnd;
+  };
+
+  // owner pops from the back, thieves take from the front
+  struct TaskQueue
+  {
+    std::mutex lock;
+    std::deque<Task> taskList;
+  };
+} // namespace
+
+typedef struct RvThreadPool
+{
+  TaskQueue *queueList;
+  int nQueue;
+  std::atomic<unsigned int> nextQueue;
+
+  std::vector<std::thread> threadList;
+  RvExecutorFunc *executor;
+  void *executorUserData;
+
+  // nPending counts queued tasks, sleeping workers and the destructor wait on sleepCond
+  std::mutex sleepLock;
+  std::condition_variable sleepCond;
+  int nPending, nDrain;
+  bool stopping;
+} RvThreadPool;
+
+// queue of the current worker thread, -1 elsewhere
+static thread_local const RvThreadPool *t_ownerPool = nullptr;
+static thread_local int t_ownerQueue = -1;
+
+static std::atomic<RvThreadPool*> g_sharedPool(nullptr);
+
+static bool popTask(RvThreadPool *self, Task &task)
+{
+  int iOwn = t_ownerPool == self ? t_ownerQueue : -1;
+  if(iOwn >= 0)
+  {
+    TaskQueue &queue = self->queueList[iOwn];
+    std::unique_lock<std::mutex> locker(queue.lock);
+    if(!queue.taskList.empty())
+    {
+      task = queue.taskList.back();
+      queue.taskList.pop_back();
+      locker.unlock();
+      std::unique_lock<std::mutex> sleepLocker(self->sleepLock);
+      --self->nPending;
+      return true;
+    }
+  }
+  int iStart = iOwn >= 0 ? iOwn + 1 : 0;
+  for(int i = 0; i < self->nQueue; ++i)
+  {
+    TaskQueue &queue = self->queueList[(iStart + i) % self->nQueue];
+    std::unique_lock<std::mutex> locker(queue.lock);
+    if(!queue.taskList.empty())
+    {
+      task = queue.taskList.front();
+      queue.taskList.pop_front();
+      locker.unlock();
+      std::unique_lock<std::mutex> sleepLocker(self->sleepLock);
+      --self->nPending;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void runTask(const Task &task)
+{
+  Job *job = task.job;
+  job->func(task.iBegin, task.iEnd, job->userData);
+  std::unique_lock<std::mutex> locker(job->doneLock);
+  if(--job->nRemaining == 0)
+    job->doneCond.notify_all();
+}
+
+static void workerMain(RvThreadPool *self, int iQueue)
+{
+  t_ownerPool = self;
+  t_ownerQueue = iQueue;
+  Task task;
+  while(true)
+  {
+    if(popTask(self, task))
+    {
+      runTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> locker(self->sleepLock);
+    self->sleepCond.wait(locker, [self]() { return self->stopping || self->nPending > 0; });
+    if(self->stopping && self->nPending == 0)
+      return;
+  }
+}
+
+static void drainMain(void *arg)
+{
+  auto self = reinterpret_cast<RvThreadPool*>(arg);
+  Task task;
+  while(popTask(self, task))
+    runTask(task);
+  std::unique_lock<std::mutex> locker(self->sleepLock);
+  --self->nDrain;
+  self->sleepCond.notify_all();
+}
+
+static void pinThread(std::thread &thread, int cpu)
+{
+  rvAssert(cpu >= 0, "invalid cpu");
+#if defined(_WIN32)
+  SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << cpu);
+#elif defined(__linux__)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet);
+#else
+  (void)thread;
+#endif
+}
+
+static RvThreadPool *createPool(int nQueue)
+{
+  auto self = new RvThreadPool;
+  self->nQueue = std::max(nQueue, 1);
+  self->queueList = new TaskQueue[self->nQueue];
+  self->nextQueue = 0;
+  self->executor = nullptr;
+  self->executorUserData = nullptr;
+  self->nPending = 0;
+  self->nDrain = 0;
+  self->stopping = false;
+  return self;
+}
+
+RvThreadPool *rvCreateThreadPool(int nThread, const int *cpuList)
+{
+  if(nThread < 0)
+    nThread = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+  auto self = createPool(nThread);
+  for(int i = 0; i < nThread; ++i)
+  {
+    self->threadList.emplace_back(workerMain, self, i);
+    if(cpuList)
+      pinThread(self->threadList.back(), cpuList[i]);
+  }
+  return self;
+}
+
+RvThreadPool *rvCreateThreadPoolWithExecutor(RvExecutorFunc *executor, int nConcurrency, void *userData)
+{
+  rvAssert(executor, "executor cannot be nullptr");
+  rvAssert(nConcurrency > 0, "nConcurrency must be greater than 0");
+  auto self = createPool(nConcurrency);
+  self->executor = executor;
+  self->executorUserData = userData;
+  return self;
+}
+
+int rvThreadPoolSize(const RvThreadPool *self)
+{ return self->executor ? self->nQueue : static_cast<int>(self->threadList.size()); }
+
+void rvThreadPoolParallelFor(RvThreadPool *self, int n, int grainSize, RvRangeFunc *func, void *userData)
+{
+  rvAssert(self, "pool cannot be nullptr");
+  rvAssert(n >= 0, "n cannot be less than 0");
+  rvAssert(grainSize > 0, "grainSize must be greater than 0");
+  rvAssert(func, "func cannot be nullptr");
+  if(n == 0)
+    return;
+  int nChunk = (n + grainSize - 1) / grainSize;
+  int nHelper = rvThreadPoolSize(self);
+  if(nChunk == 1 || nHelper == 0)
+  {
+    func(0, n, userData);
+    return;
+  }
+
+  Job job;
+  job.func = func;
+  job.userData = userData;
+  job.nRemaining = nChunk;
+
+  // consecutive chunks go to consecutive queues, so the front of every queue is an early part of the range
+  unsigned int iQueue = self->nextQueue.fetch_add(1, std::memory_order_relaxed);
+  for(int iChunk = 0; iChunk < nChunk; ++iChunk)
+  {
+    TaskQueue &queue = self->queueList[(iQueue + iChunk) % self->nQueue];
+    std::unique_lock<std::mutex> locker(queue.lock);
+    queue.taskList.push_back({&job, iChunk * grainSize, std::min((iChunk + 1) * grainSize, n)});
+  }
+  {
+    std::unique_lock<std::mutex> locker(self->sleepLock);
+    self->nPending += nChunk;
+    if(self->executor)
+      self->nDrain += std::min(nHelper, nChunk - 1);
+  }
+  if(self->executor)
+  {
+    for(int i = 0; i < std::min(nHelper, nChunk - 1); ++i)
+      self->executor(drainMain, self, self->executorUserData);
+  }
+  else
+    self->sleepCond.notify_all();
+
+  // help until the queues are empty, then wait for chunks still running elsewhere
+  Task task;
+  while(popTask(self, task))
+    runTask(task);
+  std::unique_lock<std::mutex> locker(job.doneLock);
+  job.doneCond.wait(locker, [&job]() { return job.nRemaining == 0; });
+}
+
+void rvDestroyThreadPool(RvThreadPool *self)
+{
+  rvAssert(self != g_sharedPool.load(), "cannot destroy the shared pool, replace it first");
+  {
+    std::unique_lock<std::mutex> locker(self->sleepLock);
+    self->stopping = true;
+    // drains submitted to the executor may not have run yet
+    self->sleepCond.wait(locker, [self]() { return self->nDrain == 0; });
+  }
+  self->sleepCond.notify_all();
+  for(auto &thread : self->threadList)
+    thread.join();
+  delete[] self->queueList;
+  delete self;
+}
+
+void rvSetSharedThreadPool(RvThreadPool *pool)
+{ g_sharedPool.store(pool); }
+
+RvThreadPool *rvSharedThreadPool()
+{
+  RvThreadPool *pool = g_sharedPool.load();
+  if(pool)
+    return pool;
+  // never destroyed, joining workers during unload is not safe
+  static RvThreadPool *builtinPool = rvCreateThreadPool(-1, nullptr);
+  return builtinPool;
+}
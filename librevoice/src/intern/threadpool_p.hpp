@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../threadpool.h"
+#include <type_traits>
+
+namespace ReVoice
+{
+  // rvThreadPoolParallelFor with func(iBegin, iEnd)
+  template<typename F>void parallelFor(RvThreadPool *pool, int n, int grainSize, F &&func)
+  {
+    typedef typename std::remove_reference<F>::type Func;
+    auto run = [](int iBegin, int iEnd, void *userData) { (*static_cast<Func*>(userData))(iBegin, iEnd); };
+    rvThreadPoolParallelFor(pool, n, grainSize, run, const_cast<void*>(static_cast<const void*>(&func)));
+  }
+} // namespace ReVoice
@@ -1,4 +1,5 @@
 #include "util_p.hpp"
+#include "layout_p.hpp"
 
 using namespace ReVoice;
 
@@ -9,6 +10,7 @@ struct RvFFTConvolver
   RvComplex *cWorkMem;
   RvReal *rWorkMem;
   int maxSize;
+  bool ownsMemory;
 };
 
 void rvConvolve(const RvReal *x, int nX, const RvReal *y, int nY, RvReal *out)
@@ -28,28 +30,47 @@ void rvConvolve(const RvReal *x, int nX, const RvReal *y, int nY, RvReal *out)
   }
 }
 
+namespace ReVoice
+{
+  RvFFTConvolver *layoutFFTConvolver(Arena &arena, int maxSize)
+  {
+    rvAssert(maxSize > 0, "maxSize must be greater than 0");
+    rvAssert(roundUpToPowerOf2(maxSize) == maxSize, "maxSize must be power of 2");
+    int nF = maxSize / 2 + 1;
+    auto convolver = arena.construct<RvFFTConvolver>();
+    auto rfft = layoutRFFT(arena, maxSize);
+    auto irfft = layoutIRFFT(arena, maxSize);
+    auto cWorkMem = arena.take<RvComplex>(nF * 2);
+    auto rWorkMem = arena.take<RvReal>(maxSize);
+    if(arena.isMeasuring())
+      return nullptr;
+    convolver->rfft = rfft;
+    convolver->irfft = irfft;
+    convolver->cWorkMem = cWorkMem;
+    convolver->rWorkMem = rWorkMem;
+    convolver->maxSize = maxSize;
+    convolver->ownsMemory = false;
+    return convolver;
+  }
+} // namespace ReVoice
+
 RvFFTConvolver *rvCreateFFTConvolver(int maxSize)
 {
-  rvAssert(maxSize > 0, "maxSize must be greater than 0");
-  rvAssert(roundUpToPowerOf2(maxSize) == maxSize, "maxSize must be power of 2");
-  int nF = maxSize / 2 + 1;
-  auto convolver = new RvFFTConvolver;
-  convolver->rfft = rvCreateRFFT(maxSize);
-  convolver->irfft = rvCreateIRFFT(maxSize);
-  convolver->cWorkMem = RVALLOC(RvComplex, nF * 2);
-  convolver->rWorkMem = RVALLOC(RvReal, maxSize);
-  convolver->maxSize = maxSize;
+  Arena measure;
+  layoutFFTConvolver(measure, maxSize);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto convolver = layoutFFTConvolver(arena, maxSize);
+  convolver->ownsMemory = true;
   return convolver;
 }
 
 void rvDestroyFFTConvolver(RvFFTConvolver *convolver)
 {
   rvAssert(convolver, "convolver cannot be nullptr");
-  rvFree(convolver->rWorkMem);
-  rvFree(convolver->cWorkMem);
   rvDestroyRFFT(convolver->rfft);
   rvDestroyIRFFT(convolver->irfft);
-  delete convolver;
+  if(convolver->ownsMemory)
+    rvFree(convolver);
 }
 
 void rvFFTConvolve(RvFFTConvolver *convolver, const RvReal *x, int nX, const RvReal *y, int nY, RvReal *out)
@@ -1,4 +1,5 @@
 #include "util_p.hpp"
+#include "layout_p.hpp"
 
 #include "fftsg_h.h"
 
@@ -7,19 +8,46 @@ using namespace ReVoice;
 struct RvRFFT
 {
   bool inverse;
+  bool ownsMemory;
   int fftSize;
   double *transformBuffer;
 };
 
+namespace ReVoice
+{
+  RvRFFT *layoutRFFT(Arena &arena, int fftSize)
+  {
+    rvAssert(fftSize > 0, "fftSize must be greater than 0");
+    rvAssert(roundUpToPowerOf2(fftSize) == fftSize, "fftSize must be power of 2");
+    auto rfft = arena.construct<RvRFFT>();
+    auto transformBuffer = arena.take<double>(fftSize * 2);
+    if(arena.isMeasuring())
+      return nullptr;
+    rfft->inverse = false;
+    rfft->ownsMemory = false;
+    rfft->fftSize = fftSize;
+    rfft->transformBuffer = transformBuffer;
+    std::fill(rfft->transformBuffer, rfft->transformBuffer + fftSize * 2, 0.0);
+    return rfft;
+  }
+
+  RvIRFFT *layoutIRFFT(Arena &arena, int fftSize)
+  {
+    rvAssert(fftSize % 2 == 0, "odd fftSize is not supported in IRFFT");
+    auto obj = layoutRFFT(arena, fftSize);
+    if(obj)
+      obj->inverse = true;
+    return reinterpret_cast<RvIRFFT*>(obj);
+  }
+} // namespace ReVoice
+
 RvRFFT *rvCreateRFFT(int fftSize)
 {
-  rvAssert(fftSize > 0, "fftSize must be greater than 0");
-  rvAssert(roundUpToPowerOf2(fftSize) == fftSize, "fftSize must be power of 2");
-  auto rfft = new RvRFFT;
-  rfft->inverse = false;
-  rfft->fftSize = fftSize;
-  rfft->transformBuffer = RVALLOC(double, fftSize * 2);
-  std::fill(rfft->transformBuffer, rfft->transformBuffer + fftSize * 2, 0.0);
+  Arena measure;
+  layoutRFFT(measure, fftSize);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto rfft = layoutRFFT(arena, fftSize);
+  rfft->ownsMemory = true;
   return rfft;
 }
 
@@ -27,8 +55,8 @@ void rvDestroyRFFT(RvRFFT *rfft)
 {
   rvAssert(rfft, "rfft cannot be nullptr");
   rvAssert(!rfft->inverse, "not a rfft object");
-  rvFree(rfft->transformBuffer);
-  delete rfft;
+  if(rfft->ownsMemory)
+    rvFree(rfft);
 }
 
 void rvDoRFFT(RvRFFT *rfft, const RvReal *in, RvComplex *out)
@@ -1,9 +1,276 @@
 #include "util_p.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstdarg>
+#include <mutex>
+#include <thread>
 
 using namespace ReVoice;
 
+static_assert(static_cast<int>(DebugMessage) == RvLogDebug && static_cast<int>(FatalMessage) == RvLogFatal, "MessageCategory must match RvLogSeverity");
+
+namespace
+{
+  // bounded multi-producer queue with per-slot sequence numbers, producers never block or allocate
+  // a slot is free for position pos when sequence == pos and holds a message when sequence == pos + 1
+  constexpr size_t queueSize = 256;
+  constexpr size_t maxMessageLength = 1024;
+
+  struct LogSlot
+  {
+    std::atomic<size_t> sequence;
+    int severity;
+    char text[maxMessageLength];
+  };
+
+  struct LogQueue
+  {
+    LogQueue() : enqueuePos(0), dequeuePos(0), nDropped(0)
+    {
+      for(size_t i = 0; i < queueSize; ++i)
+        slotList[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    LogSlot slotList[queueSize];
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+    std::atomic<int> nDropped;
+  };
+
+  // call sites are told apart by their format string
+  constexpr int siteTableSize = 256;
+  constexpr size_t maxSummaryLength = 256;
+
+  struct LogSite
+  {
+    std::atomic<const char*> msg;
+    std::atomic<long long> windowBegin;
+    std::atomic<int> nInWindow, nSuppressed, severity;
+    // first suppressed message of the latest window, producers skip the update instead of waiting for textBusy
+    std::atomic<bool> textBusy;
+    char text[maxSummaryLength];
+  };
+
+  // the drain thread outlives static destruction, so its locks are never destroyed
+  struct DrainSync
+  {
+    // sink and queue consumption, recursive so a fatal message raised inside a sink can still flush
+    std::recursive_mutex consumerLock;
+    std::mutex wakeLock;
+    std::condition_variable wakeCond;
+    bool wakeRequested = false;
+  };
+} // namespace
+
+static LogQueue g_queue;
+static LogSite g_siteTable[siteTableSize];
+static std::atomic<int> g_minSeverity(RvLogDebug);
+static std::atomic<int> g_rateLimit(10);
+
+alignas(DrainSync) static unsigned char g_syncStorage[sizeof(DrainSync)];
+static DrainSync &g_sync = *new(g_syncStorage) DrainSync;
+static std::once_flag g_drainThreadOnce;
+
+// guarded by consumerLock
+static RvLogSinkFunc *g_sink = nullptr;
+static void *g_sinkUserData = nullptr;
+
+static long long nowMs()
+{ return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+static void stderrSink(int severity, const char *message, int nSuppressed, void *userData)
+{
+  (void)severity; (void)userData;
+  if(nSuppressed > 0)
+    fprintf(stderr, "RVD: %d more message(s) like \"%s\" suppressed\n", nSuppressed, message);
+  else
+    fprintf(stderr, "%s\n", message);
+}
+
+static void deliver(int severity, const char *message, int nSuppressed)
+{
+  RvLogSinkFunc *sink = g_sink ? g_sink : stderrSink;
+  sink(severity, message, nSuppressed, g_sinkUserData);
+}
+
+// nullptr when the table is full, such sites are not rate limited
+static LogSite *findSite(const char *msg)
+{
+  size_t h = reinterpret_cast<size_t>(msg);
+  h ^= h >> 17;
+  for(int iProbe = 0; iProbe < siteTableSize; ++iProbe)
+  {
+    LogSite &site = g_siteTable[(h + iProbe) % siteTableSize];
+    const char *current = site.msg.load(std::memory_order_acquire);
+    if(current == msg)
+      return &site;
+    if(!current && site.msg.compare_exchange_strong(current, msg, std::memory_order_acq_rel))
+      return &site;
+    if(current == msg)
+      return &site;
+  }
+  return nullptr;
+}
+
+static bool passRateLimit(MessageCategory category, const char *msg, va_list args)
+{
+  int limit = g_rateLimit.load(std::memory_order_relaxed);
+  if(limit <= 0)
+    return true;
+  LogSite *site = findSite(msg);
+  if(!site)
+    return true;
+
+  long long now = nowMs();
+  long long begin = site->windowBegin.load(std::memory_order_relaxed);
+  if(now - begin >= 1000 && site->windowBegin.compare_exchange_strong(begin, now, std::memory_order_relaxed))
+    site->nInWindow.store(0, std::memory_order_relaxed);
+  int iInWindow = site->nInWindow.fetch_add(1, std::memory_order_relaxed);
+  if(iInWindow < limit)
+    return true;
+  // only the message the summary shows is formatted, the rest of the window is just counted
+  if(iInWindow == limit && !site->textBusy.exchange(true, std::memory_order_acquire))
+  {
+    vsnprintf(site->text, maxSummaryLength, msg, args);
+    site->textBusy.store(false, std::memory_order_release);
+  }
+  site->severity.store(category, std::memory_order_relaxed);
+  site->nSuppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+static bool enqueue(MessageCategory category, const char *msg, va_list args)
+{
+  size_t pos = g_queue.enqueuePos.load(std::memory_order_relaxed);
+  LogSlot *slot;
+  while(true)
+  {
+    slot = &g_queue.slotList[pos % queueSize];
+    auto diff = static_cast<std::ptrdiff_t>(slot->sequence.load(std::memory_order_acquire) - pos);
+    if(diff == 0)
+    {
+      if(g_queue.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    // still holding the message from one lap earlier
+    else if(diff < 0)
+      return false;
+    else
+      pos = g_queue.enqueuePos.load(std::memory_order_relaxed);
+  }
+  slot->severity = category;
+  vsnprintf(slot->text, maxMessageLength, msg, args);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+// hands queued messages and the summaries of suppressed ones to the sink
+// without force only sites whose window has ended are summarized
+static void drainLog(bool force)
+{
+  std::unique_lock<std::recursive_mutex> locker(g_sync.consumerLock);
+  int nDropped = g_queue.nDropped.exchange(0, std::memory_order_relaxed);
+  if(nDropped > 0)
+  {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "RVD: %d message(s) dropped, log queue is full", nDropped);
+    deliver(RvLogWarning, buffer, 0);
+  }
+  while(true)
+  {
+    LogSlot &slot = g_queue.slotList[g_queue.dequeuePos % queueSize];
+    if(slot.sequence.load(std::memory_order_acquire) != g_queue.dequeuePos + 1)
+      break;
+    deliver(slot.severity, slot.text, 0);
+    slot.sequence.store(g_queue.dequeuePos + queueSize, std::memory_order_release);
+    ++g_queue.dequeuePos;
+  }
+
+  long long now = nowMs();
+  for(auto &site : g_siteTable)
+  {
+    const char *msg = site.msg.load(std::memory_order_acquire);
+    if(!msg || site.nSuppressed.load(std::memory_order_relaxed) == 0)
+      continue;
+    if(!force && now - site.windowBegin.load(std::memory_order_relaxed) < 1000)
+      continue;
+    int nSuppressed = site.nSuppressed.exchange(0, std::memory_order_relaxed);
+    if(nSuppressed > 0)
+    {
+      char text[maxSummaryLength];
+      while(site.textBusy.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+      std::copy(site.text, site.text + maxSummaryLength, text);
+      site.textBusy.store(false, std::memory_order_release);
+      // only empty if every update so far lost the race for textBusy
+      deliver(site.severity.load(std::memory_order_relaxed), text[0] ? text : msg, nSuppressed);
+    }
+  }
+}
+
+static void drainMain()
+{
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> locker(g_sync.wakeLock);
+      // messages queued in real-time sections do not wake the thread, they wait for the next tick
+      g_sync.wakeCond.wait_for(locker, std::chrono::milliseconds(50), []() { return g_sync.wakeRequested; });
+      g_sync.wakeRequested = false;
+    }
+    drainLog(false);
+  }
+}
+
+// the thread is detached and never joined, like the built-in thread pool
+// the consumer lock may be held by a thread killed during exit, so the exit flush gives up instead of waiting
+static void flushAtExit()
+{
+  if(!g_sync.consumerLock.try_lock())
+    return;
+  drainLog(true);
+  g_sync.consumerLock.unlock();
+}
+
+static void wakeDrainThread()
+{
+  std::call_once(g_drainThreadOnce, []()
+  {
+    std::thread(drainMain).detach();
+    std::atexit(flushAtExit);
+  });
+  std::unique_lock<std::mutex> locker(g_sync.wakeLock);
+  g_sync.wakeRequested = true;
+  g_sync.wakeCond.notify_one();
+}
+
+void rvSetLogSink(RvLogSinkFunc *sink, void *userData)
+{
+  wakeDrainThread();
+  std::unique_lock<std::recursive_mutex> locker(g_sync.consumerLock);
+  // pending messages still go to the old sink
+  drainLog(true);
+  g_sink = sink;
+  g_sinkUserData = userData;
+}
+
+void rvSetLogSeverity(int minSeverity)
+{
+  rvAssert(minSeverity >= RvLogDebug && minSeverity <= RvLogFatal, "invalid minSeverity");
+  g_minSeverity.store(minSeverity, std::memory_order_relaxed);
+}
+
+void rvSetLogRateLimit(int maxPerSecond)
+{
+  rvAssert(maxPerSecond >= 0, "maxPerSecond cannot be less than 0");
+  g_rateLimit.store(maxPerSecond, std::memory_order_relaxed);
+}
+
+void rvFlushLog()
+{ drainLog(true); }
+
 namespace ReVoice
 {
   void debug(const char * msg, ...)
@@ -38,13 +305,33 @@ namespace ReVoice
     va_end(args);
   }
 
+  // queued for the drain thread, except fatal messages which flush the queue and reach the sink before aborting
+  // queueing never blocks or allocates, so only the fatal path counts as a real-time violation
   void vPrintMessage(MessageCategory category, const char *msg, va_list args)
   {
-    char buffer[16384] = {'\x00'};
-    vsnprintf(buffer, sizeof(buffer), msg, args);
-    fprintf(stderr, "%s\n", buffer);
-
     if(category == FatalMessage)
+    {
+      checkRTSafety("fatal message below delivered", nullptr, nullptr, 0);
+      char buffer[16384] = {'\x00'};
+      vsnprintf(buffer, sizeof(buffer), msg, args);
+      std::unique_lock<std::recursive_mutex> locker(g_sync.consumerLock);
+      drainLog(true);
+      deliver(category, buffer, 0);
       std::abort();
+    }
+
+    if(category < g_minSeverity.load(std::memory_order_relaxed))
+      return;
+    // the arguments are consumed either by the suppressed text or by the queue
+    va_list limitArgs;
+    va_copy(limitArgs, args);
+    bool passed = passRateLimit(category, msg, limitArgs);
+    va_end(limitArgs);
+    if(!passed)
+      return;
+    if(!enqueue(category, msg, args))
+      g_queue.nDropped.fetch_add(1, std::memory_order_relaxed);
+    if(rvRTSectionDepth() == 0)
+      wakeDrainThread();
   }
-} // namespace ReVoice
\ No newline at end of file
+} // namespace ReVoice
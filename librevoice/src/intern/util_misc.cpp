@@ -127,7 +127,7 @@ ParabolicInterpolationResult rvParabolicInterp(const RvReal *x, int nX, int i, b
     RvReal s1 = x[i];
     RvReal s2 = x[i + 1];
     RvReal a = (s0 + s2) / 2.0 - s1;
-    if(a < 1e-32)
+    if(std::abs(a) < 1e-32)
       return {static_cast<RvReal>(i), x[i]};
     RvReal b = s2 - s1 - a;
     RvReal adjustment = -(b / a * 0.5);
@@ -2,6 +2,7 @@
 #include "../util.h"
 #include <algorithm>
 #include <numeric>
+#include <new>
 
 #include <cstdio>
 #include <cstdlib>
@@ -60,6 +61,9 @@ namespace ReVoice
   void rvFree(void *ptr);
   void rvCheckAllocated();
 
+  // reports what happened at the call site if the calling thread is in a real-time section
+  void checkRTSafety(const char *what, const char *file, const char *func, int line);
+
   template<typename T>static inline T *rvAlloc(size_t n, const char *file, const char *func, int line)
   { return reinterpret_cast<T*>(rvAlloc(n * sizeof(T), file, func, line)); }
 
@@ -69,6 +73,49 @@ namespace ReVoice
     ptr = nullptr;
   }
 
+  // carves an object and its buffers out of one block
+  // layout code runs twice with the same sequence of takes: first on an arena without base to measure size(), then on the allocated block
+  class Arena
+  {
+  public:
+    constexpr static size_t alignment = RV_INPLACE_ALIGNMENT;
+
+    explicit Arena(void *base = nullptr) : base(reinterpret_cast<char*>(base)), used(0)
+    {}
+
+    // arena over caller-provided memory
+    static Arena inPlace(void *mem)
+    {
+      rvAssert(mem, "mem cannot be nullptr");
+      rvAssert(reinterpret_cast<size_t>(mem) % alignment == 0, "mem must be aligned to RV_INPLACE_ALIGNMENT");
+      return Arena(mem);
+    }
+
+    bool isMeasuring() const
+    { return !base; }
+
+    size_t size() const
+    { return used; }
+
+    template<typename T>T *take(size_t n)
+    {
+      used = (used + alignment - 1) / alignment * alignment;
+      T *p = base ? reinterpret_cast<T*>(base + used) : nullptr;
+      used += n * sizeof(T);
+      return p;
+    }
+
+    template<typename T>T *construct()
+    {
+      T *p = take<T>(1);
+      return p ? new(p) T : nullptr;
+    }
+
+  private:
+    char *base;
+    size_t used;
+  };
+
   template<typename T>static inline T clip(T min, T v, T max)
   { return std::min(std::max(min, v), max); }
 
@@ -0,0 +1,61 @@
+#include "util_p.hpp"
+#include <atomic>
+#include <cstdarg>
+
+using namespace ReVoice;
+
+// sections nest per thread, checks are compiled in whenever the allocation guard is
+static thread_local int t_rtSectionDepth = 0;
+// set while a violation is being reported, the report itself is not checked again
+static thread_local bool t_reporting = false;
+static std::atomic<int> g_rtViolationCount(0);
+static std::atomic<bool> g_abortOnRTViolation(false);
+
+void rvEnterRTSection()
+{ ++t_rtSectionDepth; }
+
+void rvLeaveRTSection()
+{
+  rvAssert(t_rtSectionDepth > 0, "not in a real-time section");
+  --t_rtSectionDepth;
+}
+
+int rvRTSectionDepth()
+{ return t_rtSectionDepth; }
+
+int rvRTViolationCount()
+{ return g_rtViolationCount.load(std::memory_order_relaxed); }
+
+void rvSetAbortOnRTViolation(bool abortOnViolation)
+{ g_abortOnRTViolation.store(abortOnViolation, std::memory_order_relaxed); }
+
+// reports go through the log queue, the abort path is delivered at once
+static void report(bool abortAfter, const char *msg, ...)
+{
+  va_list args;
+  va_start(args, msg);
+  vPrintMessage(abortAfter ? FatalMessage : CriticalMessage, msg, args);
+  va_end(args);
+}
+
+namespace ReVoice
+{
+  void checkRTSafety(const char *what, const char *file, const char *func, int line)
+  {
+#ifndef DISABLE_ALLOCGUARD
+    if(t_rtSectionDepth == 0 || t_reporting)
+      return;
+    g_rtViolationCount.fetch_add(1, std::memory_order_relaxed);
+
+    bool abortAfter = g_abortOnRTViolation.load(std::memory_order_relaxed);
+    t_reporting = true;
+    if(file && func)
+      report(abortAfter, "RVD: %s in real-time section at %s@%s:%d", what, file, func, line);
+    else
+      report(abortAfter, "RVD: %s in real-time section", what);
+    t_reporting = false;
+#else // DISABLE_ALLOCGUARD
+    (void)what; (void)file; (void)func; (void)line;
+#endif // DISABLE_ALLOCGUARD
+  }
+} // namespace ReVoice
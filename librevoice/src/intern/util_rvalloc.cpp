@@ -1,7 +1,10 @@
 #include "util_p.hpp"
 #include <cstdlib>
-#include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <map>
+#include <vector>
+#include <cstring>
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4127)
@@ -11,6 +14,7 @@ using namespace ReVoice;
 
 constexpr static size_t alignment = 64;
 
+#ifndef DISABLE_ALLOCGUARD
 struct MemoryBlockAfter
 {
   size_t magic;
@@ -20,16 +24,65 @@ struct MemoryBlockBefore
 {
   void *headPtr;
   const char *file, *func;
-  int line;
+  int line, shard;
+  MemoryBlockBefore *prev, *next;
   MemoryBlockAfter *blockAfter;
   size_t size;
   size_t magic;
 };
 
-#ifndef DISABLE_ALLOCGUARD
-static std::mutex g_memoryBlockDictLock;
-static std::unordered_map<void*, MemoryBlockBefore*> g_memoryBlockDict;
-#endif // DISABLE_ALLOCGUARD
+// live blocks are kept in intrusive lists, one per shard
+// each thread allocates into its own shard, so threads creating processors concurrently rarely meet on a lock
+// a block remembers its shard and may be freed from any thread
+constexpr static int nShard = 16;
+
+struct RV_ALIGNED(64) MemoryShard
+{
+  std::mutex lock;
+  MemoryBlockBefore *head = nullptr;
+};
+
+static MemoryShard g_memoryShardList[nShard];
+static std::atomic<int> g_nextMemoryShard(0);
+
+static int currentShard()
+{
+  thread_local int shard = g_nextMemoryShard.fetch_add(1, std::memory_order_relaxed) % nShard;
+  return shard;
+}
+
+// totals are shared atomics rather than per shard, so peak and watermark checks see one global value
+static std::atomic<size_t> g_currentBytes(0), g_peakBytes(0), g_liveBlockCount(0);
+static std::atomic<size_t> g_watermark(0);
+static std::mutex g_watermarkLock;
+static RvMemoryWatermarkCallback *g_watermarkCallback = nullptr;
+static void *g_watermarkUserData = nullptr;
+
+static void countAlloc(size_t size)
+{
+  size_t newBytes = g_currentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+  g_liveBlockCount.fetch_add(1, std::memory_order_relaxed);
+  size_t peak = g_peakBytes.load(std::memory_order_relaxed);
+  while(newBytes > peak && !g_peakBytes.compare_exchange_weak(peak, newBytes, std::memory_order_relaxed))
+  {}
+
+  size_t watermark = g_watermark.load(std::memory_order_relaxed);
+  if(watermark > 0 && newBytes >= watermark && newBytes - size < watermark)
+  {
+    std::unique_lock<std::mutex> locker(g_watermarkLock);
+    auto callback = g_watermarkCallback;
+    auto userData = g_watermarkUserData;
+    locker.unlock();
+    if(callback)
+      callback(newBytes, watermark, userData);
+  }
+}
+
+static void countFree(size_t size)
+{
+  g_currentBytes.fetch_sub(size, std::memory_order_relaxed);
+  g_liveBlockCount.fetch_sub(1, std::memory_order_relaxed);
+}
 
 constexpr static size_t magicNumber()
 {
@@ -60,6 +113,7 @@ namespace ReVoice
   void *rvAlloc(size_t size, const char *file, const char *func, int line)
   {
     rvAssert(size > 0, "size must be greater than 0");
+    checkRTSafety("allocation", file, func, line);
     size_t additionalSize = sizeof(MemoryBlockBefore) + sizeof(MemoryBlockAfter);
     size_t paddedSize = size + alignment - 1;
     size_t totalSize = paddedSize + additionalSize;
@@ -74,16 +128,21 @@ namespace ReVoice
     before->file = file;
     before->func = func;
     before->line = line;
+    before->shard = currentShard();
+    before->prev = nullptr;
     before->blockAfter = after;
     before->size = size;
     before->magic = magicNumber();
     after->magic = magicNumber();
 
-#ifndef DISABLE_ALLOCGUARD
-    std::unique_lock<std::mutex> locker(g_memoryBlockDictLock);
-    g_memoryBlockDict.insert(std::make_pair(alignedAdditionalPtr, before));
+    MemoryShard &shard = g_memoryShardList[before->shard];
+    std::unique_lock<std::mutex> locker(shard.lock);
+    before->next = shard.head;
+    if(shard.head)
+      shard.head->prev = before;
+    shard.head = before;
     locker.unlock();
-#endif // DISABLE_ALLOCGUARD
+    countAlloc(size);
 
     return reinterpret_cast<void*>(alignedAdditionalPtr);
   }
@@ -94,36 +153,137 @@ namespace ReVoice
     auto alignedAdditionalPtr = reinterpret_cast<char*>(ptr);
     auto before = reinterpret_cast<MemoryBlockBefore*>(alignedAdditionalPtr - sizeof(MemoryBlockBefore));
     verifyMemoryBlock(before, ptr);
+    checkRTSafety("free of block allocated", before->file, before->func, before->line);
 
-#ifndef DISABLE_ALLOCGUARD
-    std::unique_lock<std::mutex> locker(g_memoryBlockDictLock);
-    g_memoryBlockDict.erase(g_memoryBlockDict.find(ptr));
+    MemoryShard &shard = g_memoryShardList[before->shard];
+    std::unique_lock<std::mutex> locker(shard.lock);
+    if(before->prev)
+      before->prev->next = before->next;
+    else
+      shard.head = before->next;
+    if(before->next)
+      before->next->prev = before->prev;
     locker.unlock();
-#endif // DISABLE_ALLOCGUARD
+    countFree(before->size);
 
     free(before->headPtr);
   }
 
-#ifndef DISABLE_ALLOCGUARD
   void rvCheckAllocated()
   {
-    std::unique_lock<std::mutex> locker(g_memoryBlockDictLock);
-    for(auto &pair : g_memoryBlockDict)
+    for(auto &shard : g_memoryShardList)
     {
-      void *ptr = pair.first;
-      MemoryBlockBefore *before = pair.second;
-      verifyMemoryBlock(before, ptr);
-      if(before->file && before->func)
-        critical("Memory block %p(allocated at %s@%s:%d) with size %lu", ptr, before->file, before->func, before->line, before->size);
-      else if(before->file)
-        critical("Memory block %p(allocated at %s) with size %lu", ptr, before->file, before->size);
-      else
-        critical("Memory block %p(allocated at unknown position) with size %lu", ptr);
+      std::unique_lock<std::mutex> locker(shard.lock);
+      for(MemoryBlockBefore *before = shard.head; before; before = before->next)
+      {
+        void *ptr = reinterpret_cast<char*>(before) + sizeof(MemoryBlockBefore);
+        verifyMemoryBlock(before, ptr);
+        if(before->file && before->func)
+          critical("Memory block %p(allocated at %s@%s:%d) with size %lu", ptr, before->file, before->func, before->line, before->size);
+        else if(before->file)
+          critical("Memory block %p(allocated at %s) with size %lu", ptr, before->file, before->size);
+        else
+          critical("Memory block %p(allocated at unknown position) with size %lu", ptr);
+      }
     }
-    locker.unlock();
   }
+} // namespace ReVoice
+
+RvMemoryStats rvGetMemoryStats()
+{
+  RvMemoryStats stats;
+  stats.currentBytes = g_currentBytes.load(std::memory_order_relaxed);
+  stats.peakBytes = g_peakBytes.load(std::memory_order_relaxed);
+  stats.liveBlockCount = g_liveBlockCount.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void rvResetMemoryPeak()
+{ g_peakBytes.store(g_currentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+int rvGetMemoryCallsites(RvMemoryCallsite *out, int maxOut)
+{
+  rvAssert(out || maxOut == 0, "out cannot be nullptr with non-zero maxOut");
+  rvAssert(maxOut >= 0, "maxOut cannot be less than 0");
+
+  // inline functions expand __FILE__ once per translation unit, so callsites are compared by content
+  auto lessCallsite = [](const RvMemoryCallsite &a, const RvMemoryCallsite &b)
+  {
+    if(a.line != b.line)
+      return a.line < b.line;
+    int v = std::strcmp(a.file ? a.file : "", b.file ? b.file : "");
+    if(v != 0)
+      return v < 0;
+    return std::strcmp(a.func ? a.func : "", b.func ? b.func : "") < 0;
+  };
+  std::map<RvMemoryCallsite, size_t, decltype(lessCallsite)> indexDict(lessCallsite);
+  std::vector<RvMemoryCallsite> callsiteList;
+  for(auto &shard : g_memoryShardList)
+  {
+    std::unique_lock<std::mutex> locker(shard.lock);
+    for(MemoryBlockBefore *before = shard.head; before; before = before->next)
+    {
+      RvMemoryCallsite key = {before->file, before->func, before->line, 0, 0};
+      auto it = indexDict.find(key);
+      if(it == indexDict.end())
+      {
+        it = indexDict.insert(std::make_pair(key, callsiteList.size())).first;
+        callsiteList.push_back(key);
+      }
+      callsiteList[it->second].currentBytes += before->size;
+      callsiteList[it->second].liveBlockCount += 1;
+    }
+  }
+
+  std::sort(callsiteList.begin(), callsiteList.end(), [](const RvMemoryCallsite &a, const RvMemoryCallsite &b) { return a.currentBytes > b.currentBytes; });
+  int nOut = std::min(maxOut, static_cast<int>(callsiteList.size()));
+  std::copy(callsiteList.begin(), callsiteList.begin() + nOut, out);
+  return static_cast<int>(callsiteList.size());
+}
+
+void rvSetMemoryWatermarkCallback(size_t watermark, RvMemoryWatermarkCallback *callback, void *userData)
+{
+  std::unique_lock<std::mutex> locker(g_watermarkLock);
+  g_watermarkCallback = callback;
+  g_watermarkUserData = userData;
+  g_watermark.store(callback ? watermark : 0, std::memory_order_relaxed);
+}
 #else // DISABLE_ALLOCGUARD
+// release fast path: one malloc per block, aligned by hand with only the original pointer stored in front, no tracking
+// malloc results are at least pointer aligned, so there is always room for it
+namespace ReVoice
+{
+  void *rvAlloc(size_t size, const char *, const char *, int)
+  {
+    rvAssert(size > 0, "size must be greater than 0");
+    auto headPtr = reinterpret_cast<char*>(malloc(size + alignment));
+    auto alignedPtr = headPtr + alignment - (reinterpret_cast<size_t>(headPtr) % alignment);
+    reinterpret_cast<void**>(alignedPtr)[-1] = headPtr;
+    return reinterpret_cast<void*>(alignedPtr);
+  }
+
+  void rvFree(void *ptr)
+  {
+    rvAssert(ptr, "cannot free a null pointer");
+    free(reinterpret_cast<void**>(ptr)[-1]);
+  }
+
   void rvCheckAllocated()
   {}
+} // namespace ReVoice
+
+RvMemoryStats rvGetMemoryStats()
+{
+  RvMemoryStats stats = {0, 0, 0};
+  return stats;
+}
+
+void rvResetMemoryPeak()
+{}
+
+int rvGetMemoryCallsites(RvMemoryCallsite *, int)
+{ return 0; }
+
+void rvSetMemoryWatermarkCallback(size_t, RvMemoryWatermarkCallback *, void *)
+{}
 #endif // DISABLE_ALLOCGUARD
-} // namespace ReVoice
\ No newline at end of file
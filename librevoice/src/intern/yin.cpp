@@ -1,6 +1,8 @@
 #include "../yin.h"
 
 #include "util_p.hpp"
+#include "layout_p.hpp"
+#include "threadpool_p.hpp"
 
 using namespace ReVoice;
 
@@ -11,30 +13,50 @@ typedef struct RvYinDifferenceWorker
   RvComplex *cWorkMem;
   RvReal *rWorkMem;
   int nPadded;
+  bool ownsMemory;
 } RvYinDifferenceWorker;
 
+namespace ReVoice
+{
+  RvYinDifferenceWorker *layoutYinDifferenceWorker(Arena &arena, int maxNX)
+  {
+    rvAssert(maxNX > 0, "maxNX must be greater than 0");
+    rvAssert(roundUpToPowerOf2(maxNX), "maxNX must be power of 2");
+    int nTransformed = maxNX / 2 + 1;
+    auto worker = arena.construct<RvYinDifferenceWorker>();
+    auto rfft = layoutRFFT(arena, maxNX);
+    auto irfft = layoutIRFFT(arena, maxNX);
+    auto cWorkMem = arena.take<RvComplex>(2 * nTransformed);
+    auto rWorkMem = arena.take<RvReal>(maxNX);
+    if(arena.isMeasuring())
+      return nullptr;
+    worker->rfft = rfft;
+    worker->irfft = irfft;
+    worker->cWorkMem = cWorkMem;
+    worker->rWorkMem = rWorkMem;
+    worker->nPadded = maxNX;
+    worker->ownsMemory = false;
+    return worker;
+  }
+} // namespace ReVoice
+
 RvYinDifferenceWorker *rvCreateYinDifferenceWorker(int maxNX)
 {
-  rvAssert(maxNX > 0, "maxNX must be greater than 0");
-  rvAssert(roundUpToPowerOf2(maxNX), "maxNX must be power of 2");
-  int nTransformed = maxNX / 2 + 1;
-  auto worker = new RvYinDifferenceWorker;
-  worker->rfft = rvCreateRFFT(maxNX);
-  worker->irfft = rvCreateIRFFT(maxNX);
-  worker->cWorkMem = RVALLOC(RvComplex, 2 * nTransformed);
-  worker->rWorkMem = RVALLOC(RvReal, maxNX);
-  worker->nPadded = maxNX;
+  Arena measure;
+  layoutYinDifferenceWorker(measure, maxNX);
+  Arena arena(RVALLOC(char, measure.size()));
+  auto worker = layoutYinDifferenceWorker(arena, maxNX);
+  worker->ownsMemory = true;
   return worker;
 }
 
 void rvDestroyYinDifferenceWorker(RvYinDifferenceWorker *worker)
 {
   rvAssert(worker, "worker cannot be nullptr");
-  rvFree(worker->rWorkMem);
-  rvFree(worker->cWorkMem);
   rvDestroyIRFFT(worker->irfft);
   rvDestroyRFFT(worker->rfft);
-  delete worker;
+  if(worker->ownsMemory)
+    rvFree(worker);
 }
 
 void rvYinDoDifference(RvYinDifferenceWorker *worker, const RvReal *x, int nX, RvReal *out)
@@ -170,27 +192,31 @@ void rvCallYin(const RvYinProcessorParameter *param, const RvReal *x, int nX, bo
   if(param->prefilter)
     rvYinDoPrefilter(px, nX, param->maxFreq, param->samprate);
 
+  // hops are independent, every chunk has its own scratch
   int nHop = rvGetNFrame(nX, param->hopSize);
-  auto frame = RVALLOC(RvReal, param->windowSize);
-  auto buffer = RVALLOC(RvReal, param->windowSize / 2);
-  auto worker = rvCreateYinDifferenceWorker(param->windowSize);
-  int valleys[32];
-  for(int iHop = 0; iHop < nHop; ++iHop)
+  parallelFor(rvSharedThreadPool(), nHop, 64, [&](int iBegin, int iEnd)
   {
-    rvGetFrame(px, nX, iHop * param->hopSize, param->windowSize, frame);
-    rvYinDoDifference(worker, frame, param->windowSize, buffer);
-    rvYinCumulativeDifference(buffer, param->windowSize / 2);
-    int nValley = rvYinFindValleys(buffer, param->windowSize / 2, param->minFreq, param->maxFreq, param->samprate, param->valleyThreshold, param->valleyStep, valleys, 32);
-    if(nValley > 0)
+    auto frame = RVALLOC(RvReal, param->windowSize);
+    auto buffer = RVALLOC(RvReal, param->windowSize / 2);
+    auto worker = rvCreateYinDifferenceWorker(param->windowSize);
+    int valleys[32];
+    for(int iHop = iBegin; iHop < iEnd; ++iHop)
     {
-      RvReal ipledX = rvParabolicInterp(buffer, param->windowSize / 2, valleys[nValley - 1], false).x;
-      out[iHop] = param->samprate / ipledX;
+      rvGetFrame(px, nX, iHop * param->hopSize, param->windowSize, frame);
+      rvYinDoDifference(worker, frame, param->windowSize, buffer);
+      rvYinCumulativeDifference(buffer, param->windowSize / 2);
+      int nValley = rvYinFindValleys(buffer, param->windowSize / 2, param->minFreq, param->maxFreq, param->samprate, param->valleyThreshold, param->valleyStep, valleys, 32);
+      if(nValley > 0)
+      {
+        RvReal ipledX = rvParabolicInterp(buffer, param->windowSize / 2, valleys[nValley - 1], false).x;
+        out[iHop] = param->samprate / ipledX;
+      }
+      else
+        out[iHop] = 0.0;
     }
-    else
-      out[iHop] = 0.0;
-  }
-  rvDestroyYinDifferenceWorker(worker);
-  rvFree(buffer);
-  rvFree(frame);
+    rvDestroyYinDifferenceWorker(worker);
+    rvFree(buffer);
+    rvFree(frame);
+  });
   rvFree(px);
 }
\ No newline at end of file
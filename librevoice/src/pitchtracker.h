@@ -0,0 +1,23 @@
+#pragma once
+
+#include "util.h"
+#include "rtpyin.h"
+#include "rtmonopitch.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// offline pyin and monopitch over a whole signal, with the parameters of the real-time tracker
+// f0 holds one value per hop, rvPitchTrackerNFrame(pyinParam, nX) in total, monoPitchParam == nullptr derives it from pyinParam
+// hops are cut into chunks of chunkSize, each decoded together with overlapSize hops on both sides on the shared thread pool
+// neighbouring paths are joined where they agree after the survivors of the left chunk have converged
+// which gives what a single decode would, up to equally likely paths
+// otherwise the unsettled part of the overlap is aligned again between the two paths, chunkSize must be at least 2 * overlapSize
+RV_EXPORT int rvPitchTrackerNFrame(const RvRTPYinProcessorParameter *pyinParam, int nX);
+RV_EXPORT void rvCallPitchTracker(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, const RvReal *x, int nX, int chunkSize, int overlapSize, RvReal *f0);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
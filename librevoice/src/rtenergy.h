@@ -0,0 +1,21 @@
+#pragma once
+
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvRTEnergyTracker RvRTEnergyTracker;
+
+RV_EXPORT RvRTEnergyTracker *rvCreateRTEnergyTracker(int hopSize, int nWindowHop, RvReal silentThreshold, RvReal voicedThreshold);
+RV_EXPORT int rvCallRTEnergyTracker(RvRTEnergyTracker *tracker, const RvReal *x, int nX);
+RV_EXPORT RvReal rvRTEnergyTrackerEnergy(const RvRTEnergyTracker *tracker);
+RV_EXPORT bool rvRTEnergyTrackerIsSilent(const RvRTEnergyTracker *tracker);
+RV_EXPORT void rvResetRTEnergyTracker(RvRTEnergyTracker *tracker);
+RV_EXPORT void rvDestroyRTEnergyTracker(RvRTEnergyTracker *tracker);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -11,8 +11,13 @@ typedef struct RvRTFilter RvRTFilter;
 RV_EXPORT RvRTFilter *rvCreateRTFilter(const RvReal *kernel, int kernelSize, int maxNX);
 RV_EXPORT int rvRTFilterNextOutputSize(const RvRTFilter *rtfilter, int nX);
 RV_EXPORT int rvCallRTFilter(RvRTFilter *rtfilter, const RvReal *x, int nX, RvReal *out);
+RV_EXPORT void rvResetRTFilter(RvRTFilter *rtfilter);
 RV_EXPORT void rvDestroyRTFilter(RvRTFilter *rtfilter);
 
+// places the filter and all of its buffers in mem, rvDestroyRTFilter then leaves mem to the caller
+RV_EXPORT size_t rvRTFilterRequiredSize(int kernelSize, int maxNX);
+RV_EXPORT RvRTFilter *rvInitRTFilterInPlace(void *mem, const RvReal *kernel, int kernelSize, int maxNX);
+
 RV_EXPORT int rvRTFilterDelay(int kernelSize);
 RV_EXPORT int rvRTFilterDelayed(const RvRTFilter *rtfilter);
 RV_EXPORT int rvRTFilterMaxOutputSize(int maxNX, int kernelSize);
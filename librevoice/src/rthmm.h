@@ -1,6 +1,7 @@
 #pragma once
 
 #include "util.h"
+#include "hmm.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -8,13 +9,39 @@ extern "C"
 #endif
 
 typedef struct RvRTSparseHMM RvRTSparseHMM;
+typedef struct RvRTSparseHMMBank RvRTSparseHMMBank;
+typedef struct RvRTSparseHMMSmoother RvRTSparseHMMSmoother;
 
 RV_EXPORT RvRTSparseHMM *rvCreateRTSparseHMM(RvReal *init, int *frm, int *to, RvReal *transProb, int nState, int nTrans, int nMaxBackward);
+RV_EXPORT RvRTSparseHMM *rvCreateRTSparseHMMFromModel(RvSparseHMM *model, int nMaxBackward);
+RV_EXPORT const RvSparseHMM *rvRTSparseHMMModel(const RvRTSparseHMM *rtSparseHMM);
 RV_EXPORT bool rvRTSparseHMMFeed(RvRTSparseHMM *rtSparseHMM, RvReal *obs);
 RV_EXPORT int rvRTSparseHMMViterbiDecode(RvRTSparseHMM *rtSparseHMM, int *out, int nBackward);
+RV_EXPORT int rvRTSparseHMMViterbiDecodeUpdate(RvRTSparseHMM *rtSparseHMM, int *pathIO, int nBackward);
 RV_EXPORT int rvRTSparseHMMCurrentAvailable(RvRTSparseHMM *rtSparseHMM);
+RV_EXPORT void rvRTSparseHMMSetBeam(RvRTSparseHMM *rtSparseHMM, RvReal logBeam);
+RV_EXPORT int rvRTSparseHMMActiveCount(const RvRTSparseHMM *rtSparseHMM);
+// forgets all fed observations, the beam is kept
+RV_EXPORT void rvResetRTSparseHMM(RvRTSparseHMM *rtSparseHMM);
 RV_EXPORT void rvDestroyRTSparseHMM(RvRTSparseHMM *rtSparseHMM);
 
+// places the decoder and all of its buffers in mem, rvDestroyRTSparseHMM then only releases the model
+RV_EXPORT size_t rvRTSparseHMMRequiredSize(RvSparseHMM *model, int nMaxBackward);
+RV_EXPORT RvRTSparseHMM *rvInitRTSparseHMMInPlace(void *mem, RvSparseHMM *model, int nMaxBackward);
+
+RV_EXPORT RvRTSparseHMMBank *rvCreateRTSparseHMMBank(RvSparseHMM *model, int nStream, int nMaxBackward);
+RV_EXPORT int rvRTSparseHMMBankNStream(const RvRTSparseHMMBank *bank);
+RV_EXPORT void rvRTSparseHMMBankFeed(RvRTSparseHMMBank *bank, const RvReal *obs, bool *ok);
+RV_EXPORT int rvRTSparseHMMBankViterbiDecode(const RvRTSparseHMMBank *bank, int iStream, int *out, int nBackward);
+RV_EXPORT int rvRTSparseHMMBankCurrentAvailable(const RvRTSparseHMMBank *bank, int iStream);
+RV_EXPORT void rvRTSparseHMMBankResetStream(RvRTSparseHMMBank *bank, int iStream);
+RV_EXPORT void rvDestroyRTSparseHMMBank(RvRTSparseHMMBank *bank);
+
+RV_EXPORT RvRTSparseHMMSmoother *rvCreateRTSparseHMMSmoother(RvSparseHMM *model, int lag);
+RV_EXPORT int rvRTSparseHMMSmootherLag(const RvRTSparseHMMSmoother *smoother);
+RV_EXPORT int rvRTSparseHMMSmootherFeed(RvRTSparseHMMSmoother *smoother, const RvReal *obs, RvReal *out);
+RV_EXPORT void rvDestroyRTSparseHMMSmoother(RvRTSparseHMMSmoother *smoother);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
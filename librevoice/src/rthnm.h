@@ -0,0 +1,26 @@
+#pragma once
+
+#include "util.h"
+#include "hnm.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvRTHNMSynthesizer RvRTHNMSynthesizer;
+
+// rvCallHNMSynthesizer hop by hop, each call takes the analyzer output of one hop and renders the hop before it
+// hFreq == nullptr renders the held last hop and starts over, returns the number of samples written to out, 0 or hopSize
+RV_EXPORT RvRTHNMSynthesizer *rvCreateRTHNMSynthesizer(const RvHNMSynthesizerParameter *param, int maxHar);
+RV_EXPORT int rvCallRTHNMSynthesizer(RvRTHNMSynthesizer *synth, RvReal f0, const RvReal *hFreq, const RvReal *hAmp, const RvReal *hPhase, RvReal sinusoidEnergy, RvReal *out);
+RV_EXPORT void rvResetRTHNMSynthesizer(RvRTHNMSynthesizer *synth);
+RV_EXPORT void rvDestroyRTHNMSynthesizer(RvRTHNMSynthesizer *synth);
+
+// places the synthesizer and all of its buffers in mem, rvDestroyRTHNMSynthesizer then leaves mem to the caller
+RV_EXPORT size_t rvRTHNMSynthesizerRequiredSize(const RvHNMSynthesizerParameter *param, int maxHar);
+RV_EXPORT RvRTHNMSynthesizer *rvInitRTHNMSynthesizerInPlace(void *mem, const RvHNMSynthesizerParameter *param, int maxHar);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvRTPYinProcessorParameter RvRTPYinProcessorParameter;
+
+typedef struct RvRTMonoNoteProcessorParameter
+{
+  RvReal probAttackTransSelf, probStableTransSelf;
+  RvReal probSilentTransSelf, probStableToSilent;
+  RvReal noteSigma, priorPitchedProb, priorWeight;
+  RvReal minTransSemitone, maxTransSemitone;
+  RvReal yinAttackSigma, yinStableSigma, yinTrust;
+  int hopSize, minSemitone, nSemitone;
+  int binPerSemitone, maxObsLength;
+  int maxCandidate;
+} RvRTMonoNoteProcessorParameter;
+typedef struct RvRTMonoNoteProcessor RvRTMonoNoteProcessor;
+
+// end is exclusive
+typedef struct RvRTMonoNoteEvent
+{
+  RvReal pitch;
+  int begin, end;
+} RvRTMonoNoteEvent;
+
+RV_EXPORT RvRTMonoNoteProcessorParameter *rvCreateRTMonoNoteProcessorParameter(int hopSize, int minSemitone, int nSemitone);
+RV_EXPORT RvRTMonoNoteProcessorParameter *rvCreateRTMonoNoteProcessorParameterFromRTPYin(const RvRTPYinProcessorParameter *param);
+RV_EXPORT void rvDestroyRTMonoNoteProcessorParameter(RvRTMonoNoteProcessorParameter *param);
+
+RV_EXPORT RvRTMonoNoteProcessor *rvCreateRTMonoNoteProcessor(const RvRTMonoNoteProcessorParameter *param);
+RV_EXPORT const RvRTMonoNoteProcessorParameter *rvRTMonoNoteParam(const RvRTMonoNoteProcessor *self);
+RV_EXPORT int rvMonoNoteMaxOutputLength(const RvRTMonoNoteProcessor *self);
+RV_EXPORT int rvMonoNoteCurrentState(const RvRTMonoNoteProcessor *self, RvReal *pitch);
+RV_EXPORT int rvCallRTMonoNote(RvRTMonoNoteProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, RvRTMonoNoteEvent *out);
+RV_EXPORT int rvFlushRTMonoNote(RvRTMonoNoteProcessor *self, RvRTMonoNoteEvent *out);
+RV_EXPORT void rvDestroyRTMonoNoteProcessor(RvRTMonoNoteProcessor *self);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -8,28 +8,55 @@ extern "C"
 #endif
 
 typedef struct RvRTPYinProcessorParameter RvRTPYinProcessorParameter;
+typedef struct RvSparseHMM RvSparseHMM;
 
 typedef struct RvRTMonoPitchProcessorParameter
 {
   RvReal samprate;
   RvReal maxTransSemitone, minFreq;
   RvReal transSelf, yinTrust, energyThreshold;
+  RvReal viterbiBeam, energyHysteresis;
   int hopSize, nSemitone;
   int binPerSemitone, maxObsLength;
+  int maxCandidate;
 } RvRTMonoPitchProcessorParameter;
 typedef struct RvRTMonoPitchProcessor RvRTMonoPitchProcessor;
+typedef struct RvRTMonoPitchProcessorPool RvRTMonoPitchProcessorPool;
 
 RV_EXPORT RvRTMonoPitchProcessorParameter *rvCreateRTMonoPitchProcessorParameter(int hopSize, RvReal samprate, int nSemitone, RvReal maxTransSemitone, RvReal minFreq);
 RV_EXPORT RvRTMonoPitchProcessorParameter *rvCreateRTMonoPitchProcessorParameterFromRTPYin(const RvRTPYinProcessorParameter *param);
 RV_EXPORT void rvDestroyRTMonoPitchProcessorParameter(RvRTMonoPitchProcessorParameter *param);
 
+// processors with the same transition parameters share one model, it is built on first use and destroyed with its last processor
+// prebuilt models stay in the cache until rvReleaseRTMonoPitchModelCache
+RV_EXPORT void rvPrebuildRTMonoPitchModel(const RvRTMonoPitchProcessorParameter *param);
+RV_EXPORT void rvReleaseRTMonoPitchModelCache();
+
 RV_EXPORT RvRTMonoPitchProcessor *rvCreateRTMonoPitchProcessor(const RvRTMonoPitchProcessorParameter *param);
 RV_EXPORT const RvRTMonoPitchProcessorParameter *rvRTMonoPitchParam(const RvRTMonoPitchProcessor *self);
+RV_EXPORT const RvSparseHMM *rvMonoPitchModel(const RvRTMonoPitchProcessor *self);
 RV_EXPORT void rvMonoPitchDumpObsTemp(const RvRTMonoPitchProcessor *self, RvReal *out);
 RV_EXPORT int rvMonoPitchNextOutputLength(const RvRTMonoPitchProcessor *self);
+RV_EXPORT int rvMonoPitchMaxDeltaOutputLength(const RvRTMonoPitchProcessor *self);
+RV_EXPORT int rvMonoPitchActiveStateCount(const RvRTMonoPitchProcessor *self);
+// the calls only use the maxCandidate most probable of the nObsProb (freq, prob) pairs in obsProb
 RV_EXPORT int rvCallRTMonoPitch(RvRTMonoPitchProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, RvReal *out);
+RV_EXPORT int rvCallRTMonoPitchDelta(RvRTMonoPitchProcessor *self, const RvReal *x, const RvReal *obsProb, int nObsProb, int *frameIndex, RvReal *value);
+RV_EXPORT int rvCallRTMonoPitchDeltaWithSilence(RvRTMonoPitchProcessor *self, bool isSilent, const RvReal *obsProb, int nObsProb, int *frameIndex, RvReal *value);
+RV_EXPORT void rvResetRTMonoPitchProcessor(RvRTMonoPitchProcessor *self);
 RV_EXPORT void rvDestroyRTMonoPitchProcessor(RvRTMonoPitchProcessor *self);
 
+// places the processor and all of its buffers in mem, rvDestroyRTMonoPitchProcessor then only releases the model
+// both look the model up in the cache, prebuild it to keep them off the model construction path
+RV_EXPORT size_t rvRTMonoPitchProcessorRequiredSize(const RvRTMonoPitchProcessorParameter *param);
+RV_EXPORT RvRTMonoPitchProcessor *rvInitRTMonoPitchProcessorInPlace(void *mem, const RvRTMonoPitchProcessorParameter *param);
+
+// nProcessor processors sharing one parameter, one model and one block, see rvCreateRTPYinProcessorPool
+RV_EXPORT RvRTMonoPitchProcessorPool *rvCreateRTMonoPitchProcessorPool(const RvRTMonoPitchProcessorParameter *param, int nProcessor);
+RV_EXPORT RvRTMonoPitchProcessor *rvRTMonoPitchProcessorPoolAcquire(RvRTMonoPitchProcessorPool *pool);
+RV_EXPORT void rvRTMonoPitchProcessorPoolRelease(RvRTMonoPitchProcessorPool *pool, RvRTMonoPitchProcessor *self);
+RV_EXPORT void rvDestroyRTMonoPitchProcessorPool(RvRTMonoPitchProcessorPool *pool);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "util.h"
+#include "rtpyin.h"
+#include "rtmonopitch.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvRTPitchPipeline RvRTPitchPipeline;
+
+// rvCallRTPitchTracker split into prefilter, yin and hmm stages, each on its own worker thread
+// stages are connected by bounded queues of nQueueBlock blocks, a stage waits while its output queue is full
+RV_EXPORT RvRTPitchPipeline *rvCreateRTPitchPipeline(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, int nQueueBlock);
+RV_EXPORT int rvRTPitchPipelineHopSize(const RvRTPitchPipeline *pipeline);
+RV_EXPORT int rvRTPitchPipelineMaxOutputLength(const RvRTPitchPipeline *pipeline);
+// push and pop never block or allocate, they may wake a sleeping stage
+// push returns false while the input queue is full, nX == 0 ends the stream and the stages flush everything behind it
+RV_EXPORT bool rvRTPitchPipelinePush(RvRTPitchPipeline *pipeline, const RvReal *x, int nX);
+// returns false when no result is ready, otherwise *nOut pairs as from rvCallRTPitchTracker, or -1 once the stream has ended
+// blocks without changed pairs are not queued
+RV_EXPORT bool rvRTPitchPipelinePop(RvRTPitchPipeline *pipeline, int *frameIndex, RvReal *f0, int *nOut);
+RV_EXPORT void rvDestroyRTPitchPipeline(RvRTPitchPipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
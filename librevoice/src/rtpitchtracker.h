@@ -0,0 +1,36 @@
+#pragma once
+
+#include "util.h"
+#include "rtpyin.h"
+#include "rtmonopitch.h"
+#include "threadpool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvRTPitchTracker RvRTPitchTracker;
+typedef struct RvRTPitchTrackerBank RvRTPitchTrackerBank;
+
+RV_EXPORT RvRTPitchTracker *rvCreateRTPitchTracker(const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam);
+RV_EXPORT const RvRTPYinProcessorParameter *rvRTPitchTrackerPYinParam(const RvRTPitchTracker *tracker);
+RV_EXPORT const RvRTMonoPitchProcessorParameter *rvRTPitchTrackerMonoPitchParam(const RvRTPitchTracker *tracker);
+RV_EXPORT int rvRTPitchTrackerMaxOutputLength(const RvRTPitchTracker *tracker);
+RV_EXPORT int rvCallRTPitchTracker(RvRTPitchTracker *tracker, const RvReal *x, int nX, int *frameIndex, RvReal *f0);
+RV_EXPORT void rvResetRTPitchTracker(RvRTPitchTracker *tracker);
+RV_EXPORT void rvDestroyRTPitchTracker(RvRTPitchTracker *tracker);
+
+// nChannel trackers with the same parameters fed from one interleaved stream
+// with a pool the channels of each call are spread over its workers, the pool must outlive the bank
+// pool == nullptr runs every channel on the calling thread, which keeps the call free of locks
+RV_EXPORT RvRTPitchTrackerBank *rvCreateRTPitchTrackerBank(int nChannel, const RvRTPYinProcessorParameter *pyinParam, const RvRTMonoPitchProcessorParameter *monoPitchParam, RvThreadPool *pool);
+RV_EXPORT int rvRTPitchTrackerBankChannelCount(const RvRTPitchTrackerBank *bank);
+RV_EXPORT int rvRTPitchTrackerBankMaxOutputLength(const RvRTPitchTrackerBank *bank);
+RV_EXPORT int rvCallRTPitchTrackerBank(RvRTPitchTrackerBank *bank, const RvReal *x, int nX, int *frameIndex, RvReal *f0, int *nOut);
+RV_EXPORT void rvResetRTPitchTrackerBank(RvRTPitchTrackerBank *bank);
+RV_EXPORT void rvDestroyRTPitchTrackerBank(RvRTPitchTrackerBank *bank);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
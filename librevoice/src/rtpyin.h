@@ -15,12 +15,15 @@ typedef struct RvRTPYinProcessorParameter
   RvReal valleyThreshold, valleyStep;
   RvReal probThreshold, weightPrior;
   RvReal bias;
+  RvReal gateThreshold, gateHysteresis;
   int hopSize, maxWindowSize;
   int maxIter, pdfSize;
+  int gateHangover;
   bool prefilter, isPdfDefault;
 } RvRTPYinProcessorParameter;
 
 typedef struct RvRTPYinProcessor RvRTPYinProcessor;
+typedef struct RvRTPYinProcessorPool RvRTPYinProcessorPool;
 
 RV_EXPORT RvRTPYinProcessorParameter *rvCreateRTPYinProcessorParameter(RvReal minFreq, RvReal maxFreq, RvReal sr, RvReal *pdf, int pdfSize);
 RV_EXPORT void rvDestroyRTPYinProcessorParameter(RvRTPYinProcessorParameter *param);
@@ -28,11 +31,25 @@ RV_EXPORT void rvDestroyRTPYinProcessorParameter(RvRTPYinProcessorParameter *par
 RV_EXPORT RvRTPYinProcessor *rvCreateRTPYinProcessor(const RvRTPYinProcessorParameter *param);
 RV_EXPORT const RvRTPYinProcessorParameter *rvRTPYinParam(const RvRTPYinProcessor *rtpyin);
 RV_EXPORT int rvRTPYinDelayed(const RvRTPYinProcessor *rtpyin);
+// out receives up to 127 (freq, prob) pairs and must have room for all of them, maxOut cannot exceed 128
 RV_EXPORT int rvCallRTPYin(RvRTPYinProcessor *rtpyin, const RvReal *x, int nX, RvReal *out, int maxOut);
+RV_EXPORT int rvRTPYinSkippedFrames(const RvRTPYinProcessor *rtpyin);
 RV_EXPORT int rvRTPYinBufferUsed(RvRTPYinProcessor *rtpyin);
 RV_EXPORT void rvRTPYinDumpBuffer(RvRTPYinProcessor *rtpyin, RvReal *out);
+RV_EXPORT void rvResetRTPYinProcessor(RvRTPYinProcessor *rtpyin);
 RV_EXPORT void rvDestroyRTPYinProcessor(RvRTPYinProcessor *rtpyin);
 
+// places the processor and all of its buffers in mem, rvDestroyRTPYinProcessor then leaves mem to the caller
+RV_EXPORT size_t rvRTPYinProcessorRequiredSize(const RvRTPYinProcessorParameter *param);
+RV_EXPORT RvRTPYinProcessor *rvInitRTPYinProcessorInPlace(void *mem, const RvRTPYinProcessorParameter *param);
+
+// nProcessor processors sharing one parameter and one block
+// acquire returns nullptr when all are in use, release resets the processor, all must be released before destroying the pool
+RV_EXPORT RvRTPYinProcessorPool *rvCreateRTPYinProcessorPool(const RvRTPYinProcessorParameter *param, int nProcessor);
+RV_EXPORT RvRTPYinProcessor *rvRTPYinProcessorPoolAcquire(RvRTPYinProcessorPool *pool);
+RV_EXPORT void rvRTPYinProcessorPoolRelease(RvRTPYinProcessorPool *pool, RvRTPYinProcessor *rtpyin);
+RV_EXPORT void rvDestroyRTPYinProcessorPool(RvRTPYinProcessorPool *pool);
+
 RV_EXPORT int rvRTPYinDelay(const RvRTPYinProcessorParameter *param);
 
 #ifdef __cplusplus
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RvThreadPool RvThreadPool;
+
+// processes items [iBegin, iEnd) of a parallel loop
+typedef void (RvRangeFunc)(int iBegin, int iEnd, void *userData);
+// hands run(arg) over to a thread of the host, which must call it exactly once
+typedef void (RvExecutorFunc)(void (*run)(void *arg), void *arg, void *userData);
+
+// nThread worker threads, a negative nThread leaves one hardware thread to the caller
+// worker i is pinned to cpu cpuList[i] unless cpuList is nullptr
+RV_EXPORT RvThreadPool *rvCreateThreadPool(int nThread, const int *cpuList);
+// owns no threads, each parallel loop submits up to nConcurrency drains to executor
+RV_EXPORT RvThreadPool *rvCreateThreadPoolWithExecutor(RvExecutorFunc *executor, int nConcurrency, void *userData);
+RV_EXPORT int rvThreadPoolSize(const RvThreadPool *pool);
+// splits [0, n) into chunks of at most grainSize items, the calling thread takes part and returns when all are done
+// may be called from inside a chunk and from several threads at once
+RV_EXPORT void rvThreadPoolParallelFor(RvThreadPool *pool, int n, int grainSize, RvRangeFunc *func, void *userData);
+RV_EXPORT void rvDestroyThreadPool(RvThreadPool *pool);
+
+// pool of the offline analyzers, a built-in one with rvCreateThreadPool(-1, nullptr) unless set
+// setting nullptr restores the built-in pool, a replaced pool is not destroyed
+RV_EXPORT void rvSetSharedThreadPool(RvThreadPool *pool);
+RV_EXPORT RvThreadPool *rvSharedThreadPool();
+
+#ifdef __cplusplus
+}
+#endif
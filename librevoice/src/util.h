@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef double RvReal;
 #ifdef __cplusplus
@@ -12,6 +13,9 @@ typedef RvReal complex RvComplex;
 
 #define RV_EXPORT __declspec(dllexport)
 
+// memory handed to rvInit*InPlace must be aligned to this and hold the matching rv*RequiredSize bytes
+#define RV_INPLACE_ALIGNMENT 64
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -39,8 +43,62 @@ typedef struct ParabolicInterpolationResult
   RvReal x, y;
 } ParabolicInterpolationResult;
 
+// sizes are requested bytes, without guard headers and alignment padding
+typedef struct RvMemoryStats
+{
+  size_t currentBytes, peakBytes;
+  size_t liveBlockCount;
+} RvMemoryStats;
+
+typedef struct RvMemoryCallsite
+{
+  const char *file, *func;
+  int line;
+  size_t currentBytes, liveBlockCount;
+} RvMemoryCallsite;
+
+typedef void (RvMemoryWatermarkCallback)(size_t currentBytes, size_t watermark, void *userData);
+
+typedef enum RvLogSeverity
+{
+  RvLogDebug = 0,
+  RvLogWarning,
+  RvLogCritical,
+  RvLogFatal
+} RvLogSeverity;
+
+// nSuppressed > 0 marks a summary of nSuppressed messages of a call site that hit the rate limit, message is then the first of them in the latest rate limit window, truncated to 255 characters
+typedef void (RvLogSinkFunc)(int severity, const char *message, int nSuppressed, void *userData);
+
 RV_EXPORT void rvExitCheck();
 
+// memory telemetry, all zero when built with DISABLE_ALLOCGUARD
+// rvGetMemoryCallsites fills at most maxOut callsites that hold live blocks, largest first, and returns the total count
+// the watermark callback runs on the allocating thread whenever currentBytes rises to or above watermark, zero watermark disables it
+RV_EXPORT RvMemoryStats rvGetMemoryStats();
+RV_EXPORT void rvResetMemoryPeak();
+RV_EXPORT int rvGetMemoryCallsites(RvMemoryCallsite *out, int maxOut);
+RV_EXPORT void rvSetMemoryWatermarkCallback(size_t watermark, RvMemoryWatermarkCallback *callback, void *userData);
+
+// messages are queued without blocking and handed to the sink by a drain thread, fatal ones are delivered at once before aborting
+// the thread starts with rvSetLogSink or the first message outside a real-time section
+// nullptr sink restores printing to stderr, rate limit is per call site and second, 10 by default and 0 disables it
+// call sites are identified by their format string, so sites sharing one also share the limit
+RV_EXPORT void rvSetLogSink(RvLogSinkFunc *sink, void *userData);
+RV_EXPORT void rvSetLogSeverity(int minSeverity);
+RV_EXPORT void rvSetLogRateLimit(int maxPerSecond);
+// delivers everything queued so far and all pending summaries on the calling thread
+RV_EXPORT void rvFlushLog();
+
+// real-time sections mark code that must not allocate, free or print, e.g. an audio callback
+// messages raised there are only queued, fatal ones are printed at once and count as violations
+// sections nest and are per thread, violations are reported with their call site unless built with DISABLE_ALLOCGUARD
+RV_EXPORT void rvEnterRTSection();
+RV_EXPORT void rvLeaveRTSection();
+RV_EXPORT int rvRTSectionDepth();
+RV_EXPORT int rvRTViolationCount();
+RV_EXPORT void rvSetAbortOnRTViolation(bool abortOnViolation);
+
 RV_EXPORT FrameRange rvGetFrameRange(int inputLen, int center, int size);
 RV_EXPORT void rvGetFrame(const RvReal *x, int nX, int center, int size, RvReal *out);
 RV_EXPORT int rvGetNFrame(int inputSize, int hopSize);
@@ -1,7 +1,7 @@
 from . import common
-from . import rtfilter, rtpyin, rtmonopitch
+from . import threadpool, hmm, yin, rtfilter, rtpyin, rtmonopitch, rtmononote, rtpitchtracker, rtpitchpipeline, pitchtracker, rtenergy, hnm, rthnm
 
 __all__ = [
     "common",
-    "rtfilter", "rtpyin", "rtmonopitch"
+    "threadpool", "hmm", "yin", "rtfilter", "rtpyin", "rtmonopitch", "rtmononote", "rtpitchtracker", "rtpitchpipeline", "pitchtracker", "rtenergy", "hnm", "rthnm"
 ]
@@ -11,6 +11,132 @@ rvExitCheck = ctypes.CDLL("librevoice.dll").rvExitCheck
 rvExitCheck.argtypes = []
 rvExitCheck.restype = None
 
+class RvMemoryStats(ctypes.Structure):
+    _fields_ = [
+        ("currentBytes", ctypes.c_size_t), ("peakBytes", ctypes.c_size_t),
+        ("liveBlockCount", ctypes.c_size_t),
+    ]
+
+class RvMemoryCallsite(ctypes.Structure):
+    _fields_ = [
+        ("file", ctypes.c_char_p), ("func", ctypes.c_char_p),
+        ("line", ctypes.c_int),
+        ("currentBytes", ctypes.c_size_t), ("liveBlockCount", ctypes.c_size_t),
+    ]
+
+RvMemoryWatermarkCallback = ctypes.CFUNCTYPE(None, ctypes.c_size_t, ctypes.c_size_t, ctypes.c_void_p)
+
+rvGetMemoryStats = ctypes.CDLL("librevoice.dll").rvGetMemoryStats
+rvGetMemoryStats.argtypes = []
+rvGetMemoryStats.restype = RvMemoryStats
+
+rvResetMemoryPeak = ctypes.CDLL("librevoice.dll").rvResetMemoryPeak
+rvResetMemoryPeak.argtypes = []
+rvResetMemoryPeak.restype = None
+
+rvGetMemoryCallsites = ctypes.CDLL("librevoice.dll").rvGetMemoryCallsites
+rvGetMemoryCallsites.argtypes = [ctypes.POINTER(RvMemoryCallsite), ctypes.c_int]
+rvGetMemoryCallsites.restype = ctypes.c_int
+
+rvSetMemoryWatermarkCallback = ctypes.CDLL("librevoice.dll").rvSetMemoryWatermarkCallback
+rvSetMemoryWatermarkCallback.argtypes = [ctypes.c_size_t, RvMemoryWatermarkCallback, ctypes.c_void_p]
+rvSetMemoryWatermarkCallback.restype = None
+
+def memoryStats():
+    stats = rvGetMemoryStats()
+    return {"currentBytes": stats.currentBytes, "peakBytes": stats.peakBytes, "liveBlockCount": stats.liveBlockCount}
+
+def memoryCallsites():
+    n = rvGetMemoryCallsites(None, 0)
+    while(True):
+        out = (RvMemoryCallsite * max(n, 1))()
+        nTotal = rvGetMemoryCallsites(out, n)
+        if(nTotal <= n):
+            break
+        n = nTotal
+    return [{
+        "file": c.file.decode() if c.file else None, "func": c.func.decode() if c.func else None, "line": c.line,
+        "currentBytes": c.currentBytes, "liveBlockCount": c.liveBlockCount,
+    } for c in out[:nTotal]]
+
+_memoryWatermarkCallback = None
+def setMemoryWatermarkCallback(watermark, callback):
+    # callback(currentBytes, watermark), None to disable
+    global _memoryWatermarkCallback
+    if(callback is None):
+        _memoryWatermarkCallback = RvMemoryWatermarkCallback()
+    else:
+        _memoryWatermarkCallback = RvMemoryWatermarkCallback(lambda current, watermark, userData: callback(current, watermark))
+    rvSetMemoryWatermarkCallback(watermark, _memoryWatermarkCallback, None)
+
+RvLogDebug, RvLogWarning, RvLogCritical, RvLogFatal = range(4)
+RvLogSinkFunc = ctypes.CFUNCTYPE(None, ctypes.c_int, ctypes.c_char_p, ctypes.c_int, ctypes.c_void_p)
+
+rvSetLogSink = ctypes.CDLL("librevoice.dll").rvSetLogSink
+rvSetLogSink.argtypes = [RvLogSinkFunc, ctypes.c_void_p]
+rvSetLogSink.restype = None
+
+rvSetLogSeverity = ctypes.CDLL("librevoice.dll").rvSetLogSeverity
+rvSetLogSeverity.argtypes = [ctypes.c_int]
+rvSetLogSeverity.restype = None
+
+rvSetLogRateLimit = ctypes.CDLL("librevoice.dll").rvSetLogRateLimit
+rvSetLogRateLimit.argtypes = [ctypes.c_int]
+rvSetLogRateLimit.restype = None
+
+rvFlushLog = ctypes.CDLL("librevoice.dll").rvFlushLog
+rvFlushLog.argtypes = []
+rvFlushLog.restype = None
+
+_logSink = None
+def setLogSink(sink):
+    # sink(severity, message, nSuppressed) runs on the drain thread, None restores stderr
+    # restore it before the interpreter exits, the library flushes the queue at exit
+    global _logSink
+    if(sink is None):
+        newSink = RvLogSinkFunc()
+    else:
+        newSink = RvLogSinkFunc(lambda severity, message, nSuppressed, userData: sink(severity, message.decode(errors = "replace"), nSuppressed))
+    rvSetLogSink(newSink, None)
+    _logSink = newSink
+
+rvEnterRTSection = ctypes.CDLL("librevoice.dll").rvEnterRTSection
+rvEnterRTSection.argtypes = []
+rvEnterRTSection.restype = None
+
+rvLeaveRTSection = ctypes.CDLL("librevoice.dll").rvLeaveRTSection
+rvLeaveRTSection.argtypes = []
+rvLeaveRTSection.restype = None
+
+rvRTSectionDepth = ctypes.CDLL("librevoice.dll").rvRTSectionDepth
+rvRTSectionDepth.argtypes = []
+rvRTSectionDepth.restype = ctypes.c_int
+
+rvRTViolationCount = ctypes.CDLL("librevoice.dll").rvRTViolationCount
+rvRTViolationCount.argtypes = []
+rvRTViolationCount.restype = ctypes.c_int
+
+rvSetAbortOnRTViolation = ctypes.CDLL("librevoice.dll").rvSetAbortOnRTViolation
+rvSetAbortOnRTViolation.argtypes = [ctypes.c_bool]
+rvSetAbortOnRTViolation.restype = None
+
+RV_INPLACE_ALIGNMENT = 64
+
+def inPlaceBuffer(size):
+    # zeroed bytes aligned for rvInit*InPlace, keep the array alive as long as the object in it
+    raw = np.zeros(size + RV_INPLACE_ALIGNMENT, dtype = np.uint8)
+    offset = -raw.ctypes.data % RV_INPLACE_ALIGNMENT
+    return raw[offset:offset + size]
+
+class RTSection:
+    # with RTSection(): ... marks a block that must not allocate or free in librevoice
+    def __enter__(self):
+        rvEnterRTSection()
+        return self
+
+    def __exit__(self, *args):
+        rvLeaveRTSection()
+
 windowDict = {
     #           func(N), main-lobe-width, mean
     'hanning': (sp.hanning, 1.5, 0.5),
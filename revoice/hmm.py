@@ -0,0 +1,254 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+int_1d = npct.ndpointer(dtype = np.intc, ndim = 1, flags = "C")
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+RvReal_2d = npct.ndpointer(dtype = np.float64, ndim = 2, flags = "C")
+bool_1d = npct.ndpointer(dtype = np.bool_, ndim = 1, flags = "C")
+
+class RvSparseHMM(ctypes.Structure):
+    pass
+
+pRvSparseHMM = ctypes.POINTER(RvSparseHMM)
+
+rvCreateSparseHMM = dll.rvCreateSparseHMM
+rvCreateSparseHMM.argtypes = [RvReal_1d, int_1d, int_1d, RvReal_1d, ctypes.c_int, ctypes.c_int]
+rvCreateSparseHMM.restype = pRvSparseHMM
+
+rvReleaseSparseHMM = dll.rvReleaseSparseHMM
+rvReleaseSparseHMM.argtypes = [pRvSparseHMM]
+rvReleaseSparseHMM.restype = None
+
+rvSparseHMMNState = dll.rvSparseHMMNState
+rvSparseHMMNState.argtypes = [pRvSparseHMM]
+rvSparseHMMNState.restype = ctypes.c_int
+
+rvSparseHMMBackpointerSize = dll.rvSparseHMMBackpointerSize
+rvSparseHMMBackpointerSize.argtypes = [pRvSparseHMM]
+rvSparseHMMBackpointerSize.restype = ctypes.c_int
+
+rvSparseHMMViterbiDecode = dll.rvSparseHMMViterbiDecode
+rvSparseHMMViterbiDecode.argtypes = [pRvSparseHMM, RvReal_2d, ctypes.c_int, int_1d]
+rvSparseHMMViterbiDecode.restype = None
+
+rvSparseHMMPosterior = dll.rvSparseHMMPosterior
+rvSparseHMMPosterior.argtypes = [pRvSparseHMM, RvReal_2d, ctypes.c_int, ctypes.c_int, RvReal_2d]
+rvSparseHMMPosterior.restype = RvReal
+
+class RvRTSparseHMM(ctypes.Structure):
+    pass
+
+pRvRTSparseHMM = ctypes.POINTER(RvRTSparseHMM)
+
+class RvRTSparseHMMBank(ctypes.Structure):
+    pass
+
+pRvRTSparseHMMBank = ctypes.POINTER(RvRTSparseHMMBank)
+
+rvCreateRTSparseHMMFromModel = dll.rvCreateRTSparseHMMFromModel
+rvCreateRTSparseHMMFromModel.argtypes = [pRvSparseHMM, ctypes.c_int]
+rvCreateRTSparseHMMFromModel.restype = pRvRTSparseHMM
+
+rvRTSparseHMMFeed = dll.rvRTSparseHMMFeed
+rvRTSparseHMMFeed.argtypes = [pRvRTSparseHMM, RvReal_1d]
+rvRTSparseHMMFeed.restype = ctypes.c_bool
+
+rvRTSparseHMMViterbiDecode = dll.rvRTSparseHMMViterbiDecode
+rvRTSparseHMMViterbiDecode.argtypes = [pRvRTSparseHMM, int_1d, ctypes.c_int]
+rvRTSparseHMMViterbiDecode.restype = ctypes.c_int
+
+rvRTSparseHMMCurrentAvailable = dll.rvRTSparseHMMCurrentAvailable
+rvRTSparseHMMCurrentAvailable.argtypes = [pRvRTSparseHMM]
+rvRTSparseHMMCurrentAvailable.restype = ctypes.c_int
+
+rvRTSparseHMMSetBeam = dll.rvRTSparseHMMSetBeam
+rvRTSparseHMMSetBeam.argtypes = [pRvRTSparseHMM, RvReal]
+rvRTSparseHMMSetBeam.restype = None
+
+rvRTSparseHMMActiveCount = dll.rvRTSparseHMMActiveCount
+rvRTSparseHMMActiveCount.argtypes = [pRvRTSparseHMM]
+rvRTSparseHMMActiveCount.restype = ctypes.c_int
+
+rvResetRTSparseHMM = dll.rvResetRTSparseHMM
+rvResetRTSparseHMM.argtypes = [pRvRTSparseHMM]
+rvResetRTSparseHMM.restype = None
+
+rvDestroyRTSparseHMM = dll.rvDestroyRTSparseHMM
+rvDestroyRTSparseHMM.argtypes = [pRvRTSparseHMM]
+rvDestroyRTSparseHMM.restype = None
+
+rvCreateRTSparseHMMBank = dll.rvCreateRTSparseHMMBank
+rvCreateRTSparseHMMBank.argtypes = [pRvSparseHMM, ctypes.c_int, ctypes.c_int]
+rvCreateRTSparseHMMBank.restype = pRvRTSparseHMMBank
+
+rvRTSparseHMMBankFeed = dll.rvRTSparseHMMBankFeed
+rvRTSparseHMMBankFeed.argtypes = [pRvRTSparseHMMBank, RvReal_2d, bool_1d]
+rvRTSparseHMMBankFeed.restype = None
+
+rvRTSparseHMMBankViterbiDecode = dll.rvRTSparseHMMBankViterbiDecode
+rvRTSparseHMMBankViterbiDecode.argtypes = [pRvRTSparseHMMBank, ctypes.c_int, int_1d, ctypes.c_int]
+rvRTSparseHMMBankViterbiDecode.restype = ctypes.c_int
+
+rvRTSparseHMMBankCurrentAvailable = dll.rvRTSparseHMMBankCurrentAvailable
+rvRTSparseHMMBankCurrentAvailable.argtypes = [pRvRTSparseHMMBank, ctypes.c_int]
+rvRTSparseHMMBankCurrentAvailable.restype = ctypes.c_int
+
+rvRTSparseHMMBankResetStream = dll.rvRTSparseHMMBankResetStream
+rvRTSparseHMMBankResetStream.argtypes = [pRvRTSparseHMMBank, ctypes.c_int]
+rvRTSparseHMMBankResetStream.restype = None
+
+rvDestroyRTSparseHMMBank = dll.rvDestroyRTSparseHMMBank
+rvDestroyRTSparseHMMBank.argtypes = [pRvRTSparseHMMBank]
+rvDestroyRTSparseHMMBank.restype = None
+
+class RvRTSparseHMMSmoother(ctypes.Structure):
+    pass
+
+pRvRTSparseHMMSmoother = ctypes.POINTER(RvRTSparseHMMSmoother)
+
+rvCreateRTSparseHMMSmoother = dll.rvCreateRTSparseHMMSmoother
+rvCreateRTSparseHMMSmoother.argtypes = [pRvSparseHMM, ctypes.c_int]
+rvCreateRTSparseHMMSmoother.restype = pRvRTSparseHMMSmoother
+
+rvRTSparseHMMSmootherFeed = dll.rvRTSparseHMMSmootherFeed
+rvRTSparseHMMSmootherFeed.argtypes = [pRvRTSparseHMMSmoother, ctypes.POINTER(RvReal), RvReal_1d]
+rvRTSparseHMMSmootherFeed.restype = ctypes.c_int
+
+rvDestroyRTSparseHMMSmoother = dll.rvDestroyRTSparseHMMSmoother
+rvDestroyRTSparseHMMSmoother.argtypes = [pRvRTSparseHMMSmoother]
+rvDestroyRTSparseHMMSmoother.restype = None
+
+class SparseHMM:
+    def __init__(self, init, frm, to, transProb):
+        self.init = np.require(init, np.float64, ("C_CONTIGUOUS",))
+        self.frm = np.require(frm, np.intc, ("C_CONTIGUOUS",))
+        self.to = np.require(to, np.intc, ("C_CONTIGUOUS",))
+        self.transProb = np.require(transProb, np.float64, ("C_CONTIGUOUS",))
+
+        assert self.frm.shape == self.to.shape == self.transProb.shape
+
+        nState = len(self.init)
+        nTrans = len(self.transProb)
+        self.proc = rvCreateSparseHMM(self.init, self.frm, self.to, self.transProb, nState, nTrans)
+
+    def __del__(self):
+        rvReleaseSparseHMM(self.proc)
+
+    @property
+    def backpointerSize(self):
+        return rvSparseHMMBackpointerSize(self.proc)
+
+    def viterbiDecode(self, obsSeq):
+        obsSeq = np.require(obsSeq, np.float64, ("C_CONTIGUOUS",))
+        if(obsSeq.ndim != 2 or obsSeq.shape[1] != len(self.init)):
+            raise ValueError("invalid obsSeq")
+        nFrame = obsSeq.shape[0]
+        if(nFrame <= 0):
+            return np.zeros(0, dtype = np.intc)
+        out = np.zeros(nFrame, dtype = np.intc)
+        rvSparseHMMViterbiDecode(self.proc, obsSeq, nFrame, out)
+        return out
+
+    def posterior(self, obsSeq, nThread = 1):
+        obsSeq = np.require(obsSeq, np.float64, ("C_CONTIGUOUS",))
+        if(obsSeq.ndim != 2 or obsSeq.shape[1] != len(self.init)):
+            raise ValueError("invalid obsSeq")
+        nFrame = obsSeq.shape[0]
+        out = np.zeros(obsSeq.shape, dtype = np.float64)
+        if(nFrame <= 0):
+            return out, 0.0
+        logLikelihood = rvSparseHMMPosterior(self.proc, obsSeq, nFrame, int(nThread), out)
+        return out, logLikelihood
+class RTSparseHMM:
+    # decodes frame by frame, the model is shared with the SparseHMM it comes from
+    def __init__(self, model, nMaxBackward):
+        self.nState = len(model.init)
+        self.nMaxBackward = int(nMaxBackward)
+        self.proc = rvCreateRTSparseHMMFromModel(model.proc, self.nMaxBackward)
+
+    def __del__(self):
+        rvDestroyRTSparseHMM(self.proc)
+
+    def reset(self):
+        rvResetRTSparseHMM(self.proc)
+
+    def feed(self, obs):
+        obs = np.require(obs, np.float64, ("C_CONTIGUOUS",))
+        if(obs.shape != (self.nState,)):
+            raise ValueError("invalid obs")
+        return rvRTSparseHMMFeed(self.proc, obs)
+
+    def viterbiDecode(self, nBackward):
+        out = np.zeros(nBackward, dtype = np.intc)
+        n = rvRTSparseHMMViterbiDecode(self.proc, out, nBackward)
+        return out[:n]
+
+    @property
+    def currentAvailable(self):
+        return rvRTSparseHMMCurrentAvailable(self.proc)
+
+    def setBeam(self, logBeam):
+        # logBeam <= 0 disables pruning
+        rvRTSparseHMMSetBeam(self.proc, logBeam)
+
+    @property
+    def activeCount(self):
+        return rvRTSparseHMMActiveCount(self.proc)
+
+class RTSparseHMMBank:
+    # nStream independent decoders stepped together
+    def __init__(self, model, nStream, nMaxBackward):
+        self.nState = len(model.init)
+        self.nStream = int(nStream)
+        self.nMaxBackward = int(nMaxBackward)
+        self.proc = rvCreateRTSparseHMMBank(model.proc, self.nStream, self.nMaxBackward)
+
+    def __del__(self):
+        rvDestroyRTSparseHMMBank(self.proc)
+
+    def resetStream(self, iStream):
+        rvRTSparseHMMBankResetStream(self.proc, iStream)
+
+    def feed(self, obs):
+        # obs is (nStream, nState), returns the ok flag of every stream
+        obs = np.asarray(obs, dtype = np.float64)
+        if(obs.shape != (self.nStream, self.nState)):
+            raise ValueError("invalid obs")
+        ok = np.zeros(self.nStream, dtype = np.bool_)
+        rvRTSparseHMMBankFeed(self.proc, np.ascontiguousarray(obs.T), ok)
+        return ok
+
+    def viterbiDecode(self, iStream, nBackward):
+        out = np.zeros(nBackward, dtype = np.intc)
+        n = rvRTSparseHMMBankViterbiDecode(self.proc, iStream, out, nBackward)
+        return out[:n]
+
+    def currentAvailable(self, iStream):
+        return rvRTSparseHMMBankCurrentAvailable(self.proc, iStream)
+
+class RTSparseHMMSmoother:
+    # fixed-lag posterior, frame i is emitted once frame i + lag is fed
+    def __init__(self, model, lag):
+        self.nState = len(model.init)
+        self.lag = int(lag)
+        self.proc = rvCreateRTSparseHMMSmoother(model.proc, self.lag)
+
+    def __del__(self):
+        rvDestroyRTSparseHMMSmoother(self.proc)
+
+    def __call__(self, obs):
+        # obs = None emits the oldest pending frame, returns (iFrame, posterior) or None
+        out = np.zeros(self.nState, dtype = np.float64)
+        if(obs is None):
+            iFrame = rvRTSparseHMMSmootherFeed(self.proc, None, out)
+        else:
+            obs = np.require(obs, np.float64, ("C_CONTIGUOUS",))
+            if(obs.shape != (self.nState,)):
+                raise ValueError("invalid obs")
+            iFrame = rvRTSparseHMMSmootherFeed(self.proc, obs.ctypes.data_as(ctypes.POINTER(RvReal)), out)
+        if(iFrame < 0):
+            return None
+        return iFrame, out
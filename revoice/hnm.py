@@ -0,0 +1,144 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+
+from .common import *
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+RvReal_2d = npct.ndpointer(dtype = np.float64, ndim = 2, flags = "C")
+
+class RvWindowInfo(ctypes.Structure):
+    _fields_ = [
+        ("name", ctypes.c_char_p),
+        ("func", ctypes.c_void_p),
+        ("B", RvReal), ("mean", RvReal),
+    ]
+
+pRvWindowInfo = ctypes.POINTER(RvWindowInfo)
+
+class RvHNMAnalyzerParameter(ctypes.Structure):
+    _fields_ = [
+        ("samprate", RvReal),
+        ("hopSize", ctypes.c_int), ("fftSize", ctypes.c_int),
+        ("window", pRvWindowInfo),
+        ("mvf", RvReal),
+        ("maxAvgHarmonic", ctypes.c_int),
+        ("maxHarmonicOffset", RvReal), ("peakSearchRange", RvReal),
+        ("noiseEnvOrderFac", RvReal), ("noiseEnergyThreshold", RvReal),
+    ]
+
+pRvHNMAnalyzerParameter = ctypes.POINTER(RvHNMAnalyzerParameter)
+
+class RvHNMSynthesizerParameter(ctypes.Structure):
+    _fields_ = [
+        ("samprate", RvReal),
+        ("hopSize", ctypes.c_int),
+        ("mvf", RvReal),
+    ]
+
+pRvHNMSynthesizerParameter = ctypes.POINTER(RvHNMSynthesizerParameter)
+
+rvGetWindow = dll.rvGetWindow
+rvGetWindow.argtypes = [ctypes.c_char_p]
+rvGetWindow.restype = pRvWindowInfo
+
+rvCreateHNMAnalyzerParameter = dll.rvCreateHNMAnalyzerParameter
+rvCreateHNMAnalyzerParameter.argtypes = [RvReal]
+rvCreateHNMAnalyzerParameter.restype = pRvHNMAnalyzerParameter
+
+rvDestroyHNMAnalyzerParameter = dll.rvDestroyHNMAnalyzerParameter
+rvDestroyHNMAnalyzerParameter.argtypes = [pRvHNMAnalyzerParameter]
+rvDestroyHNMAnalyzerParameter.restype = None
+
+rvHNMMaxHarmonic = dll.rvHNMMaxHarmonic
+rvHNMMaxHarmonic.argtypes = [pRvHNMAnalyzerParameter, RvReal_1d, ctypes.c_int]
+rvHNMMaxHarmonic.restype = ctypes.c_int
+
+rvCallHNMAnalyzer = dll.rvCallHNMAnalyzer
+rvCallHNMAnalyzer.argtypes = [pRvHNMAnalyzerParameter, RvReal_1d, ctypes.c_int, RvReal_1d, ctypes.c_int, RvReal_1d, RvReal_2d, RvReal_2d, RvReal_2d, RvReal_1d, RvReal_2d, RvReal_1d]
+rvCallHNMAnalyzer.restype = None
+
+rvCreateHNMSynthesizerParameter = dll.rvCreateHNMSynthesizerParameter
+rvCreateHNMSynthesizerParameter.argtypes = [RvReal]
+rvCreateHNMSynthesizerParameter.restype = pRvHNMSynthesizerParameter
+
+rvDestroyHNMSynthesizerParameter = dll.rvDestroyHNMSynthesizerParameter
+rvDestroyHNMSynthesizerParameter.argtypes = [pRvHNMSynthesizerParameter]
+rvDestroyHNMSynthesizerParameter.restype = None
+
+rvCallHNMSynthesizer = dll.rvCallHNMSynthesizer
+rvCallHNMSynthesizer.argtypes = [pRvHNMSynthesizerParameter, RvReal_1d, RvReal_2d, RvReal_2d, RvReal_2d, RvReal_1d, ctypes.c_int, ctypes.c_int, RvReal_1d]
+rvCallHNMSynthesizer.restype = None
+
+def createSynthesizerParameter(sr, **kwargs):
+    param = rvCreateHNMSynthesizerParameter(float(sr))
+    for key in ("hopSize", "mvf"):
+        if(key in kwargs):
+            setattr(param.contents, key, kwargs[key])
+    return param
+
+class Analyzer:
+    def __init__(self, sr, **kwargs):
+        # frames are analyzed on the shared pool, see threadpool.setSharedPool
+        self.samprate = float(sr)
+        self.param = rvCreateHNMAnalyzerParameter(self.samprate)
+        if("window" in kwargs):
+            window = rvGetWindow(kwargs["window"].encode())
+            if(not window):
+                raise ValueError("Unsupported window: %s" % kwargs["window"])
+            self.param.contents.window = window
+        for key in ("hopSize", "fftSize", "mvf", "maxAvgHarmonic", "maxHarmonicOffset", "peakSearchRange", "noiseEnvOrderFac", "noiseEnergyThreshold"):
+            if(key in kwargs):
+                setattr(self.param.contents, key, kwargs[key])
+        self.hopSize = self.param.contents.hopSize
+        self.fftSize = self.param.contents.fftSize
+        self.mvf = self.param.contents.mvf
+
+    def __del__(self):
+        rvDestroyHNMAnalyzerParameter(self.param)
+
+    def __call__(self, x, f0List):
+        # -> f0List, hFreqList, hAmpList, hPhaseList, sinusoidEnergyList, noiseEnvList, noiseEnergyList
+        x = np.ascontiguousarray(x, dtype = np.float64)
+        f0List = np.ascontiguousarray(f0List, dtype = np.float64)
+        nHop = getNFrame(len(x), self.hopSize)
+        nBin = self.fftSize // 2 + 1
+        assert(len(f0List) == nHop)
+
+        maxHar = rvHNMMaxHarmonic(self.param, f0List, nHop)
+        refinedF0List = np.zeros(nHop, dtype = np.float64)
+        hFreqList = np.zeros((nHop, max(1, maxHar)), dtype = np.float64)
+        hAmpList = np.zeros((nHop, max(1, maxHar)), dtype = np.float64)
+        hPhaseList = np.zeros((nHop, max(1, maxHar)), dtype = np.float64)
+        sinusoidEnergyList = np.zeros(nHop, dtype = np.float64)
+        noiseEnvList = np.zeros((nHop, nBin), dtype = np.float64)
+        noiseEnergyList = np.zeros(nHop, dtype = np.float64)
+        rvCallHNMAnalyzer(self.param, x, len(x), f0List, maxHar, refinedF0List, hFreqList, hAmpList, hPhaseList, sinusoidEnergyList, noiseEnvList, noiseEnergyList)
+        return refinedF0List, hFreqList[:, :maxHar], hAmpList[:, :maxHar], hPhaseList[:, :maxHar], sinusoidEnergyList, noiseEnvList, noiseEnergyList
+
+class Synther:
+    def __init__(self, sr, **kwargs):
+        # renders the sinusoidal part only, hops run on the shared pool, see threadpool.setSharedPool
+        self.samprate = float(sr)
+        self.param = createSynthesizerParameter(self.samprate, **kwargs)
+        self.hopSize = self.param.contents.hopSize
+        self.mvf = self.param.contents.mvf
+
+    def __del__(self):
+        rvDestroyHNMSynthesizerParameter(self.param)
+
+    def __call__(self, f0List, hFreqList, hAmpList, hPhaseList, sinusoidEnergyList):
+        f0List = np.ascontiguousarray(f0List, dtype = np.float64)
+        hFreqList = np.ascontiguousarray(hFreqList, dtype = np.float64)
+        hAmpList = np.ascontiguousarray(hAmpList, dtype = np.float64)
+        hPhaseList = np.ascontiguousarray(hPhaseList, dtype = np.float64)
+        sinusoidEnergyList = np.ascontiguousarray(sinusoidEnergyList, dtype = np.float64)
+        nHop, maxHar = hFreqList.shape
+        assert(len(f0List) == nHop and len(sinusoidEnergyList) == nHop)
+        assert(hAmpList.shape == hFreqList.shape and hPhaseList.shape == hFreqList.shape)
+
+        out = np.zeros(nHop * self.hopSize, dtype = np.float64)
+        rvCallHNMSynthesizer(self.param, f0List, hFreqList, hAmpList, hPhaseList, sinusoidEnergyList, nHop, maxHar, out)
+        return out
@@ -0,0 +1,34 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+from . import rtpyin, rtmonopitch, rtpitchtracker
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+
+rvPitchTrackerNFrame = dll.rvPitchTrackerNFrame
+rvPitchTrackerNFrame.argtypes = [rtpyin.pRvRTPYinProcessorParameter, ctypes.c_int]
+rvPitchTrackerNFrame.restype = ctypes.c_int
+
+rvCallPitchTracker = dll.rvCallPitchTracker
+rvCallPitchTracker.argtypes = [rtpyin.pRvRTPYinProcessorParameter, rtmonopitch.pRvRTMonoPitchProcessorParameter, RvReal_1d, ctypes.c_int, ctypes.c_int, ctypes.c_int, RvReal_1d]
+rvCallPitchTracker.restype = None
+
+class Processor:
+    def __init__(self, sr, chunkSize = 1024, overlapSize = 128, **kwargs):
+        # chunks of chunkSize hops are decoded in parallel on the shared pool, see threadpool.setSharedPool
+        self.pyinProc, self.pyinParam, self.monoParam = rtpitchtracker.createParameter(sr, **kwargs)
+        self.samprate = self.pyinProc.samprate
+        self.hopSize = self.pyinProc.hopSize
+        self.chunkSize = int(chunkSize)
+        self.overlapSize = int(overlapSize)
+
+    def __del__(self):
+        rtmonopitch.rvDestroyRTMonoPitchProcessorParameter(self.monoParam)
+
+    def __call__(self, x):
+        x = np.ascontiguousarray(x, dtype = np.float64)
+        out = np.zeros(rvPitchTrackerNFrame(self.pyinParam, len(x)), dtype = np.float64)
+        rvCallPitchTracker(self.pyinParam, self.monoParam, x, len(x), self.chunkSize, self.overlapSize, out)
+        return out
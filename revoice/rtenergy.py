@@ -0,0 +1,56 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+
+class RvRTEnergyTracker(ctypes.Structure):
+    pass
+
+pRvRTEnergyTracker = ctypes.POINTER(RvRTEnergyTracker)
+
+rvCreateRTEnergyTracker = dll.rvCreateRTEnergyTracker
+rvCreateRTEnergyTracker.argtypes = [ctypes.c_int, ctypes.c_int, RvReal, RvReal]
+rvCreateRTEnergyTracker.restype = pRvRTEnergyTracker
+
+rvCallRTEnergyTracker = dll.rvCallRTEnergyTracker
+rvCallRTEnergyTracker.argtypes = [pRvRTEnergyTracker, RvReal_1d, ctypes.c_int]
+rvCallRTEnergyTracker.restype = ctypes.c_int
+
+rvRTEnergyTrackerEnergy = dll.rvRTEnergyTrackerEnergy
+rvRTEnergyTrackerEnergy.argtypes = [pRvRTEnergyTracker]
+rvRTEnergyTrackerEnergy.restype = RvReal
+
+rvRTEnergyTrackerIsSilent = dll.rvRTEnergyTrackerIsSilent
+rvRTEnergyTrackerIsSilent.argtypes = [pRvRTEnergyTracker]
+rvRTEnergyTrackerIsSilent.restype = ctypes.c_bool
+
+rvResetRTEnergyTracker = dll.rvResetRTEnergyTracker
+rvResetRTEnergyTracker.argtypes = [pRvRTEnergyTracker]
+rvResetRTEnergyTracker.restype = None
+
+rvDestroyRTEnergyTracker = dll.rvDestroyRTEnergyTracker
+rvDestroyRTEnergyTracker.argtypes = [pRvRTEnergyTracker]
+rvDestroyRTEnergyTracker.restype = None
+
+class Processor:
+    def __init__(self, hopSize, nWindowHop, silentThreshold, voicedThreshold = None):
+        self.hopSize = int(hopSize)
+        self.nWindowHop = int(nWindowHop)
+        self.silentThreshold = silentThreshold
+        self.voicedThreshold = silentThreshold if voicedThreshold is None else voicedThreshold
+        self.proc = rvCreateRTEnergyTracker(self.hopSize, self.nWindowHop, self.silentThreshold, self.voicedThreshold)
+
+    def __del__(self):
+        rvDestroyRTEnergyTracker(self.proc)
+
+    def reset(self):
+        rvResetRTEnergyTracker(self.proc)
+
+    def __call__(self, x):
+        # x can be of any length, returns the number of hops completed, energy and silent state after the last one
+        x = np.ascontiguousarray(x, dtype = np.float64)
+        nHop = rvCallRTEnergyTracker(self.proc, x, len(x))
+        return nHop, rvRTEnergyTrackerEnergy(self.proc), rvRTEnergyTrackerIsSilent(self.proc)
@@ -27,6 +27,14 @@ rvCreateRTFilter = dll.rvCreateRTFilter
 rvCreateRTFilter.argtypes = [RvReal_1d, ctypes.c_int, ctypes.c_int]
 rvCreateRTFilter.restype = pRvRTFilter
 
+rvRTFilterRequiredSize = dll.rvRTFilterRequiredSize
+rvRTFilterRequiredSize.argtypes = [ctypes.c_int, ctypes.c_int]
+rvRTFilterRequiredSize.restype = ctypes.c_size_t
+
+rvInitRTFilterInPlace = dll.rvInitRTFilterInPlace
+rvInitRTFilterInPlace.argtypes = [ctypes.c_void_p, RvReal_1d, ctypes.c_int, ctypes.c_int]
+rvInitRTFilterInPlace.restype = pRvRTFilter
+
 rvRTFilterNextOutputSize = dll.rvRTFilterNextOutputSize
 rvRTFilterNextOutputSize.argtypes = [pRvRTFilter, ctypes.c_int]
 rvRTFilterNextOutputSize.restype = ctypes.c_int
@@ -35,6 +43,10 @@ rvCallRTFilter = dll.rvCallRTFilter
 rvCallRTFilter.argtypes = [pRvRTFilter, RvReal_1d, ctypes.c_int, RvReal_1d]
 rvCallRTFilter.restype = ctypes.c_int
 
+rvResetRTFilter = dll.rvResetRTFilter
+rvResetRTFilter.argtypes = [pRvRTFilter]
+rvResetRTFilter.restype = None
+
 rvDestroyRTFilter = dll.rvDestroyRTFilter
 rvDestroyRTFilter.argtypes = [pRvRTFilter]
 rvDestroyRTFilter.restype = None
@@ -52,7 +64,7 @@ rvRTFilterMaxOutputSize.argtypes = [ctypes.c_int, ctypes.c_int]
 rvRTFilterMaxOutputSize.restype = ctypes.c_int
 
 class Procressor:
-    def __init__(self, kernel, maxNX):
+    def __init__(self, kernel, maxNX, inPlace = False):
         self.kernel = kernel
 
         kernelSize = len(self.kernel)
@@ -62,11 +74,18 @@ class Procressor:
         if(kernelSize % 2 == 0):
             raise ValueError("length of kernel must be odd")
         
-        self.proc = rvCreateRTFilter(kernel, kernelSize, maxNX)
+        if(inPlace):
+            self.mem = inPlaceBuffer(rvRTFilterRequiredSize(kernelSize, maxNX))
+            self.proc = rvInitRTFilterInPlace(self.mem.ctypes.data, kernel, kernelSize, maxNX)
+        else:
+            self.proc = rvCreateRTFilter(kernel, kernelSize, maxNX)
     
     def __del__(self):
         rvDestroyRTFilter(self.proc)
 
+    def reset(self):
+        rvResetRTFilter(self.proc)
+
     @property
     def delayed(self):
         return rvRTFilterDelayed(self.proc)
@@ -0,0 +1,77 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+
+from .common import *
+from . import hnm
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+
+class RvRTHNMSynthesizer(ctypes.Structure):
+    pass
+
+pRvRTHNMSynthesizer = ctypes.POINTER(RvRTHNMSynthesizer)
+pRvReal = ctypes.POINTER(RvReal)
+
+rvCreateRTHNMSynthesizer = dll.rvCreateRTHNMSynthesizer
+rvCreateRTHNMSynthesizer.argtypes = [hnm.pRvHNMSynthesizerParameter, ctypes.c_int]
+rvCreateRTHNMSynthesizer.restype = pRvRTHNMSynthesizer
+
+rvRTHNMSynthesizerRequiredSize = dll.rvRTHNMSynthesizerRequiredSize
+rvRTHNMSynthesizerRequiredSize.argtypes = [hnm.pRvHNMSynthesizerParameter, ctypes.c_int]
+rvRTHNMSynthesizerRequiredSize.restype = ctypes.c_size_t
+
+rvInitRTHNMSynthesizerInPlace = dll.rvInitRTHNMSynthesizerInPlace
+rvInitRTHNMSynthesizerInPlace.argtypes = [ctypes.c_void_p, hnm.pRvHNMSynthesizerParameter, ctypes.c_int]
+rvInitRTHNMSynthesizerInPlace.restype = pRvRTHNMSynthesizer
+
+rvCallRTHNMSynthesizer = dll.rvCallRTHNMSynthesizer
+rvCallRTHNMSynthesizer.argtypes = [pRvRTHNMSynthesizer, RvReal, pRvReal, pRvReal, pRvReal, RvReal, RvReal_1d]
+rvCallRTHNMSynthesizer.restype = ctypes.c_int
+
+rvResetRTHNMSynthesizer = dll.rvResetRTHNMSynthesizer
+rvResetRTHNMSynthesizer.argtypes = [pRvRTHNMSynthesizer]
+rvResetRTHNMSynthesizer.restype = None
+
+rvDestroyRTHNMSynthesizer = dll.rvDestroyRTHNMSynthesizer
+rvDestroyRTHNMSynthesizer.argtypes = [pRvRTHNMSynthesizer]
+rvDestroyRTHNMSynthesizer.restype = None
+
+class Processor:
+    def __init__(self, sr, maxHar, inPlace = False, **kwargs):
+        param = hnm.createSynthesizerParameter(sr, **kwargs)
+        self.samprate = param.contents.samprate
+        self.hopSize = param.contents.hopSize
+        self.maxHar = maxHar
+
+        if(inPlace):
+            self.mem = inPlaceBuffer(rvRTHNMSynthesizerRequiredSize(param, maxHar))
+            self.proc = rvInitRTHNMSynthesizerInPlace(self.mem.ctypes.data, param, maxHar)
+        else:
+            self.proc = rvCreateRTHNMSynthesizer(param, maxHar)
+        hnm.rvDestroyHNMSynthesizerParameter(param)
+        self.outTemp = np.zeros(self.hopSize, dtype = np.float64)
+
+    def __del__(self):
+        rvDestroyRTHNMSynthesizer(self.proc)
+
+    def reset(self):
+        rvResetRTHNMSynthesizer(self.proc)
+
+    def __call__(self, f0, hFreq = None, hAmp = None, hPhase = None, sinusoidEnergy = 0.0):
+        # one hop of analyzer output, f0 = None renders the held last hop, returns hopSize samples or None
+        if(f0 is None):
+            nOut = rvCallRTHNMSynthesizer(self.proc, 0.0, None, None, None, 0.0, self.outTemp)
+        else:
+            hFreq = np.ascontiguousarray(hFreq, dtype = np.float64)
+            hAmp = np.ascontiguousarray(hAmp, dtype = np.float64)
+            hPhase = np.ascontiguousarray(hPhase, dtype = np.float64)
+            if(len(hFreq) != self.maxHar or len(hAmp) != self.maxHar or len(hPhase) != self.maxHar):
+                raise ValueError("length of harmonic arrays must be maxHar")
+            nOut = rvCallRTHNMSynthesizer(self.proc, f0, hFreq.ctypes.data_as(pRvReal), hAmp.ctypes.data_as(pRvReal), hPhase.ctypes.data_as(pRvReal), sinusoidEnergy, self.outTemp)
+
+        if(nOut == 0):
+            return None
+        return self.outTemp[:nOut].copy()
@@ -0,0 +1,112 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+from . import rtpyin
+from .common import *
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+RvReal_2d = npct.ndpointer(dtype = np.float64, ndim = 2, flags = "C")
+
+class RvRTMonoNoteProcessorParameter(ctypes.Structure):
+    _fields_ = [
+        ("probAttackTransSelf", RvReal), ("probStableTransSelf", RvReal),
+        ("probSilentTransSelf", RvReal), ("probStableToSilent", RvReal),
+        ("noteSigma", RvReal), ("priorPitchedProb", RvReal), ("priorWeight", RvReal),
+        ("minTransSemitone", RvReal), ("maxTransSemitone", RvReal),
+        ("yinAttackSigma", RvReal), ("yinStableSigma", RvReal), ("yinTrust", RvReal),
+        ("hopSize", ctypes.c_int), ("minSemitone", ctypes.c_int), ("nSemitone", ctypes.c_int),
+        ("binPerSemitone", ctypes.c_int), ("maxObsLength", ctypes.c_int),
+        ("maxCandidate", ctypes.c_int),
+    ]
+
+class RvRTMonoNoteEvent(ctypes.Structure):
+    _fields_ = [
+        ("pitch", RvReal),
+        ("begin", ctypes.c_int), ("end", ctypes.c_int),
+    ]
+
+class RvRTMonoNoteProcessor(ctypes.Structure):
+    pass
+
+pRvRTMonoNoteProcessorParameter = ctypes.POINTER(RvRTMonoNoteProcessorParameter)
+pRvRTMonoNoteProcessor = ctypes.POINTER(RvRTMonoNoteProcessor)
+pRvRTMonoNoteEvent = ctypes.POINTER(RvRTMonoNoteEvent)
+
+rvCreateRTMonoNoteProcessorParameter = dll.rvCreateRTMonoNoteProcessorParameter
+rvCreateRTMonoNoteProcessorParameter.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int]
+rvCreateRTMonoNoteProcessorParameter.restype = pRvRTMonoNoteProcessorParameter
+
+rvDestroyRTMonoNoteProcessorParameter = dll.rvDestroyRTMonoNoteProcessorParameter
+rvDestroyRTMonoNoteProcessorParameter.argtypes = [pRvRTMonoNoteProcessorParameter]
+rvDestroyRTMonoNoteProcessorParameter.restype = None
+
+rvCreateRTMonoNoteProcessor = dll.rvCreateRTMonoNoteProcessor
+rvCreateRTMonoNoteProcessor.argtypes = [pRvRTMonoNoteProcessorParameter]
+rvCreateRTMonoNoteProcessor.restype = pRvRTMonoNoteProcessor
+
+rvMonoNoteMaxOutputLength = dll.rvMonoNoteMaxOutputLength
+rvMonoNoteMaxOutputLength.argtypes = [pRvRTMonoNoteProcessor]
+rvMonoNoteMaxOutputLength.restype = ctypes.c_int
+
+rvMonoNoteCurrentState = dll.rvMonoNoteCurrentState
+rvMonoNoteCurrentState.argtypes = [pRvRTMonoNoteProcessor, ctypes.POINTER(RvReal)]
+rvMonoNoteCurrentState.restype = ctypes.c_int
+
+rvCallRTMonoNote = dll.rvCallRTMonoNote
+rvCallRTMonoNote.argtypes = [pRvRTMonoNoteProcessor, RvReal_1d, RvReal_2d, ctypes.c_int, pRvRTMonoNoteEvent]
+rvCallRTMonoNote.restype = ctypes.c_int
+
+rvFlushRTMonoNote = dll.rvFlushRTMonoNote
+rvFlushRTMonoNote.argtypes = [pRvRTMonoNoteProcessor, pRvRTMonoNoteEvent]
+rvFlushRTMonoNote.restype = ctypes.c_int
+
+rvDestroyRTMonoNoteProcessor = dll.rvDestroyRTMonoNoteProcessor
+rvDestroyRTMonoNoteProcessor.argtypes = [pRvRTMonoNoteProcessor]
+rvDestroyRTMonoNoteProcessor.restype = None
+
+def parameterFromPYin(pyin):
+    hopSize = pyin.hopSize
+    minSemitone = int(freqToSemitone(pyin.minFreq))
+    nSemitone = int(np.ceil(freqToSemitone(pyin.maxFreq)) - minSemitone)
+    return hopSize, minSemitone, nSemitone
+
+class Processor:
+    def __init__(self, hopSize, minSemitone, nSemitone, **kwargs):
+        self.hopSize = int(hopSize)
+        self.minSemitone = int(minSemitone)
+        self.nSemitone = int(nSemitone)
+
+        param = rvCreateRTMonoNoteProcessorParameter(self.hopSize, self.minSemitone, self.nSemitone)
+        for key, _ in RvRTMonoNoteProcessorParameter._fields_:
+            if(key in kwargs):
+                setattr(param.contents, key, kwargs[key])
+            setattr(self, key, getattr(param.contents, key))
+        self.proc = rvCreateRTMonoNoteProcessor(param)
+        rvDestroyRTMonoNoteProcessorParameter(param)
+
+        self.eventTemp = (RvRTMonoNoteEvent * rvMonoNoteMaxOutputLength(self.proc))()
+
+    def __del__(self):
+        rvDestroyRTMonoNoteProcessor(self.proc)
+
+    @property
+    def currentState(self):
+        pitch = RvReal()
+        state = rvMonoNoteCurrentState(self.proc, ctypes.byref(pitch))
+        return state, pitch.value
+
+    def _noteList(self, n):
+        return [{"begin": self.eventTemp[i].begin, "end": self.eventTemp[i].end, "pitch": self.eventTemp[i].pitch} for i in range(n)]
+
+    def __call__(self, x, obsProb):
+        if(len(x) != self.hopSize * 2):
+            raise ValueError("length of x must be hopSize * 2")
+        obsProb = np.asarray(obsProb, dtype = np.float64).reshape(-1, 2)
+        n = rvCallRTMonoNote(self.proc, np.ascontiguousarray(x, dtype = np.float64), np.ascontiguousarray(obsProb), obsProb.shape[0], self.eventTemp)
+        return self._noteList(n)
+
+    def flush(self):
+        n = rvFlushRTMonoNote(self.proc, self.eventTemp)
+        return self._noteList(n)
\ No newline at end of file
@@ -2,26 +2,34 @@ import ctypes
 import numpy as np
 import numpy.ctypeslib as npct
 from . import rtpyin
+from .common import *
 
 dll = ctypes.CDLL("librevoice.dll")
 RvReal = ctypes.c_double
 RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
 RvReal_2d = npct.ndpointer(dtype = np.float64, ndim = 2, flags = "C")
+int_1d = npct.ndpointer(dtype = np.int32, ndim = 1, flags = "C")
 
 class RvRTMonoPitchProcessorParameter(ctypes.Structure):
     _fields_ = [
         ("samprate", RvReal),
         ("maxTransSemitone", RvReal), ("maxminFreq", RvReal),
         ("transSelf", RvReal), ("yinTrust", RvReal), ("energyThreshold", RvReal),
+        ("viterbiBeam", RvReal), ("energyHysteresis", RvReal),
         ("hopSize", ctypes.c_int), ("nSemitone", ctypes.c_int),
         ("binPerSemitone", ctypes.c_int), ("maxObsLength", ctypes.c_int),
+        ("maxCandidate", ctypes.c_int),
     ]
 
 class RvRTMonoPitchProcessor(ctypes.Structure):
     pass
 
+class RvRTMonoPitchProcessorPool(ctypes.Structure):
+    pass
+
 pRvRTMonoPitchProcessorParameter = ctypes.POINTER(RvRTMonoPitchProcessorParameter)
 pRvRTMonoPitchProcessor = ctypes.POINTER(RvRTMonoPitchProcessor)
+pRvRTMonoPitchProcessorPool = ctypes.POINTER(RvRTMonoPitchProcessorPool)
 
 rvCreateRTMonoPitchProcessorParameter = dll.rvCreateRTMonoPitchProcessorParameter
 rvCreateRTMonoPitchProcessorParameter.argtypes = [ctypes.c_int, RvReal, ctypes.c_int, RvReal, RvReal]
@@ -35,6 +43,22 @@ rvDestroyRTMonoPitchProcessorParameter = dll.rvDestroyRTMonoPitchProcessorParame
 rvDestroyRTMonoPitchProcessorParameter.argtypes = [pRvRTMonoPitchProcessorParameter]
 rvDestroyRTMonoPitchProcessorParameter.restype = None
 
+rvRTMonoPitchProcessorRequiredSize = dll.rvRTMonoPitchProcessorRequiredSize
+rvRTMonoPitchProcessorRequiredSize.argtypes = [pRvRTMonoPitchProcessorParameter]
+rvRTMonoPitchProcessorRequiredSize.restype = ctypes.c_size_t
+
+rvInitRTMonoPitchProcessorInPlace = dll.rvInitRTMonoPitchProcessorInPlace
+rvInitRTMonoPitchProcessorInPlace.argtypes = [ctypes.c_void_p, pRvRTMonoPitchProcessorParameter]
+rvInitRTMonoPitchProcessorInPlace.restype = pRvRTMonoPitchProcessor
+
+rvPrebuildRTMonoPitchModel = dll.rvPrebuildRTMonoPitchModel
+rvPrebuildRTMonoPitchModel.argtypes = [pRvRTMonoPitchProcessorParameter]
+rvPrebuildRTMonoPitchModel.restype = None
+
+rvReleaseRTMonoPitchModelCache = dll.rvReleaseRTMonoPitchModelCache
+rvReleaseRTMonoPitchModelCache.argtypes = []
+rvReleaseRTMonoPitchModelCache.restype = None
+
 rvCreateRTMonoPitchProcessor = dll.rvCreateRTMonoPitchProcessor
 rvCreateRTMonoPitchProcessor.argtypes = [pRvRTMonoPitchProcessorParameter]
 rvCreateRTMonoPitchProcessor.restype = pRvRTMonoPitchProcessor
@@ -47,10 +71,50 @@ rvCallRTMonoPitch = dll.rvCallRTMonoPitch
 rvCallRTMonoPitch.argtypes = [pRvRTMonoPitchProcessor, RvReal_1d, RvReal_2d, ctypes.c_int, RvReal_1d]
 rvCallRTMonoPitch.restype = ctypes.c_int
 
+rvCallRTMonoPitchDelta = dll.rvCallRTMonoPitchDelta
+rvCallRTMonoPitchDelta.argtypes = [pRvRTMonoPitchProcessor, RvReal_1d, RvReal_2d, ctypes.c_int, int_1d, RvReal_1d]
+rvCallRTMonoPitchDelta.restype = ctypes.c_int
+
+rvMonoPitchMaxDeltaOutputLength = dll.rvMonoPitchMaxDeltaOutputLength
+rvMonoPitchMaxDeltaOutputLength.argtypes = [pRvRTMonoPitchProcessor]
+rvMonoPitchMaxDeltaOutputLength.restype = ctypes.c_int
+
+rvMonoPitchModel = dll.rvMonoPitchModel
+rvMonoPitchModel.argtypes = [pRvRTMonoPitchProcessor]
+rvMonoPitchModel.restype = ctypes.c_void_p
+
+rvMonoPitchDumpObsTemp = dll.rvMonoPitchDumpObsTemp
+rvMonoPitchDumpObsTemp.argtypes = [pRvRTMonoPitchProcessor, RvReal_1d]
+rvMonoPitchDumpObsTemp.restype = None
+
 rvMonoPitchNextOutputLength = dll.rvMonoPitchNextOutputLength
 rvMonoPitchNextOutputLength.argtypes = [pRvRTMonoPitchProcessor]
 rvMonoPitchNextOutputLength.restype = ctypes.c_int
 
+rvMonoPitchActiveStateCount = dll.rvMonoPitchActiveStateCount
+rvMonoPitchActiveStateCount.argtypes = [pRvRTMonoPitchProcessor]
+rvMonoPitchActiveStateCount.restype = ctypes.c_int
+
+rvResetRTMonoPitchProcessor = dll.rvResetRTMonoPitchProcessor
+rvResetRTMonoPitchProcessor.argtypes = [pRvRTMonoPitchProcessor]
+rvResetRTMonoPitchProcessor.restype = None
+
+rvCreateRTMonoPitchProcessorPool = dll.rvCreateRTMonoPitchProcessorPool
+rvCreateRTMonoPitchProcessorPool.argtypes = [pRvRTMonoPitchProcessorParameter, ctypes.c_int]
+rvCreateRTMonoPitchProcessorPool.restype = pRvRTMonoPitchProcessorPool
+
+rvRTMonoPitchProcessorPoolAcquire = dll.rvRTMonoPitchProcessorPoolAcquire
+rvRTMonoPitchProcessorPoolAcquire.argtypes = [pRvRTMonoPitchProcessorPool]
+rvRTMonoPitchProcessorPoolAcquire.restype = pRvRTMonoPitchProcessor
+
+rvRTMonoPitchProcessorPoolRelease = dll.rvRTMonoPitchProcessorPoolRelease
+rvRTMonoPitchProcessorPoolRelease.argtypes = [pRvRTMonoPitchProcessorPool, pRvRTMonoPitchProcessor]
+rvRTMonoPitchProcessorPoolRelease.restype = None
+
+rvDestroyRTMonoPitchProcessorPool = dll.rvDestroyRTMonoPitchProcessorPool
+rvDestroyRTMonoPitchProcessorPool.argtypes = [pRvRTMonoPitchProcessorPool]
+rvDestroyRTMonoPitchProcessorPool.restype = None
+
 rvDestroyRTMonoPitchProcessor = dll.rvDestroyRTMonoPitchProcessor
 rvDestroyRTMonoPitchProcessor.argtypes = [pRvRTMonoPitchProcessor]
 rvDestroyRTMonoPitchProcessor.restype = None
@@ -63,9 +127,27 @@ def parameterFromPYin(pyin):
     minFreq = pyin.minFreq
     return hopSize, samprate, nSemitone, maxTransSemitone, minFreq
 
+def createParameter(hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs):
+    # caller destroys it with rvDestroyRTMonoPitchProcessorParameter
+    param = rvCreateRTMonoPitchProcessorParameter(hopSize, samprate, nSemitone, maxTransSemitone, minFreq)
+    for key in ("binPerSemitone", "transSelf", "yinTrust", "energyThreshold", "viterbiBeam", "energyHysteresis", "maxObsLength", "maxCandidate"):
+        if(key in kwargs):
+            setattr(param.contents, key, kwargs[key])
+    return param
+
+def prebuildModel(hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs):
+    # keeps the model of these parameters alive until releaseModelCache
+    param = createParameter(hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs)
+    rvPrebuildRTMonoPitchModel(param)
+    rvDestroyRTMonoPitchProcessorParameter(param)
+
+def releaseModelCache():
+    rvReleaseRTMonoPitchModelCache()
+
 class Processor:
     def __init__(self, hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs):
         self.maxObsLength = kwargs.get("maxObsLength", 128)
+        self.maxCandidate = kwargs.get("maxCandidate", 128)
 
         self.hopSize = int(hopSize)
         self.samprate = samprate
@@ -76,19 +158,42 @@ class Processor:
         self.transSelf = kwargs.get("transSelf", 0.999)
         self.yinTrust = kwargs.get("yinTrust", 0.5)
         self.energyThreshold = kwargs.get("energyThreshold", 1e-8)
+        self.viterbiBeam = kwargs.get("viterbiBeam", 0.0)
+        self.energyHysteresis = kwargs.get("energyHysteresis", 1.0)
         
-        param = rvCreateRTMonoPitchProcessorParameter(hopSize, samprate, nSemitone, maxTransSemitone, minFreq)
-        param.contents.binPerSemitone = self.binPerSemitone
-        param.contents.transSelf = self.transSelf
-        param.contents.yinTrust = self.yinTrust
-        param.contents.energyThreshold = self.energyThreshold
-        param.contents.maxObsLength = self.maxObsLength
-        self.proc = rvCreateRTMonoPitchProcessor(param)
+        param = createParameter(hopSize, samprate, nSemitone, maxTransSemitone, minFreq,
+            binPerSemitone = self.binPerSemitone, transSelf = self.transSelf, yinTrust = self.yinTrust,
+            energyThreshold = self.energyThreshold, viterbiBeam = self.viterbiBeam, energyHysteresis = self.energyHysteresis,
+            maxObsLength = self.maxObsLength, maxCandidate = self.maxCandidate)
+        if(kwargs.get("inPlace", False)):
+            self.mem = inPlaceBuffer(rvRTMonoPitchProcessorRequiredSize(param))
+            self.proc = rvInitRTMonoPitchProcessorInPlace(self.mem.ctypes.data, param)
+        else:
+            self.proc = rvCreateRTMonoPitchProcessor(param)
         rvDestroyRTMonoPitchProcessorParameter(param)
     
     def __del__(self):
         rvDestroyRTMonoPitchProcessor(self.proc)
 
+    def reset(self):
+        rvResetRTMonoPitchProcessor(self.proc)
+
+    @property
+    def activeStateCount(self):
+        return rvMonoPitchActiveStateCount(self.proc)
+
+    @property
+    def model(self):
+        # address of the shared model, equal for processors that share it
+        return rvMonoPitchModel(self.proc)
+
+    @property
+    def obsTemp(self):
+        # state observation probabilities of the last hop
+        o = np.zeros(2 * self.nSemitone * self.binPerSemitone, dtype = np.float64)
+        rvMonoPitchDumpObsTemp(self.proc, o)
+        return o
+
     def __call__(self, x, obsProb):
         if(len(x) != self.hopSize * 2):
             raise ValueError("length of x must be hopSize * 2")
@@ -107,4 +212,41 @@ class Processor:
             realN = rvCallRTMonoPitch(self.proc, x, obsProb, obsProb.shape[0], o)'''
         assert n == realN
         
-        return o
\ No newline at end of file
+        return o
+
+    def delta(self, x, obsProb):
+        if(len(x) != self.hopSize * 2):
+            raise ValueError("length of x must be hopSize * 2")
+        if(obsProb.ndim != 2 or obsProb.shape[1] != 2):
+            raise ValueError("invalid obsProb")
+        n = rvMonoPitchMaxDeltaOutputLength(self.proc)
+        iFrame = np.zeros(n, dtype = np.int32)
+        value = np.zeros(n, dtype = np.float64)
+        realN = rvCallRTMonoPitchDelta(self.proc, x, obsProb, obsProb.shape[0], iFrame, value)
+
+        return iFrame[:realN], value[:realN]
+
+class PooledProcessor(Processor):
+    # borrowed from a ProcessorPool, goes back to it when deleted
+    def __del__(self):
+        rvRTMonoPitchProcessorPoolRelease(self.pool.pool, self.proc)
+
+class ProcessorPool:
+    def __init__(self, nProcessor, hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs):
+        # processors of the pool share the parameter and the model of this one
+        self.template = Processor(hopSize, samprate, nSemitone, maxTransSemitone, minFreq, **kwargs)
+        self.pool = rvCreateRTMonoPitchProcessorPool(rvRTMonoPitchParam(self.template.proc), nProcessor)
+
+    def __del__(self):
+        rvDestroyRTMonoPitchProcessorPool(self.pool)
+
+    def acquire(self):
+        # None when every processor is in use
+        proc = rvRTMonoPitchProcessorPoolAcquire(self.pool)
+        if(not proc):
+            return None
+        out = PooledProcessor.__new__(PooledProcessor)
+        out.__dict__.update(self.template.__dict__)
+        out.proc = proc
+        out.pool = self
+        return out
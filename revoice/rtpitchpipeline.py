@@ -0,0 +1,72 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+from . import rtpitchtracker, rtpyin, rtmonopitch
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+int_1d = npct.ndpointer(dtype = np.int32, ndim = 1, flags = "C")
+
+class RvRTPitchPipeline(ctypes.Structure):
+    pass
+
+pRvRTPitchPipeline = ctypes.POINTER(RvRTPitchPipeline)
+
+rvCreateRTPitchPipeline = dll.rvCreateRTPitchPipeline
+rvCreateRTPitchPipeline.argtypes = [rtpyin.pRvRTPYinProcessorParameter, rtmonopitch.pRvRTMonoPitchProcessorParameter, ctypes.c_int]
+rvCreateRTPitchPipeline.restype = pRvRTPitchPipeline
+
+rvRTPitchPipelineHopSize = dll.rvRTPitchPipelineHopSize
+rvRTPitchPipelineHopSize.argtypes = [pRvRTPitchPipeline]
+rvRTPitchPipelineHopSize.restype = ctypes.c_int
+
+rvRTPitchPipelineMaxOutputLength = dll.rvRTPitchPipelineMaxOutputLength
+rvRTPitchPipelineMaxOutputLength.argtypes = [pRvRTPitchPipeline]
+rvRTPitchPipelineMaxOutputLength.restype = ctypes.c_int
+
+rvRTPitchPipelinePush = dll.rvRTPitchPipelinePush
+rvRTPitchPipelinePush.argtypes = [pRvRTPitchPipeline, ctypes.POINTER(RvReal), ctypes.c_int]
+rvRTPitchPipelinePush.restype = ctypes.c_bool
+
+rvRTPitchPipelinePop = dll.rvRTPitchPipelinePop
+rvRTPitchPipelinePop.argtypes = [pRvRTPitchPipeline, int_1d, RvReal_1d, ctypes.POINTER(ctypes.c_int)]
+rvRTPitchPipelinePop.restype = ctypes.c_bool
+
+rvDestroyRTPitchPipeline = dll.rvDestroyRTPitchPipeline
+rvDestroyRTPitchPipeline.argtypes = [pRvRTPitchPipeline]
+rvDestroyRTPitchPipeline.restype = None
+
+class Processor:
+    def __init__(self, sr, nQueueBlock = 8, **kwargs):
+        pyinProc, pyinParam, monoParam = rtpitchtracker.createParameter(sr, **kwargs)
+        self.samprate = pyinProc.samprate
+        self.proc = rvCreateRTPitchPipeline(pyinParam, monoParam, nQueueBlock)
+        rtmonopitch.rvDestroyRTMonoPitchProcessorParameter(monoParam)
+        del pyinProc
+
+        self.hopSize = rvRTPitchPipelineHopSize(self.proc)
+        self.maxOut = rvRTPitchPipelineMaxOutputLength(self.proc)
+        self.iFrameTemp = np.zeros(self.maxOut, dtype = np.int32)
+        self.f0Temp = np.zeros(self.maxOut, dtype = np.float64)
+
+    def __del__(self):
+        rvDestroyRTPitchPipeline(self.proc)
+
+    def push(self, x):
+        # returns False while the input queue is full, None ends the stream
+        if(x is None):
+            return rvRTPitchPipelinePush(self.proc, None, 0)
+        x = np.ascontiguousarray(x, dtype = np.float64)
+        if(len(x) == 0 or len(x) > self.hopSize):
+            raise ValueError("length of x must be in range [1, hopSize]")
+        return rvRTPitchPipelinePush(self.proc, x.ctypes.data_as(ctypes.POINTER(RvReal)), len(x))
+
+    def pop(self):
+        # returns False when nothing is ready, None once the stream has ended, otherwise (frameIndex, f0)
+        nOut = ctypes.c_int()
+        if(not rvRTPitchPipelinePop(self.proc, self.iFrameTemp, self.f0Temp, ctypes.byref(nOut))):
+            return False
+        if(nOut.value == -1):
+            return None
+        return self.iFrameTemp[:nOut.value].copy(), self.f0Temp[:nOut.value].copy()
@@ -0,0 +1,143 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+from . import rtpyin, rtmonopitch, threadpool
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+int_1d = npct.ndpointer(dtype = np.int32, ndim = 1, flags = "C")
+
+class RvRTPitchTracker(ctypes.Structure):
+    pass
+
+class RvRTPitchTrackerBank(ctypes.Structure):
+    pass
+
+pRvRTPitchTracker = ctypes.POINTER(RvRTPitchTracker)
+pRvRTPitchTrackerBank = ctypes.POINTER(RvRTPitchTrackerBank)
+
+rvCreateRTPitchTracker = dll.rvCreateRTPitchTracker
+rvCreateRTPitchTracker.argtypes = [rtpyin.pRvRTPYinProcessorParameter, rtmonopitch.pRvRTMonoPitchProcessorParameter]
+rvCreateRTPitchTracker.restype = pRvRTPitchTracker
+
+rvRTPitchTrackerMaxOutputLength = dll.rvRTPitchTrackerMaxOutputLength
+rvRTPitchTrackerMaxOutputLength.argtypes = [pRvRTPitchTracker]
+rvRTPitchTrackerMaxOutputLength.restype = ctypes.c_int
+
+rvCallRTPitchTracker = dll.rvCallRTPitchTracker
+rvCallRTPitchTracker.argtypes = [pRvRTPitchTracker, ctypes.POINTER(RvReal), ctypes.c_int, int_1d, RvReal_1d]
+rvCallRTPitchTracker.restype = ctypes.c_int
+
+rvResetRTPitchTracker = dll.rvResetRTPitchTracker
+rvResetRTPitchTracker.argtypes = [pRvRTPitchTracker]
+rvResetRTPitchTracker.restype = None
+
+rvDestroyRTPitchTracker = dll.rvDestroyRTPitchTracker
+rvDestroyRTPitchTracker.argtypes = [pRvRTPitchTracker]
+rvDestroyRTPitchTracker.restype = None
+
+rvCreateRTPitchTrackerBank = dll.rvCreateRTPitchTrackerBank
+rvCreateRTPitchTrackerBank.argtypes = [ctypes.c_int, rtpyin.pRvRTPYinProcessorParameter, rtmonopitch.pRvRTMonoPitchProcessorParameter, threadpool.pRvThreadPool]
+rvCreateRTPitchTrackerBank.restype = pRvRTPitchTrackerBank
+
+rvRTPitchTrackerBankMaxOutputLength = dll.rvRTPitchTrackerBankMaxOutputLength
+rvRTPitchTrackerBankMaxOutputLength.argtypes = [pRvRTPitchTrackerBank]
+rvRTPitchTrackerBankMaxOutputLength.restype = ctypes.c_int
+
+rvCallRTPitchTrackerBank = dll.rvCallRTPitchTrackerBank
+rvCallRTPitchTrackerBank.argtypes = [pRvRTPitchTrackerBank, ctypes.POINTER(RvReal), ctypes.c_int, int_1d, RvReal_1d, int_1d]
+rvCallRTPitchTrackerBank.restype = ctypes.c_int
+
+rvResetRTPitchTrackerBank = dll.rvResetRTPitchTrackerBank
+rvResetRTPitchTrackerBank.argtypes = [pRvRTPitchTrackerBank]
+rvResetRTPitchTrackerBank.restype = None
+
+rvDestroyRTPitchTrackerBank = dll.rvDestroyRTPitchTrackerBank
+rvDestroyRTPitchTrackerBank.argtypes = [pRvRTPitchTrackerBank]
+rvDestroyRTPitchTrackerBank.restype = None
+
+def createParameter(sr, **kwargs):
+    pyinProc = rtpyin.Processor(sr, **kwargs)
+    pyinParam = rtpyin.rvRTPYinParam(pyinProc.proc)
+    monoParam = rtmonopitch.rvCreateRTMonoPitchProcessorParameterFromRTPYin(pyinParam)
+    for key in ("binPerSemitone", "transSelf", "yinTrust", "energyThreshold", "energyHysteresis", "viterbiBeam", "maxObsLength", "maxCandidate"):
+        if(key in kwargs):
+            setattr(monoParam.contents, key, kwargs[key])
+    return pyinProc, pyinParam, monoParam
+
+class Processor:
+    def __init__(self, sr, **kwargs):
+        pyinProc, pyinParam, monoParam = createParameter(sr, **kwargs)
+        self.samprate = pyinProc.samprate
+        self.hopSize = pyinProc.hopSize
+
+        self.proc = rvCreateRTPitchTracker(pyinParam, monoParam)
+        rtmonopitch.rvDestroyRTMonoPitchProcessorParameter(monoParam)
+        del pyinProc
+
+        self.maxOut = rvRTPitchTrackerMaxOutputLength(self.proc)
+        self.iFrameTemp = np.zeros(self.maxOut, dtype = np.int32)
+        self.f0Temp = np.zeros(self.maxOut, dtype = np.float64)
+
+    def __del__(self):
+        rvDestroyRTPitchTracker(self.proc)
+
+    def reset(self):
+        rvResetRTPitchTracker(self.proc)
+
+    def __call__(self, x):
+        if(x is None):
+            nOut = rvCallRTPitchTracker(self.proc, None, 0, self.iFrameTemp, self.f0Temp)
+        else:
+            x = np.ascontiguousarray(x, dtype = np.float64)
+            if(len(x) > self.hopSize):
+                raise ValueError("length of x must not exceed hopSize")
+            nOut = rvCallRTPitchTracker(self.proc, x.ctypes.data_as(ctypes.POINTER(RvReal)), len(x), self.iFrameTemp, self.f0Temp)
+
+        if(nOut == -1):
+            return None
+        return self.iFrameTemp[:nOut].copy(), self.f0Temp[:nOut].copy()
+
+class Bank:
+    def __init__(self, nChannel, sr, pool = None, **kwargs):
+        # pool is a threadpool.Pool the channels are spread over, None runs them on the calling thread
+        pyinProc, pyinParam, monoParam = createParameter(sr, **kwargs)
+        self.samprate = pyinProc.samprate
+        self.hopSize = pyinProc.hopSize
+        self.nChannel = nChannel
+        self.pool = pool
+        self.proc = rvCreateRTPitchTrackerBank(nChannel, pyinParam, monoParam, pool.proc if pool is not None else None)
+        rtmonopitch.rvDestroyRTMonoPitchProcessorParameter(monoParam)
+        del pyinProc
+
+        self.maxOut = rvRTPitchTrackerBankMaxOutputLength(self.proc)
+        self.iFrameTemp = np.zeros(nChannel * self.maxOut, dtype = np.int32)
+        self.f0Temp = np.zeros(nChannel * self.maxOut, dtype = np.float64)
+        self.nOutTemp = np.zeros(nChannel, dtype = np.int32)
+
+    def __del__(self):
+        rvDestroyRTPitchTrackerBank(self.proc)
+
+    def reset(self):
+        rvResetRTPitchTrackerBank(self.proc)
+
+    def __call__(self, x):
+        # x is (nSample, nChannel), returns one (frameIndex, f0) pair per channel
+        if(x is None):
+            nTotal = rvCallRTPitchTrackerBank(self.proc, None, 0, self.iFrameTemp, self.f0Temp, self.nOutTemp)
+        else:
+            x = np.ascontiguousarray(x, dtype = np.float64)
+            if(x.ndim != 2 or x.shape[1] != self.nChannel):
+                raise ValueError("x must be of shape (nSample, nChannel)")
+            if(x.shape[0] > self.hopSize):
+                raise ValueError("length of x must not exceed hopSize")
+            nTotal = rvCallRTPitchTrackerBank(self.proc, x.ctypes.data_as(ctypes.POINTER(RvReal)), x.shape[0], self.iFrameTemp, self.f0Temp, self.nOutTemp)
+
+        if(nTotal == -1):
+            return None
+        outList = []
+        for iChannel, nOut in enumerate(self.nOutTemp):
+            iOut = iChannel * self.maxOut
+            outList.append((self.iFrameTemp[iOut:iOut + nOut].copy(), self.f0Temp[iOut:iOut + nOut].copy()))
+        return outList
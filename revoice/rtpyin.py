@@ -17,16 +17,22 @@ class RvRTPYinProcessorParameter(ctypes.Structure):
         ("valleyThreshold", RvReal), ("valleyStep", RvReal),
         ("probThreshold", RvReal), ("weightPrior", RvReal),
         ("bias", RvReal),
+        ("gateThreshold", RvReal), ("gateHysteresis", RvReal),
         ("hopSize", ctypes.c_int), ("maxWindowSize", ctypes.c_int),
         ("maxIter", ctypes.c_int), ("pdfSize", ctypes.c_int),
+        ("gateHangover", ctypes.c_int),
         ("prefilter", ctypes.c_bool), ("isPdfDefault", ctypes.c_bool),
     ]
 
 class RvRTPYinProcessor(ctypes.Structure):
     pass
 
+class RvRTPYinProcessorPool(ctypes.Structure):
+    pass
+
 pRvRTPYinProcessorParameter = ctypes.POINTER(RvRTPYinProcessorParameter)
 pRvRTPYinProcessor = ctypes.POINTER(RvRTPYinProcessor)
+pRvRTPYinProcessorPool = ctypes.POINTER(RvRTPYinProcessorPool)
 
 rvCreateRTPYinProcessorParameter = dll.rvCreateRTPYinProcessorParameter
 rvCreateRTPYinProcessorParameter.argtypes = [RvReal, RvReal, RvReal, RvReal_1d, ctypes.c_int]
@@ -36,6 +42,10 @@ rvDestroyRTPYinProcessorParameter = dll.rvDestroyRTPYinProcessorParameter
 rvDestroyRTPYinProcessorParameter.argtypes = [pRvRTPYinProcessorParameter]
 rvDestroyRTPYinProcessorParameter.restype = None
 
+rvRTPYinSkippedFrames = dll.rvRTPYinSkippedFrames
+rvRTPYinSkippedFrames.argtypes = [pRvRTPYinProcessor]
+rvRTPYinSkippedFrames.restype = ctypes.c_int
+
 rvRTPYinBufferUsed = dll.rvRTPYinBufferUsed
 rvRTPYinBufferUsed.argtypes = [pRvRTPYinProcessor]
 rvRTPYinBufferUsed.restype = ctypes.c_int
@@ -48,6 +58,14 @@ rvCreateRTPYinProcessor = dll.rvCreateRTPYinProcessor
 rvCreateRTPYinProcessor.argtypes = [pRvRTPYinProcessorParameter]
 rvCreateRTPYinProcessor.restype = pRvRTPYinProcessor
 
+rvRTPYinProcessorRequiredSize = dll.rvRTPYinProcessorRequiredSize
+rvRTPYinProcessorRequiredSize.argtypes = [pRvRTPYinProcessorParameter]
+rvRTPYinProcessorRequiredSize.restype = ctypes.c_size_t
+
+rvInitRTPYinProcessorInPlace = dll.rvInitRTPYinProcessorInPlace
+rvInitRTPYinProcessorInPlace.argtypes = [ctypes.c_void_p, pRvRTPYinProcessorParameter]
+rvInitRTPYinProcessorInPlace.restype = pRvRTPYinProcessor
+
 rvRTPYinParam = dll.rvRTPYinParam
 rvRTPYinParam.argtypes = [pRvRTPYinProcessor]
 rvRTPYinParam.restype = pRvRTPYinProcessorParameter
@@ -60,6 +78,26 @@ rvCallRTPYin = dll.rvCallRTPYin
 rvCallRTPYin.argtypes = [pRvRTPYinProcessor, RvReal_1d, ctypes.c_int, RvReal_2d, ctypes.c_int]
 rvCallRTPYin.restype = ctypes.c_int
 
+rvResetRTPYinProcessor = dll.rvResetRTPYinProcessor
+rvResetRTPYinProcessor.argtypes = [pRvRTPYinProcessor]
+rvResetRTPYinProcessor.restype = None
+
+rvCreateRTPYinProcessorPool = dll.rvCreateRTPYinProcessorPool
+rvCreateRTPYinProcessorPool.argtypes = [pRvRTPYinProcessorParameter, ctypes.c_int]
+rvCreateRTPYinProcessorPool.restype = pRvRTPYinProcessorPool
+
+rvRTPYinProcessorPoolAcquire = dll.rvRTPYinProcessorPoolAcquire
+rvRTPYinProcessorPoolAcquire.argtypes = [pRvRTPYinProcessorPool]
+rvRTPYinProcessorPoolAcquire.restype = pRvRTPYinProcessor
+
+rvRTPYinProcessorPoolRelease = dll.rvRTPYinProcessorPoolRelease
+rvRTPYinProcessorPoolRelease.argtypes = [pRvRTPYinProcessorPool, pRvRTPYinProcessor]
+rvRTPYinProcessorPoolRelease.restype = None
+
+rvDestroyRTPYinProcessorPool = dll.rvDestroyRTPYinProcessorPool
+rvDestroyRTPYinProcessorPool.argtypes = [pRvRTPYinProcessorPool]
+rvDestroyRTPYinProcessorPool.restype = None
+
 rvDestroyRTPYinProcessor = dll.rvDestroyRTPYinProcessor
 rvDestroyRTPYinProcessor.argtypes = [pRvRTPYinProcessor]
 rvDestroyRTPYinProcessor.restype = None
@@ -85,6 +123,10 @@ class Processor:
         self.weightPrior = kwargs.get("weightPrior", 5.0)
         self.bias = kwargs.get("bias", 1.0)
 
+        self.gateThreshold = kwargs.get("gateThreshold", 0.0)
+        self.gateHysteresis = kwargs.get("gateHysteresis", 2.0)
+        self.gateHangover = kwargs.get("gateHangover", 4)
+
         self.pdf = kwargs.get("pdf", None)
 
         self.maxWindowSize = max(roundUpToPowerOf2(self.samprate / self.minFreq * 4), self.hopSize)
@@ -103,8 +145,15 @@ class Processor:
         param.contents.probThreshold = self.probThreshold
         param.contents.weightPrior = self.weightPrior
         param.contents.bias = self.bias
+        param.contents.gateThreshold = self.gateThreshold
+        param.contents.gateHysteresis = self.gateHysteresis
+        param.contents.gateHangover = self.gateHangover
         param.contents.maxWindowSize = self.maxWindowSize
-        self.proc = rvCreateRTPYinProcessor(param)
+        if(kwargs.get("inPlace", False)):
+            self.mem = inPlaceBuffer(rvRTPYinProcessorRequiredSize(param))
+            self.proc = rvInitRTPYinProcessorInPlace(self.mem.ctypes.data, param)
+        else:
+            self.proc = rvCreateRTPYinProcessor(param)
         rvDestroyRTPYinProcessorParameter(param)
 
         if(self.proc is None):
@@ -113,10 +162,17 @@ class Processor:
     def __del__(self):
         rvDestroyRTPYinProcessor(self.proc)
 
+    def reset(self):
+        rvResetRTPYinProcessor(self.proc)
+
     @property
     def delayed(self):
         return rvRTPYinDelay(rvRTPYinParam(self.proc))
 
+    @property
+    def skippedFrames(self):
+        return rvRTPYinSkippedFrames(self.proc)
+
     @property
     def buffer(self):
         n = rvRTPYinBufferUsed(self.proc)
@@ -137,4 +193,29 @@ class Processor:
         
         if(nOut == -1):
             return None
-        return freqProb[:nOut].copy()
\ No newline at end of file
+        return freqProb[:nOut].copy()
+
+class PooledProcessor(Processor):
+    # borrowed from a ProcessorPool, goes back to it when deleted
+    def __del__(self):
+        rvRTPYinProcessorPoolRelease(self.pool.pool, self.proc)
+
+class ProcessorPool:
+    def __init__(self, sr, nProcessor, **kwargs):
+        # processors of the pool share the parameter of this one
+        self.template = Processor(sr, **kwargs)
+        self.pool = rvCreateRTPYinProcessorPool(rvRTPYinParam(self.template.proc), nProcessor)
+
+    def __del__(self):
+        rvDestroyRTPYinProcessorPool(self.pool)
+
+    def acquire(self):
+        # None when every processor is in use
+        proc = rvRTPYinProcessorPoolAcquire(self.pool)
+        if(not proc):
+            return None
+        out = PooledProcessor.__new__(PooledProcessor)
+        out.__dict__.update(self.template.__dict__)
+        out.proc = proc
+        out.pool = self
+        return out
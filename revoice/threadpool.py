@@ -0,0 +1,73 @@
+import ctypes
+import numpy as np
+
+dll = ctypes.CDLL("librevoice.dll")
+
+class RvThreadPool(ctypes.Structure):
+    pass
+
+pRvThreadPool = ctypes.POINTER(RvThreadPool)
+
+RvRangeFunc = ctypes.CFUNCTYPE(None, ctypes.c_int, ctypes.c_int, ctypes.c_void_p)
+RvRunFunc = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+RvExecutorFunc = ctypes.CFUNCTYPE(None, RvRunFunc, ctypes.c_void_p, ctypes.c_void_p)
+
+rvCreateThreadPool = dll.rvCreateThreadPool
+rvCreateThreadPool.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+rvCreateThreadPool.restype = pRvThreadPool
+
+rvCreateThreadPoolWithExecutor = dll.rvCreateThreadPoolWithExecutor
+rvCreateThreadPoolWithExecutor.argtypes = [RvExecutorFunc, ctypes.c_int, ctypes.c_void_p]
+rvCreateThreadPoolWithExecutor.restype = pRvThreadPool
+
+rvThreadPoolSize = dll.rvThreadPoolSize
+rvThreadPoolSize.argtypes = [pRvThreadPool]
+rvThreadPoolSize.restype = ctypes.c_int
+
+rvThreadPoolParallelFor = dll.rvThreadPoolParallelFor
+rvThreadPoolParallelFor.argtypes = [pRvThreadPool, ctypes.c_int, ctypes.c_int, RvRangeFunc, ctypes.c_void_p]
+rvThreadPoolParallelFor.restype = None
+
+rvDestroyThreadPool = dll.rvDestroyThreadPool
+rvDestroyThreadPool.argtypes = [pRvThreadPool]
+rvDestroyThreadPool.restype = None
+
+rvSetSharedThreadPool = dll.rvSetSharedThreadPool
+rvSetSharedThreadPool.argtypes = [pRvThreadPool]
+rvSetSharedThreadPool.restype = None
+
+rvSharedThreadPool = dll.rvSharedThreadPool
+rvSharedThreadPool.argtypes = []
+rvSharedThreadPool.restype = pRvThreadPool
+
+class Pool:
+    def __init__(self, nThread = -1, cpuList = None, executor = None):
+        # executor(run) must call run() exactly once on some thread, nThread is then the number of concurrent runs
+        self.executor = None
+        if(executor is not None):
+            self.executor = RvExecutorFunc(lambda run, arg, userData: executor(lambda: run(arg)))
+            self.proc = rvCreateThreadPoolWithExecutor(self.executor, nThread, None)
+        elif(cpuList is not None):
+            if(len(cpuList) != nThread):
+                raise ValueError("length of cpuList must be nThread")
+            self.proc = rvCreateThreadPool(nThread, (ctypes.c_int * nThread)(*cpuList))
+        else:
+            self.proc = rvCreateThreadPool(nThread, None)
+
+    def __del__(self):
+        rvDestroyThreadPool(self.proc)
+
+    @property
+    def size(self):
+        return rvThreadPoolSize(self.proc)
+
+    def parallelFor(self, n, grainSize, func):
+        # func(iBegin, iEnd) may run on any thread of the pool
+        rvThreadPoolParallelFor(self.proc, n, grainSize, RvRangeFunc(lambda iBegin, iEnd, userData: func(iBegin, iEnd)), None)
+
+_sharedPool = None
+def setSharedPool(pool):
+    # None restores the built-in pool
+    global _sharedPool
+    rvSetSharedThreadPool(pool.proc if pool is not None else None)
+    _sharedPool = pool
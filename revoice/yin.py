@@ -0,0 +1,53 @@
+import ctypes
+import numpy as np
+import numpy.ctypeslib as npct
+
+from .common import *
+
+dll = ctypes.CDLL("librevoice.dll")
+RvReal = ctypes.c_double
+RvReal_1d = npct.ndpointer(dtype = np.float64, ndim = 1, flags = "C")
+
+class RvYinProcessorParameter(ctypes.Structure):
+    _fields_ = [
+        ("samprate", RvReal),
+        ("minFreq", RvReal), ("maxFreq", RvReal),
+        ("valleyThreshold", RvReal), ("valleyStep", RvReal),
+        ("hopSize", ctypes.c_int), ("windowSize", ctypes.c_int),
+        ("prefilter", ctypes.c_bool),
+    ]
+
+pRvYinProcessorParameter = ctypes.POINTER(RvYinProcessorParameter)
+
+rvCreateYinProcessorParameter = dll.rvCreateYinProcessorParameter
+rvCreateYinProcessorParameter.argtypes = [RvReal, RvReal, RvReal]
+rvCreateYinProcessorParameter.restype = pRvYinProcessorParameter
+
+rvDestroyYinProcessorParameter = dll.rvDestroyYinProcessorParameter
+rvDestroyYinProcessorParameter.argtypes = [pRvYinProcessorParameter]
+rvDestroyYinProcessorParameter.restype = None
+
+rvCallYin = dll.rvCallYin
+rvCallYin.argtypes = [pRvYinProcessorParameter, RvReal_1d, ctypes.c_int, ctypes.c_bool, RvReal_1d]
+rvCallYin.restype = None
+
+class Processor:
+    def __init__(self, sr, **kwargs):
+        self.samprate = float(sr)
+        self.minFreq = kwargs.get("minFreq", 80.0)
+        self.maxFreq = kwargs.get("maxFreq", 1000.0)
+        self.param = rvCreateYinProcessorParameter(self.minFreq, self.maxFreq, self.samprate)
+        for key in ("hopSize", "windowSize", "prefilter", "valleyThreshold", "valleyStep"):
+            if(key in kwargs):
+                setattr(self.param.contents, key, kwargs[key])
+        self.hopSize = self.param.contents.hopSize
+        self.windowSize = self.param.contents.windowSize
+
+    def __del__(self):
+        rvDestroyYinProcessorParameter(self.param)
+
+    def __call__(self, x, removeDC = True):
+        x = np.ascontiguousarray(x, dtype = np.float64)
+        out = np.zeros(getNFrame(len(x), self.hopSize), dtype = np.float64)
+        rvCallYin(self.param, x, len(x), removeDC, out)
+        return out
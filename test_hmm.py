@@ -0,0 +1,126 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import pyrevoice as p
+import gc
+
+monopitchProc = p.monopitch.Processor(256, 44100.0, 36, 3.0, 80.0)
+pyModel = monopitchProc.model
+nState = len(pyModel.init)
+
+cModel = hmm.SparseHMM(pyModel.init, pyModel.frm, pyModel.to, pyModel.transProb)
+print("Backpointer size: %d byte(s)" % cModel.backpointerSize)
+
+for nFrame in (1, 2, 3, 17, 128, 1000):
+    obsSeq = np.random.uniform(0.0, 1.0, (nFrame, nState)) ** 3 + 1e-5
+    pyPath = pyModel.viterbiDecode(obsSeq)
+    if(nFrame == 1):
+        pyPath = np.array([np.argmax(pyModel.init * obsSeq[0])])
+    cPath = cModel.viterbiDecode(obsSeq)
+    if((pyPath != cPath).any()):
+        print("Path mismatch @ nFrame = %d" % nFrame)
+        exit(1)
+    print("Test passed @ nFrame = %d" % nFrame)
+
+def referencePosterior(model, obsSeq):
+    # scaled forward-backward over the sparse transitions
+    nFrame = len(obsSeq)
+    alphaList = np.zeros(obsSeq.shape)
+    betaList = np.zeros(obsSeq.shape)
+    alpha = model.init * obsSeq[0]
+    logLikelihood = np.log(np.sum(alpha))
+    alphaList[0] = alpha / np.sum(alpha)
+    for iFrame in range(1, nFrame):
+        alpha = np.bincount(model.to, alphaList[iFrame - 1][model.frm] * model.transProb, minlength = nState) * obsSeq[iFrame]
+        logLikelihood += np.log(np.sum(alpha))
+        alphaList[iFrame] = alpha / np.sum(alpha)
+    betaList[-1] = 1.0
+    for iFrame in reversed(range(nFrame - 1)):
+        beta = np.bincount(model.frm, (betaList[iFrame + 1] * obsSeq[iFrame + 1])[model.to] * model.transProb, minlength = nState)
+        betaList[iFrame] = beta / np.sum(beta)
+    gamma = alphaList * betaList
+    return gamma / np.sum(gamma, axis = 1, keepdims = True), logLikelihood
+
+print("Posterior...")
+for nFrame in (1, 2, 17, 200):
+    obsSeq = np.random.uniform(0.0, 1.0, (nFrame, nState)) ** 3 + 1e-5
+    gamma, logLikelihood = cModel.posterior(obsSeq)
+    gamma_r, logLikelihood_r = referencePosterior(pyModel, obsSeq)
+    if(not np.allclose(gamma, gamma_r, rtol = 1e-9, atol = 1e-12) or abs(logLikelihood - logLikelihood_r) > 1e-9 * abs(logLikelihood_r)):
+        print("Posterior mismatch @ nFrame = %d" % nFrame)
+        exit(1)
+
+print("Smoother...")
+# frame i is settled once frame i + lag is fed, so it matches the posterior of the sequence up to there
+nFrame = 60
+obsSeq = np.random.uniform(0.0, 1.0, (nFrame, nState)) ** 3 + 1e-5
+for lag in (0, 1, 8, nFrame):
+    smoother = hmm.RTSparseHMMSmoother(cModel, lag)
+    outList = [smoother(obs) for obs in obsSeq]
+    outList += [smoother(None) for i in range(min(lag, nFrame))]
+    outList = [out for out in outList if out is not None]
+    if(smoother(None) is not None or [out[0] for out in outList] != list(range(nFrame))):
+        print("Smoother frame order mismatch @ lag = %d" % lag)
+        exit(1)
+    for iFrame, gamma in outList:
+        gamma_r, _ = cModel.posterior(obsSeq[:min(iFrame + lag + 1, nFrame)])
+        if(not np.allclose(gamma, gamma_r[iFrame], rtol = 1e-9, atol = 1e-12)):
+            print("Smoother mismatch @ lag = %d, frame %d" % (lag, iFrame))
+            exit(1)
+    del smoother
+
+print("Beam...")
+nFrame = 300
+obsSeq = np.random.uniform(0.0, 1.0, (nFrame, nState)) ** 3 + 1e-5
+fullDecoder = hmm.RTSparseHMM(cModel, nFrame)
+infDecoder = hmm.RTSparseHMM(cModel, nFrame)
+infDecoder.setBeam(np.inf)
+tightDecoder = hmm.RTSparseHMM(cModel, nFrame)
+tightDecoder.setBeam(2.0)
+activeCountList = []
+for iFrame, obs in enumerate(obsSeq):
+    fullDecoder.feed(obs)
+    infDecoder.feed(obs)
+    tightDecoder.feed(obs)
+    activeCountList.append(tightDecoder.activeCount)
+    if(infDecoder.activeCount != nState or (infDecoder.viterbiDecode(nFrame) != fullDecoder.viterbiDecode(nFrame)).any()):
+        print("Infinite beam differs from the unpruned decoder @ frame %d" % iFrame)
+        exit(1)
+if((infDecoder.viterbiDecode(nFrame) != cModel.viterbiDecode(obsSeq)).any()):
+    print("Infinite beam differs from the offline decoder")
+    exit(1)
+if(max(activeCountList) >= nState or min(activeCountList) <= 0):
+    print("Tight beam keeps %d to %d of %d states" % (min(activeCountList), max(activeCountList), nState))
+    exit(1)
+tightDecoder.setBeam(0.0)
+if(tightDecoder.activeCount != nState):
+    print("Disabling the beam does not restore every state")
+    exit(1)
+del fullDecoder, infDecoder, tightDecoder
+
+print("Bank...")
+nStream, nMaxBackward = 5, 64
+bank = hmm.RTSparseHMMBank(cModel, nStream, nMaxBackward)
+decoderList = [hmm.RTSparseHMM(cModel, nMaxBackward) for iStream in range(nStream)]
+for iFrame in range(300):
+    obs = np.random.uniform(0.0, 1.0, (nStream, nState)) ** 3 + 1e-5
+    # a dead stream and a restarted one
+    if(iFrame == 100):
+        obs[1] = 0.0
+    if(iFrame == 150):
+        bank.resetStream(3)
+        decoderList[3].reset()
+    ok = bank.feed(obs)
+    for iStream, decoder in enumerate(decoderList):
+        if(ok[iStream] != decoder.feed(obs[iStream])):
+            print("Bank ok flag mismatch @ frame %d, stream %d" % (iFrame, iStream))
+            exit(1)
+        if(bank.currentAvailable(iStream) != decoder.currentAvailable or (bank.viterbiDecode(iStream, nMaxBackward) != decoder.viterbiDecode(nMaxBackward)).any()):
+            print("Bank path mismatch @ frame %d, stream %d" % (iFrame, iStream))
+            exit(1)
+del bank, decoderList, decoder
+
+del cModel
+gc.collect()
+rvExitCheck()
+print("Everything passed")
\ No newline at end of file
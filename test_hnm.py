@@ -0,0 +1,92 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import pyrevoice as p
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+proc = pitchtracker.Processor(sr)
+f0List = np.maximum(proc(w), 0.0)
+hopSize = proc.hopSize
+del proc
+
+print("Py HNM...")
+p.hnm.saveWav = lambda *args: None
+out_p = p.hnm.Analyzer(sr, hopSize = hopSize)(w, f0List.copy())
+
+print("C HNM...")
+pool = threadpool.Pool(3)
+threadpool.setSharedPool(pool)
+analyzer = hnm.Analyzer(sr, hopSize = hopSize)
+out_c = analyzer(w, f0List)
+
+f0List_p, hFreqList_p, hAmpList_p, hPhaseList_p = out_p[:4]
+f0List_c, hFreqList_c, hAmpList_c, hPhaseList_c = out_c[:4]
+voiced = f0List_p > 0.0
+if(hFreqList_c.shape != hFreqList_p.shape or (voiced != (f0List_c > 0.0)).any()):
+    print("Test failed, shape or voicing mismatch")
+    exit(1)
+# unvoiced amplitudes are zero instead of exp(0.0)
+for name, a, b in (("f0", f0List_c, f0List_p), ("hFreq", hFreqList_c, hFreqList_p), ("hAmp", hAmpList_c[voiced], hAmpList_p[voiced]),
+                   ("sinusoidEnergy", out_c[4], out_p[4]), ("noiseEnv", out_c[5], out_p[5]), ("noiseEnergy", out_c[6], out_p[6])):
+    if(not np.allclose(a, b, rtol = 1e-6, atol = 1e-9)):
+        print("Test failed, %s differs by %g" % (name, np.max(np.abs(a - b))))
+        exit(1)
+
+# the reference takes the angle of the rounding noise at dc, which can offset every phase of a hop by 2 * pi
+# relative phases then differ by 2 * pi * (freq / f0 - 1)
+ratio = hFreqList_p[voiced] * np.arange(1, hFreqList_p.shape[1] + 1)
+phaseOk = np.zeros(np.sum(voiced), dtype = bool)
+for m in (-1, 0, 1):
+    diff = hPhaseList_c[voiced] - hPhaseList_p[voiced] - 2.0 * np.pi * m * (ratio - 1.0)
+    diff = np.abs(np.mod(diff + np.pi, 2.0 * np.pi) - np.pi)
+    phaseOk |= (diff < 1e-6).all(axis = 1)
+if(not phaseOk.all()):
+    print("Test failed, phase differs in %d hop(s)" % np.sum(~phaseOk))
+    exit(1)
+
+print("Pool...")
+serialPool = threadpool.Pool(0)
+threadpool.setSharedPool(serialPool)
+out_s = analyzer(w, f0List)
+if(any((a != b).any() for a, b in zip(out_s, out_c))):
+    print("Test failed, output depends on the pool")
+    exit(1)
+
+print("Synth...")
+# a stationary tone comes back as the cosine sum it was described with
+nHop, nHar, f0 = 40, 30, 220.0
+synther = hnm.Synther(sr, hopSize = hopSize)
+amp = 1.0 / np.arange(1, nHar + 1)
+relPhase = np.linspace(0.0, 3.0, nHar)
+energy = np.sum(amp ** 2) / 2.0
+out = synther(np.full(nHop, f0), np.ones((nHop, nHar)), np.tile(amp / amp[0], (nHop, 1)), np.tile(relPhase, (nHop, 1)), np.full(nHop, energy))
+t = np.arange(nHop * hopSize) / sr
+ref = np.sum(amp[:, None] * np.cos(2.0 * np.pi * f0 * np.arange(1, nHar + 1)[:, None] * t + relPhase[:, None]), axis = 0)
+if(not np.allclose(out, ref, atol = 1e-9)):
+    print("Test failed, stationary tone differs by %g" % np.max(np.abs(out - ref)))
+    exit(1)
+
+sinusoid = (f0List_c, hFreqList_c, hAmpList_c, hPhaseList_c, out_c[4])
+out_s = synther(*sinusoid)
+threadpool.setSharedPool(pool)
+out_c = synther(*sinusoid)
+if((out_s != out_c).any()):
+    print("Test failed, synthesis depends on the pool")
+    exit(1)
+
+for inPlace in (False, True):
+    rtSynther = rthnm.Processor(sr, hFreqList_c.shape[1], inPlace = inPlace, hopSize = hopSize)
+    outList = [rtSynther(*hop) for hop in zip(*sinusoid)]
+    outList.append(rtSynther(None))
+    if(outList[0] is not None or (np.concatenate(outList[1:]) != out_c).any()):
+        print("Test failed, rt synthesis differs from offline synthesis (inPlace = %s)" % inPlace)
+        exit(1)
+    del rtSynther
+
+threadpool.setSharedPool(None)
+del analyzer, synther, pool, serialPool
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,70 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import pyrevoice as p
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+def feedHops(proc, x, hopSize):
+    outList = []
+    iInHop = 0
+    while(True):
+        data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+        if(len(data) == 0):
+            data = None
+        out = proc(data)
+        if(out is not None):
+            outList.append(out)
+        elif(data is None):
+            break
+        iInHop += 1
+    return outList
+
+print("RTFilter...")
+kernel = rtfilter.firwinSingleBand(111, 0.0, 2500.0, "blackman", sr / 2)
+heapProc = rtfilter.Procressor(kernel, 512)
+with RTSection():
+    inPlaceProc = rtfilter.Procressor(kernel, 512, inPlace = True)
+for i in range(0, len(w) - 512, 512):
+    out, out_i = heapProc(w[i:i + 512]), inPlaceProc(w[i:i + 512])
+    if((out is None) != (out_i is None) or (out is not None and (out != out_i).any())):
+        print("Test failed, RTFilter output mismatch at sample %d" % i)
+        exit(1)
+del heapProc, inPlaceProc
+
+print("RTPYin...")
+# a caller-provided pdf keeps parameter creation off the heap too
+pdf = p.pyin.normalized_pdf(1.7, 6.8, 0.0, 1.0, 128)
+for prefilter in (False, True):
+    heapProc = rtpyin.Processor(sr, prefilter = prefilter, pdf = pdf)
+    with RTSection():
+        inPlaceProc = rtpyin.Processor(sr, prefilter = prefilter, pdf = pdf, inPlace = True)
+    obsProbList = feedHops(heapProc, w, heapProc.hopSize)
+    obsProbList_i = feedHops(inPlaceProc, w, inPlaceProc.hopSize)
+    if(len(obsProbList) != len(obsProbList_i) or any(a.shape != b.shape or (a != b).any() for a, b in zip(obsProbList, obsProbList_i))):
+        print("Test failed, RTPYin output mismatch with prefilter = %s" % prefilter)
+        exit(1)
+    del inPlaceProc
+
+print("RTMonoPitch...")
+# the heap processor keeps the shared model alive, so the in-place one only references it
+pyinProc = heapProc
+hopSize = pyinProc.hopSize
+heapProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc))
+with RTSection():
+    inPlaceProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc), inPlace = True)
+for iHop, obsProb in enumerate(obsProbList):
+    frame = getFrame(w, iHop * hopSize, 2 * hopSize)
+    if((heapProc(frame, obsProb) != inPlaceProc(frame, obsProb)).any()):
+        print("Test failed, RTMonoPitch output mismatch at hop %d" % iHop)
+        exit(1)
+del heapProc, inPlaceProc, pyinProc
+
+if(rvRTViolationCount() != 0):
+    print("Test failed, in-place initialization touched the heap %d time(s)" % rvRTViolationCount())
+    exit(1)
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
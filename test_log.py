@@ -0,0 +1,91 @@
+import numpy as np
+import threading
+from revoice import *
+from revoice.common import *
+import gc
+
+messageList = []
+messageLock = threading.Lock()
+def sink(severity, message, nSuppressed):
+    with messageLock:
+        messageList.append((severity, message, nSuppressed, threading.get_ident()))
+
+def takeMessages():
+    rvFlushLog()
+    with messageLock:
+        out = messageList[:]
+        del messageList[:]
+    return out
+
+# every frame after the first one has zero probability and warns from the same call site
+model = hmm.SparseHMM(np.array([0.5, 0.5]), np.array([0, 0, 1, 1]), np.array([0, 1, 0, 1]), np.array([0.9, 0.1, 0.1, 0.9]))
+obsSeq = np.zeros((200, 2))
+obsSeq[0] = 1.0
+
+setLogSink(sink)
+
+print("Rate limit...")
+rvSetLogRateLimit(5)
+model.viterbiDecode(obsSeq)
+out = takeMessages()
+warningList = [m for m in out if m[2] == 0]
+summaryList = [m for m in out if m[2] > 0]
+if(len(warningList) + sum(m[2] for m in summaryList) != 199):
+    print("Test failed, %d warning(s) delivered and %d suppressed, expected 199 in total" % (len(warningList), sum(m[2] for m in summaryList)))
+    exit(1)
+if(len(warningList) < 5 or len(summaryList) == 0 or "zero probabilities at frame 1." not in warningList[0][1]):
+    print("Test failed, rate limit did not keep the first messages and summarize the rest")
+    exit(1)
+if(any(m[0] != RvLogWarning for m in out)):
+    print("Test failed, wrong severity")
+    exit(1)
+# summaries carry the first suppressed message of a window, not its format string
+if(any("%" in m[1] or "zero probabilities at frame" not in m[1] for m in summaryList)):
+    print("Test failed, summary is not a formatted message: %s" % summaryList[0][1])
+    exit(1)
+if("zero probabilities at frame 6." not in summaryList[0][1]):
+    print("Test failed, first summary does not show the first suppressed message: %s" % summaryList[0][1])
+    exit(1)
+
+print("Unlimited...")
+rvSetLogRateLimit(0)
+model.viterbiDecode(obsSeq)
+out = takeMessages()
+if(len(out) != 199 or any(m[2] != 0 for m in out)):
+    print("Test failed, %d message(s) delivered without rate limit" % len(out))
+    exit(1)
+
+print("Severity filter...")
+rvSetLogSeverity(RvLogCritical)
+model.viterbiDecode(obsSeq)
+if(len(takeMessages()) != 0):
+    print("Test failed, warnings pass a critical filter")
+    exit(1)
+rvSetLogSeverity(RvLogDebug)
+
+print("Drain thread...")
+rvSetLogRateLimit(0)
+model.viterbiDecode(obsSeq[:3])
+for i in range(100):
+    with messageLock:
+        if(len(messageList) == 2):
+            break
+    threading.Event().wait(0.02)
+out = takeMessages()
+if(len(out) != 2 or any(m[3] == threading.get_ident() for m in out)):
+    print("Test failed, messages were not delivered by the drain thread")
+    exit(1)
+
+print("Real-time section...")
+with RTSection():
+    violatingProc = rtenergy.Processor(128, 8, 1e-8)
+out = takeMessages()
+if(rvRTViolationCount() == 0 or not any(m[0] == RvLogCritical and "allocation in real-time section" in m[1] for m in out)):
+    print("Test failed, violation was not reported through the sink")
+    exit(1)
+
+setLogSink(None)
+del violatingProc, model
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,157 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import ctypes
+import threading
+import gc
+
+sr = 44100.0
+
+gc.collect()
+baseStats = memoryStats()
+
+print("Processor footprint...")
+pyinProc = rtpyin.Processor(sr)
+monoPitchProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc))
+stats = memoryStats()
+if(stats["currentBytes"] <= baseStats["currentBytes"] or stats["liveBlockCount"] <= baseStats["liveBlockCount"]):
+    print("Test failed, processors are not accounted")
+    exit(1)
+if(stats["peakBytes"] < stats["currentBytes"]):
+    print("Test failed, peak is below current")
+    exit(1)
+callsiteList = memoryCallsites()
+if(sum(c["currentBytes"] for c in callsiteList) != stats["currentBytes"] or sum(c["liveBlockCount"] for c in callsiteList) != stats["liveBlockCount"]):
+    print("Test failed, callsites do not sum up to the totals")
+    exit(1)
+if(not any(c["func"] == "rvCreateRTPYinProcessor" for c in callsiteList)):
+    print("Test failed, rvCreateRTPYinProcessor is not listed")
+    exit(1)
+for c in callsiteList[:5]:
+    print("  %8d bytes in %d block(s) @ %s:%d" % (c["currentBytes"], c["liveBlockCount"], c["func"], c["line"]))
+
+del monoPitchProc
+del pyinProc
+gc.collect()
+stats = memoryStats()
+if(stats["currentBytes"] != baseStats["currentBytes"] or stats["liveBlockCount"] != baseStats["liveBlockCount"]):
+    print("Test failed, memory is not returned (%d -> %d bytes)" % (baseStats["currentBytes"], stats["currentBytes"]))
+    exit(1)
+
+print("Watermark...")
+crossList = []
+rvResetMemoryPeak()
+setMemoryWatermarkCallback(memoryStats()["currentBytes"] + 65536, lambda current, watermark: crossList.append((current, watermark)))
+for i in range(3):
+    pyinProc = rtpyin.Processor(sr)
+    del pyinProc
+    gc.collect()
+setMemoryWatermarkCallback(0, None)
+if(len(crossList) != 3 or any(current < watermark for current, watermark in crossList)):
+    print("Test failed, expected 3 crossings, got", crossList)
+    exit(1)
+if(memoryStats()["peakBytes"] < crossList[0][1]):
+    print("Test failed, peak is below the crossed watermark")
+    exit(1)
+
+print("Create and destroy...")
+# each processor and its buffers are one block, in-place ones take none, monopitch processors also hold their model
+monoPitchParam = rtmonopitch.parameterFromPYin(rtpyin.Processor(sr))
+model = hmm.SparseHMM(np.array([0.5, 0.5]), np.array([0, 0, 1, 1]), np.array([0, 1, 0, 1]), np.array([0.9, 0.1, 0.1, 0.9]))
+kernel = rtfilter.firwinSingleBand(63, 0.0, 1000.0, "hanning", sr / 2)
+factoryList = [
+    ("SparseHMM", 1, lambda: hmm.SparseHMM(np.array([0.5, 0.5]), np.array([0, 0, 1, 1]), np.array([0, 1, 0, 1]), np.array([0.9, 0.1, 0.1, 0.9]))),
+    ("RTSparseHMM", 1, lambda: hmm.RTSparseHMM(model, 16)),
+    ("RTFilter", 1, lambda: rtfilter.Procressor(kernel, 256)),
+    ("RTFilter in place", 0, lambda: rtfilter.Procressor(kernel, 256, inPlace = True)),
+    ("RTEnergyTracker", 1, lambda: rtenergy.Processor(256, 2, 1e-8)),
+    ("RTPYin", 1, lambda: rtpyin.Processor(sr)),
+    ("RTPYin without prefilter", 1, lambda: rtpyin.Processor(sr, prefilter = False)),
+    ("RTPYin with gate", 1, lambda: rtpyin.Processor(sr, gateThreshold = 1e-8)),
+    ("RTPYin in place", 0, lambda: rtpyin.Processor(sr, inPlace = True)),
+    ("RTMonoPitch", 2, lambda: rtmonopitch.Processor(*monoPitchParam)),
+    ("RTMonoPitch in place", 1, lambda: rtmonopitch.Processor(*monoPitchParam, inPlace = True)),
+]
+for name, nBlock, factory in factoryList:
+    gc.collect()
+    baseStats = memoryStats()
+    proc = factory()
+    nCreated = memoryStats()["liveBlockCount"] - baseStats["liveBlockCount"]
+    del proc
+    gc.collect()
+    stats = memoryStats()
+    if(nCreated != nBlock):
+        print("Test failed, %s takes %d block(s), expected %d" % (name, nCreated, nBlock))
+        exit(1)
+    if(stats["currentBytes"] != baseStats["currentBytes"] or stats["liveBlockCount"] != baseStats["liveBlockCount"]):
+        print("Test failed, %s is not returned (%d -> %d bytes)" % (name, baseStats["currentBytes"], stats["currentBytes"]))
+        exit(1)
+del model, factoryList, factory
+
+print("Exit check...")
+messageList = []
+setLogSink(lambda severity, message, nSuppressed: messageList.append(message))
+leakedProc = rtenergy.Processor(256, 2, 1e-8)
+rvExitCheck()
+rvFlushLog()
+if(not any("Memory block" in message for message in messageList)):
+    print("Test failed, a live processor is not reported")
+    exit(1)
+del leakedProc
+gc.collect()
+messageList.clear()
+rvExitCheck()
+rvFlushLog()
+setLogSink(None)
+if(messageList):
+    print("Test failed, blocks are reported after destroying every processor:", messageList)
+    exit(1)
+
+print("Cross-thread free...")
+# more threads than allocation shards, each block is destroyed on another thread than the one that created it
+nThread = 20
+procList = [None] * nThread
+def create(i):
+    procList[i] = rtenergy.Processor(256, 2, 1e-8)
+def destroy(i):
+    procList[i] = None
+threadList = [threading.Thread(target = create, args = (i,)) for i in range(nThread)]
+for thread in threadList:
+    thread.start()
+for thread in threadList:
+    thread.join()
+for proc in procList:
+    if(ctypes.cast(proc.proc, ctypes.c_void_p).value % 64 != 0):
+        print("Test failed, block is not 64-byte aligned")
+        exit(1)
+del proc
+
+# half of them stay alive and must be reported, wherever they were created
+threadList = [threading.Thread(target = destroy, args = (i,)) for i in range(0, nThread, 2)]
+for thread in threadList:
+    thread.start()
+for thread in threadList:
+    thread.join()
+gc.collect()
+messageList.clear()
+setLogSink(lambda severity, message, nSuppressed: messageList.append(message))
+rvExitCheck()
+rvFlushLog()
+nReported = sum("Memory block" in message for message in messageList)
+if(memoryStats()["liveBlockCount"] > 0 and nReported != nThread // 2):
+    print("Test failed, %d block(s) reported, expected %d" % (nReported, nThread // 2))
+    exit(1)
+threadList = [threading.Thread(target = destroy, args = (i,)) for i in range(1, nThread, 2)]
+for thread in threadList:
+    thread.start()
+for thread in threadList:
+    thread.join()
+gc.collect()
+messageList.clear()
+rvExitCheck()
+rvFlushLog()
+setLogSink(None)
+if(messageList):
+    print("Test failed, blocks freed on other threads are still reported:", messageList)
+    exit(1)
+print("Everything passed")
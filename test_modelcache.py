@@ -0,0 +1,103 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import threading
+import gc
+
+sr = 44100.0
+param = rtmonopitch.parameterFromPYin(rtpyin.Processor(sr))
+
+def liveModelCount():
+    return sum(c["liveBlockCount"] for c in memoryCallsites() if c["func"] == "rvCreateSparseHMM")
+
+gc.collect()
+baseCount = liveModelCount()
+
+print("Sharing...")
+procA = rtmonopitch.Processor(*param)
+procB = rtmonopitch.Processor(*param, maxObsLength = 32, inPlace = True)
+procC = rtmonopitch.Processor(*param, transSelf = 0.99)
+if(procA.model != procB.model):
+    print("Test failed, processors with the same transition parameters do not share the model")
+    exit(1)
+if(procA.model == procC.model):
+    print("Test failed, processors with different transition parameters share the model")
+    exit(1)
+if(liveModelCount() != baseCount + 2):
+    print("Test failed, expected 2 live models, got %d" % (liveModelCount() - baseCount))
+    exit(1)
+
+print("Rebuild...")
+del procA, procB, procC
+gc.collect()
+if(liveModelCount() != baseCount):
+    print("Test failed, released models are still alive")
+    exit(1)
+proc = rtmonopitch.Processor(*param)
+if(liveModelCount() != baseCount + 1):
+    print("Test failed, released model is not rebuilt")
+    exit(1)
+x = np.zeros(proc.hopSize * 2)
+for i in range(4):
+    proc(x, np.zeros((0, 2)))
+del proc
+gc.collect()
+
+print("Prebuild...")
+rtmonopitch.prebuildModel(*param)
+rtmonopitch.prebuildModel(*param)
+if(liveModelCount() != baseCount + 1):
+    print("Test failed, expected 1 prebuilt model, got %d" % (liveModelCount() - baseCount))
+    exit(1)
+proc = rtmonopitch.Processor(*param)
+model = proc.model
+del proc
+gc.collect()
+proc = rtmonopitch.Processor(*param)
+if(proc.model != model or liveModelCount() != baseCount + 1):
+    print("Test failed, prebuilt model does not outlive its processors")
+    exit(1)
+del proc
+gc.collect()
+rtmonopitch.releaseModelCache()
+if(liveModelCount() != baseCount):
+    print("Test failed, releasing the cache keeps the prebuilt model")
+    exit(1)
+
+print("Tracker...")
+# the tracker and every channel of a bank hold one reference to the same model
+tracker = rtpitchtracker.Processor(sr)
+bank = rtpitchtracker.Bank(3, sr)
+if(liveModelCount() != baseCount + 1):
+    print("Test failed, expected 1 live model for a tracker and a bank, got %d" % (liveModelCount() - baseCount))
+    exit(1)
+del tracker, bank
+gc.collect()
+if(liveModelCount() != baseCount):
+    print("Test failed, tracker model is still alive")
+    exit(1)
+
+print("Concurrent creation...")
+# all threads miss the cache at once, the models built by the losers are dropped
+nThread = 8
+barrier = threading.Barrier(nThread)
+procList = [None] * nThread
+def create(i):
+    barrier.wait()
+    procList[i] = rtmonopitch.Processor(*param, transSelf = 0.995)
+threadList = [threading.Thread(target = create, args = (i,)) for i in range(nThread)]
+for thread in threadList:
+    thread.start()
+for thread in threadList:
+    thread.join()
+if(len(set(proc.model for proc in procList)) != 1):
+    print("Test failed, concurrently created processors do not share the model")
+    exit(1)
+if(liveModelCount() != baseCount + 1):
+    print("Test failed, expected 1 live model after concurrent creation, got %d" % (liveModelCount() - baseCount))
+    exit(1)
+
+del procList, thread, threadList
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,73 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+print("Single chunk...")
+proc = pitchtracker.Processor(sr, chunkSize = 1 << 30, overlapSize = 0)
+f0List = proc(w)
+if(len(f0List) != getNFrame(len(w), proc.hopSize)):
+    print("Test failed, %d frame(s) for %d hops" % (len(f0List), getNFrame(len(w), proc.hopSize)))
+    exit(1)
+
+# with a history as long as the input every hop of the real-time tracker decodes the whole signal
+rtProc = rtpitchtracker.Processor(sr, maxObsLength = len(f0List))
+f0List_rt = np.zeros(len(f0List))
+iX = 0
+while True:
+    out = rtProc(w[iX:iX + rtProc.hopSize] if iX < len(w) else None)
+    if(out is None):
+        break
+    frameIndex, f0 = out
+    f0List_rt[frameIndex] = f0
+    iX += rtProc.hopSize
+if((f0List != f0List_rt).any()):
+    print("Test failed, offline tracker differs from the real-time tracker")
+    exit(1)
+del rtProc
+
+print("Candidate limit...")
+# both trackers keep the same most probable candidates
+proc = pitchtracker.Processor(sr, chunkSize = 512, overlapSize = 128, maxCandidate = 2)
+f0List = proc(w)
+rtProc = rtpitchtracker.Processor(sr, maxObsLength = len(f0List), maxCandidate = 2)
+f0List_rt = np.zeros(len(f0List))
+iX = 0
+while True:
+    out = rtProc(w[iX:iX + rtProc.hopSize] if iX < len(w) else None)
+    if(out is None):
+        break
+    frameIndex, f0 = out
+    f0List_rt[frameIndex] = f0
+    iX += rtProc.hopSize
+if((np.maximum(f0List, 0.0) != np.maximum(f0List_rt, 0.0)).any()):
+    print("Test failed, offline tracker differs from the real-time tracker with maxCandidate = 2")
+    exit(1)
+del rtProc
+
+print("Chunks...")
+x = np.tile(w, 3)
+f0List = pitchtracker.Processor(sr, chunkSize = 1 << 30, overlapSize = 0)(x)
+pool = threadpool.Pool(3)
+threadpool.setSharedPool(pool)
+f0List_c = pitchtracker.Processor(sr, chunkSize = 512, overlapSize = 128)(x)
+# unvoiced states observed alike can take equally likely paths, only voiced hops are compared
+if((np.maximum(f0List, 0.0) != np.maximum(f0List_c, 0.0)).any()):
+    print("Test failed, chunked output differs from a single decode")
+    exit(1)
+
+print("Pool...")
+serialPool = threadpool.Pool(0)
+threadpool.setSharedPool(serialPool)
+f0List_s = pitchtracker.Processor(sr, chunkSize = 512, overlapSize = 128)(x)
+if((f0List_s != f0List_c).any()):
+    print("Test failed, output depends on the pool")
+    exit(1)
+
+threadpool.setSharedPool(None)
+del proc, pool, serialPool
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,125 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+# the stream before a reset is a different part of the input, cut mid-hop
+other = w[len(w) // 2:len(w) // 2 + len(w) // 3 + 7]
+
+def feedHops(proc, x, hopSize):
+    outList = []
+    iInHop = 0
+    while(True):
+        data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+        if(len(data) == 0):
+            data = None
+        out = proc(data)
+        if(out is not None):
+            outList.append(out)
+        elif(data is None):
+            break
+        iInHop += 1
+    return outList
+
+def feedPartial(proc, x, hopSize):
+    for i in range(0, len(x) - hopSize, hopSize):
+        proc(x[i:i + hopSize])
+
+def sameList(a, b):
+    if(len(a) != len(b)):
+        return False
+    for u, v in zip(a, b):
+        if(isinstance(u, tuple)):
+            if(not sameList(u, v)):
+                return False
+        elif(u.shape != v.shape or (u != v).any()):
+            return False
+    return True
+
+print("RTFilter...")
+kernel = rtfilter.firwinSingleBand(111, 0.0, 2500.0, "blackman", sr / 2)
+freshProc = rtfilter.Procressor(kernel, 512)
+reusedProc = rtfilter.Procressor(kernel, 512)
+for i in range(0, len(other) - 300, 300):
+    reusedProc(other[i:i + 300])
+reusedProc.reset()
+for i in range(0, len(w) - 512, 512):
+    out, out_r = freshProc(w[i:i + 512]), reusedProc(w[i:i + 512])
+    if((out is None) != (out_r is None) or (out is not None and (out != out_r).any())):
+        print("Test failed, RTFilter output mismatch after reset at sample %d" % i)
+        exit(1)
+del freshProc, reusedProc
+
+print("RTPYin...")
+for kwargs in ({"prefilter": False}, {"prefilter": True}, {"prefilter": True, "gateThreshold": 1e-8}):
+    freshProc = rtpyin.Processor(sr, **kwargs)
+    reusedProc = rtpyin.Processor(sr, **kwargs)
+    feedPartial(reusedProc, other, reusedProc.hopSize)
+    reusedProc.reset()
+    obsProbList = feedHops(freshProc, w, freshProc.hopSize)
+    if(not sameList(obsProbList, feedHops(reusedProc, w, reusedProc.hopSize)) or reusedProc.skippedFrames != freshProc.skippedFrames):
+        print("Test failed, RTPYin output mismatch after reset with", kwargs)
+        exit(1)
+    del reusedProc
+pyinProc = freshProc
+hopSize = pyinProc.hopSize
+
+print("RTMonoPitch...")
+def runMonoPitch(proc):
+    outList = []
+    for iHop, obsProb in enumerate(obsProbList):
+        frame = getFrame(w, iHop * hopSize, 2 * hopSize)
+        outList.append(proc(frame, obsProb))
+        outList.append(proc.delta(frame, obsProb))
+    return outList
+freshProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc))
+reusedProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc))
+for iHop in range(len(obsProbList) // 3):
+    reusedProc(getFrame(other, iHop * hopSize, 2 * hopSize), obsProbList[-iHop - 1])
+reusedProc.reset()
+if(not sameList(runMonoPitch(freshProc), runMonoPitch(reusedProc))):
+    print("Test failed, RTMonoPitch output mismatch after reset")
+    exit(1)
+del freshProc, reusedProc
+
+print("RTPitchTracker...")
+freshProc = rtpitchtracker.Processor(sr)
+reusedProc = rtpitchtracker.Processor(sr)
+feedPartial(reusedProc, other, hopSize)
+reusedProc.reset()
+if(not sameList(feedHops(freshProc, w, hopSize), feedHops(reusedProc, w, hopSize))):
+    print("Test failed, RTPitchTracker output mismatch after reset")
+    exit(1)
+del freshProc, reusedProc
+
+print("Pool...")
+pyinPool = rtpyin.ProcessorPool(sr, 2)
+monoPitchPool = rtmonopitch.ProcessorPool(2, *rtmonopitch.parameterFromPYin(pyinProc))
+with RTSection():
+    pyinA, pyinB = pyinPool.acquire(), pyinPool.acquire()
+    monoPitchA = monoPitchPool.acquire()
+if(pyinA is None or pyinB is None or monoPitchA is None or pyinPool.acquire() is not None):
+    print("Test failed, pool does not hand out exactly 2 processors")
+    exit(1)
+feedPartial(pyinA, other, hopSize)
+for iHop in range(len(obsProbList) // 3):
+    monoPitchA(getFrame(other, iHop * hopSize, 2 * hopSize), obsProbList[-iHop - 1])
+del pyinA, monoPitchA
+gc.collect()
+with RTSection():
+    pyinA = pyinPool.acquire()
+    monoPitchA = monoPitchPool.acquire()
+freshPYinProc = rtpyin.Processor(sr)
+freshProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(pyinProc))
+if(not sameList(feedHops(freshPYinProc, w, hopSize), feedHops(pyinA, w, hopSize)) or not sameList(runMonoPitch(freshProc), runMonoPitch(monoPitchA))):
+    print("Test failed, pooled processor output mismatch after release")
+    exit(1)
+if(rvRTViolationCount() != 0):
+    print("Test failed, acquiring from a pool touched the heap %d time(s)" % rvRTViolationCount())
+    exit(1)
+del pyinA, pyinB, monoPitchA, freshProc, freshPYinProc, pyinPool, monoPitchPool, pyinProc
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
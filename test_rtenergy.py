@@ -0,0 +1,70 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import gc
+
+hopSize = 256
+x = np.random.uniform(-1.0, 1.0, hopSize * 64) * np.repeat(np.random.uniform(0.0, 2.0, 64), hopSize)
+
+print("Energy...")
+for nWindowHop in (1, 2, 5, 16):
+    proc = rtenergy.Processor(hopSize, nWindowHop, 1e-8)
+    for iHop in range(len(x) // hopSize):
+        nHop, energy, isSilent = proc(x[iHop * hopSize:(iHop + 1) * hopSize])
+        ref = np.var(x[max(0, iHop + 1 - nWindowHop) * hopSize:(iHop + 1) * hopSize])
+        if(nHop != 1 or abs(energy - ref) > 1e-12 * max(1.0, ref)):
+            print("Test failed, energy differs at hop %d with nWindowHop = %d" % (iHop, nWindowHop))
+            exit(1)
+    del proc
+
+print("Hysteresis...")
+silentThreshold, voicedThreshold = 0.01, 0.1
+proc = rtenergy.Processor(hopSize, 1, silentThreshold, voicedThreshold)
+isSilentRef = True
+nTransition = 0
+for level in (0.0, 0.2, 0.5, 0.2, 0.15, 0.05, 0.2, 0.4, 0.11, 0.09, 0.01, 0.05, 0.0):
+    # the square wave has a variance of level ** 2
+    hop = level * np.where(np.arange(hopSize) % 2 == 0, 1.0, -1.0)
+    nHop, energy, isSilent = proc(hop)
+    if(isSilentRef and energy >= voicedThreshold):
+        isSilentRef = False
+        nTransition += 1
+    elif(not isSilentRef and energy < silentThreshold):
+        isSilentRef = True
+        nTransition += 1
+    if(isSilent != isSilentRef):
+        print("Test failed, silent state is %s at energy %g" % (isSilent, energy))
+        exit(1)
+if(nTransition != 4):
+    print("Test failed, expected 4 transitions instead of %d" % nTransition)
+    exit(1)
+del proc
+
+print("Chunked...")
+proc = rtenergy.Processor(hopSize, 4, 1e-8)
+chunkedProc = rtenergy.Processor(hopSize, 4, 1e-8)
+i = 0
+for chunkSize in np.random.randint(1, 3 * hopSize, 200):
+    chunk = x[i:i + chunkSize]
+    if(len(chunk) == 0):
+        break
+    before = i // hopSize
+    i += len(chunk)
+    nHop, energy, isSilent = chunkedProc(chunk)
+    if(nHop != i // hopSize - before):
+        print("Test failed, %d hop(s) reported for %d completed" % (nHop, i // hopSize - before))
+        exit(1)
+    for iHop in range(before, i // hopSize):
+        _, refEnergy, refIsSilent = proc(x[iHop * hopSize:(iHop + 1) * hopSize])
+    if(nHop > 0 and (energy != refEnergy or isSilent != refIsSilent)):
+        print("Test failed, chunked input differs at sample %d" % i)
+        exit(1)
+nHop, energy, _ = chunkedProc(np.zeros(0))
+if(nHop != 0):
+    print("Test failed, empty input completed a hop")
+    exit(1)
+del proc, chunkedProc
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,96 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import pyrevoice as p
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+print("Py pYIN...")
+pyinProc = p.pyin.Processor(sr)
+obsProbList = pyinProc(w)
+nHop = len(obsProbList)
+
+print("Python...")
+mononoteProc = p.mononote.Processor(*p.mononote.parameterFromPYin(pyinProc))
+noteList_o = mononoteProc(w, obsProbList)
+
+print("C...")
+# a window covering the whole input gives the same decode as the offline version
+rtmononoteProc = rtmononote.Processor(*rtmononote.parameterFromPYin(pyinProc), maxObsLength = nHop)
+noteList = []
+for iHop in range(nHop):
+    frame = getFrame(w, iHop * rtmononoteProc.hopSize, 2 * rtmononoteProc.hopSize)
+    noteList += rtmononoteProc(frame, obsProbList[iHop])
+noteList += rtmononoteProc.flush()
+del rtmononoteProc
+
+if(len(noteList) != len(noteList_o)):
+    print("Note count mismatch(expected %d, got %d)" % (len(noteList_o), len(noteList)))
+    exit(1)
+for note, note_o in zip(noteList, noteList_o):
+    if(note["begin"] != note_o["begin"] or note["end"] != note_o["end"] or abs(note["pitch"] - note_o["pitch"]) > 1e-9):
+        print("Note mismatch(expected %s, got %s)" % (note_o, note))
+        exit(1)
+
+def checkNoteList(noteList, nFrame, minSemitone, nSemitone):
+    prevEnd = 0
+    for note in noteList:
+        if(note["begin"] >= note["end"] or note["begin"] < prevEnd or note["end"] > nFrame):
+            print("Note out of order or overlapping(%s after a note ending at %d)" % (note, prevEnd))
+            exit(1)
+        if(note["pitch"] < minSemitone or note["pitch"] >= minSemitone + nSemitone):
+            print("Note pitch out of range(%s)" % note)
+            exit(1)
+        prevEnd = note["end"]
+
+print("Streaming...")
+# default window over an input several windows long, notes come out as their last frame becomes final
+nRepeat = 4
+x = np.tile(w, nRepeat)
+rtmononoteProc = rtmononote.Processor(*rtmononote.parameterFromPYin(pyinProc))
+maxObsLength = rtmononoteProc.maxObsLength
+noteList = []
+for iHop in range(nHop * nRepeat):
+    frame = getFrame(x, iHop * rtmononoteProc.hopSize, 2 * rtmononoteProc.hopSize)
+    out = rtmononoteProc(frame, obsProbList[iHop % nHop])
+    iFinalFrame = iHop - maxObsLength + 1
+    for note in out:
+        if(note["end"] != iFinalFrame + 1):
+            print("Note %s does not end at the final frame %d" % (note, iFinalFrame))
+            exit(1)
+    noteList += out
+noteList += rtmononoteProc.flush()
+checkNoteList(noteList, nHop * nRepeat, rtmononoteProc.minSemitone, rtmononoteProc.nSemitone)
+if(len(noteList) < len(noteList_o) * (nRepeat - 1)):
+    print("Too few notes(expected at least %d, got %d)" % (len(noteList_o) * (nRepeat - 1), len(noteList)))
+    exit(1)
+del rtmononoteProc
+
+print("Candidate limit...")
+# only the most probable candidates are used, in their order
+maxCandidate = 2
+if(max(len(obsProb) for obsProb in obsProbList) <= maxCandidate):
+    print("no hop has more than %d candidates" % maxCandidate)
+    exit(1)
+limitedProc = rtmononote.Processor(*rtmononote.parameterFromPYin(pyinProc), maxCandidate = maxCandidate)
+refProc = rtmononote.Processor(*rtmononote.parameterFromPYin(pyinProc))
+noteList = []
+noteList_r = []
+for iHop in range(nHop):
+    frame = getFrame(w, iHop * refProc.hopSize, 2 * refProc.hopSize)
+    obsProb = np.asarray(obsProbList[iHop], dtype = np.float64).reshape(-1, 2)
+    keptObsProb = obsProb[np.sort(np.argsort(-obsProb[:, 1], kind = "stable")[:maxCandidate])]
+    noteList += limitedProc(frame, obsProb)
+    noteList_r += refProc(frame, keptObsProb)
+noteList += limitedProc.flush()
+noteList_r += refProc.flush()
+if(noteList != noteList_r):
+    print("Note mismatch with the most probable candidates(expected %d notes, got %d)" % (len(noteList_r), len(noteList)))
+    exit(1)
+checkNoteList(noteList, nHop, limitedProc.minSemitone, limitedProc.nSemitone)
+del limitedProc, refProc
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
\ No newline at end of file
@@ -55,6 +55,128 @@ for iHop in range(nHop):
     f0List[iHop - len(out) + 1:iHop + 1] = out
 
 del rtmonopitchProc
+
+print("Delta...")
+# a short window so that frames leave it while onsets can still extend them
+param = rtmonopitch.parameterFromPYin(pyinProc)
+fullProc = rtmonopitch.Processor(*param, maxObsLength = 16)
+deltaProc = rtmonopitch.Processor(*param, maxObsLength = 16)
+mixedProc = rtmonopitch.Processor(*param, maxObsLength = 16)
+f0List_delta = np.full(nHop, np.nan)
+f0List_mixed = np.full(nHop, np.nan)
+for iHop in range(nHop):
+    frame = getFrame(x, iHop * fullProc.hopSize, 2 * fullProc.hopSize)
+    out = fullProc(frame, obsProbList_c[iHop])
+    iFirstFrame = iHop - len(out) + 1
+
+    iFrame, value = deltaProc.delta(frame, obsProbList_c[iHop])
+    if(len(iFrame) > 0 and ((np.diff(iFrame) != 1).any() or iFrame[-1] != iHop)):
+        print("delta frames are not a run ending at hop %d" % iHop)
+        exit(1)
+    f0List_delta[iFrame] = value
+    if(not np.array_equal(f0List_delta[iFirstFrame:iHop + 1], out)):
+        print("delta output mismatch with the full output @ hop %d" % iHop)
+        exit(1)
+
+    # a full call in between makes the next delta cover the whole window again
+    if(iHop % 7 == 3):
+        f0List_mixed[iFirstFrame:iHop + 1] = mixedProc(frame, obsProbList_c[iHop])
+    else:
+        iFrame, value = mixedProc.delta(frame, obsProbList_c[iHop])
+        f0List_mixed[iFrame] = value
+    if(not np.array_equal(f0List_mixed[iFirstFrame:iHop + 1], out)):
+        print("mixed output mismatch with the full output @ hop %d" % iHop)
+        exit(1)
+del fullProc, deltaProc, mixedProc
+
+print("Whole signal...")
+# with a window as long as the input the last call decodes all observations at once
+wholeProc = rtmonopitch.Processor(*param, maxObsLength = nHop)
+monopitchProc = p.monopitch.Processor(*p.monopitch.parameterFromPYin(pyinProc))
+for iHop in range(nHop):
+    frame = getFrame(x, iHop * wholeProc.hopSize, 2 * wholeProc.hopSize)
+    out = wholeProc(frame, obsProbList_c[iHop])
+    # bins come from the bound table in C and from rounding the log2 distance in Python
+    if(not np.allclose(wholeProc.obsTemp, monopitchProc.calcStateProb(obsProbList_c[iHop]), rtol = 1e-12, atol = 0.0)):
+        print("state probability mismatch with pyrevoice @ hop %d" % iHop)
+        exit(1)
+rng = np.random.default_rng(0)
+for i in range(200):
+    freq = wholeProc.minFreq * np.power(2.0, rng.uniform(-0.5, wholeProc.nSemitone / 12.0 + 0.5, 8))
+    obsProb = np.ascontiguousarray(np.stack((freq, rng.uniform(0.0, 0.125, 8)), axis = 1))
+    wholeProc(getFrame(x, 0, 2 * wholeProc.hopSize), obsProb)
+    if(not np.allclose(wholeProc.obsTemp, monopitchProc.calcStateProb(obsProb), rtol = 1e-12, atol = 0.0)):
+        print("state probability mismatch with pyrevoice for random candidates")
+        exit(1)
+f0List_o = monopitchProc(w, obsProbList_c)
+# unvoiced states observed alike can take equally likely paths
+if(((out > 0.0) != (f0List_o > 0.0)).any() or (np.maximum(out, 0.0) != np.maximum(f0List_o, 0.0)).any()):
+    print("whole signal decode mismatch with pyrevoice")
+    exit(1)
+del wholeProc, monopitchProc
+
+def keepCandidate(obsProb, maxCandidate):
+    # most probable ones in their order, ties go to the earlier one
+    order = np.argsort(-obsProb[:, 1], kind = "stable")
+    return obsProb[np.sort(order[:maxCandidate])]
+
+def refStateProb(proc, obsProb):
+    nBin = proc.nSemitone * proc.binPerSemitone
+    binPerOctave = 12.0 * proc.binPerSemitone
+    binEdgeList = proc.minFreq * np.power(2.0, (np.arange(nBin - 1) + 0.5) / binPerOctave)
+    maxFreq = proc.minFreq * np.power(2.0, proc.nSemitone / 12.0)
+    out = np.zeros(2 * nBin)
+    probYinPitched = 0.0
+    for freq, prob in obsProb:
+        if(freq < proc.minFreq or freq > maxFreq):
+            if(freq <= 0.0):
+                break
+            continue
+        out[np.searchsorted(binEdgeList, freq, side = "right")] = prob
+        probYinPitched += prob
+    probReallyPitched = proc.yinTrust * probYinPitched
+    if(probYinPitched > 0.0):
+        out[:nBin] *= probReallyPitched / probYinPitched
+    out[nBin:] = (1.0 - probReallyPitched) / nBin
+    return np.maximum(out, 0.0) + 1e-5
+
+print("Candidate limit...")
+maxCandidate = 3
+param = rtmonopitch.parameterFromPYin(pyinProc)
+limitedProc = rtmonopitch.Processor(*param, maxCandidate = maxCandidate)
+deltaProc = rtmonopitch.Processor(*param, maxCandidate = maxCandidate)
+refProc = rtmonopitch.Processor(*param)
+f0List_limited = np.zeros(nHop)
+f0List_delta = np.full(nHop, np.nan)
+nLimited = 0
+for iHop in range(nHop):
+    frame = getFrame(x, iHop * refProc.hopSize, 2 * refProc.hopSize)
+    obsProb = obsProbList_c[iHop]
+    keptObsProb = keepCandidate(obsProb, maxCandidate)
+    nLimited += len(obsProb) > maxCandidate
+    out = limitedProc(frame, obsProb)
+    refOut = refProc(frame, keptObsProb)
+    if(not np.array_equal(out, refOut)):
+        print("output mismatch with the most probable candidates @ hop %d" % iHop)
+        exit(1)
+    if(not np.array_equal(limitedProc.obsTemp, refProc.obsTemp)):
+        print("state probability mismatch with the most probable candidates @ hop %d" % iHop)
+        exit(1)
+    if(not np.allclose(limitedProc.obsTemp, refStateProb(limitedProc, keptObsProb), rtol = 1e-12, atol = 0.0)):
+        print("bin mapping mismatch @ hop %d" % iHop)
+        exit(1)
+    f0List_limited[iHop - len(out) + 1:iHop + 1] = out
+
+    iFrame, value = deltaProc.delta(frame, obsProb)
+    f0List_delta[iFrame] = value
+if(nLimited == 0):
+    print("no hop has more than %d candidates" % maxCandidate)
+    exit(1)
+if(not np.array_equal(f0List_delta, f0List_limited)):
+    print("delta output mismatch with the full output (%d hops)" % np.sum(f0List_delta != f0List_limited))
+    exit(1)
+del limitedProc, deltaProc, refProc
+
 gc.collect()
 rvExitCheck()
 
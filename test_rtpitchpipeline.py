@@ -0,0 +1,82 @@
+import numpy as np
+import threading
+from revoice import *
+from revoice.common import *
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+def runTracker(x, **kwargs):
+    proc = rtpitchtracker.Processor(sr, **kwargs)
+    hopSize = proc.hopSize
+    f0List = np.zeros(len(x) // hopSize + 1)
+    iInHop = 0
+    while(True):
+        data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+        out = proc(data if len(data) > 0 else None)
+        if(out is not None):
+            f0List[out[0]] = out[1]
+        elif(len(data) == 0):
+            break
+        iInHop += 1
+    return f0List
+
+def runPipeline(x, nQueueBlock, popDelay = 0.0, **kwargs):
+    proc = rtpitchpipeline.Processor(sr, nQueueBlock = nQueueBlock, **kwargs)
+    hopSize = proc.hopSize
+    f0List = np.zeros(len(x) // hopSize + 1)
+    nBlocked = [0]
+
+    # the producer stops on a full queue, the consumer may be slower than the stages
+    def produce():
+        for i in range(0, len(x), hopSize):
+            while(not proc.push(x[i:i + hopSize])):
+                nBlocked[0] += 1
+                threading.Event().wait(0.0005)
+        while(not proc.push(None)):
+            threading.Event().wait(0.0005)
+    producer = threading.Thread(target = produce)
+    producer.start()
+    while(True):
+        out = proc.pop()
+        if(out is None):
+            break
+        if(out is False):
+            threading.Event().wait(0.0005)
+            continue
+        f0List[out[0]] = out[1]
+        if(popDelay > 0.0):
+            threading.Event().wait(popDelay)
+    producer.join()
+    if(proc.pop() is not False):
+        print("Test failed, output after the end of stream")
+        exit(1)
+    return f0List, nBlocked[0]
+
+x = w[:len(w) // 2]
+for kwargs in ({}, {"prefilter": False}, {"gateThreshold": 1e-8}):
+    print("Pipeline with", kwargs, "...")
+    f0List = runTracker(x, **kwargs)
+    f0List_p, nBlocked = runPipeline(x, 4, **kwargs)
+    if((f0List != f0List_p).any()):
+        print("Test failed, f0 mismatch at %d frame(s)" % np.sum(f0List != f0List_p))
+        exit(1)
+
+print("Backpressure...")
+f0List_p, nBlocked = runPipeline(x, 1, popDelay = 0.002)
+if((f0List_p != runTracker(x)).any()):
+    print("Test failed, f0 mismatch with a slow consumer")
+    exit(1)
+if(nBlocked == 0):
+    print("Test failed, a slow consumer did not hold back the producer")
+    exit(1)
+
+print("Destroy mid-stream...")
+proc = rtpitchpipeline.Processor(sr, nQueueBlock = 2)
+for i in range(0, 64 * proc.hopSize, proc.hopSize):
+    proc.push(x[i:i + proc.hopSize])
+del proc
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,132 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+print("Separate stages...")
+x = w
+nX = len(x)
+rtpyinProc = rtpyin.Processor(sr)
+hopSize = rtpyinProc.hopSize
+obsProbList = []
+iInHop = 0
+while(True):
+    data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+    if(len(data) == 0):
+        data = None
+    out = rtpyinProc(data)
+    if(out is not None):
+        obsProbList.append(out)
+    elif(data is None):
+        break
+    iInHop += 1
+del rtpyinProc
+
+nHop = len(obsProbList)
+rtmonopitchProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(rtpyin.Processor(sr)))
+f0List = np.zeros(nHop)
+for iHop in range(nHop):
+    frame = getFrame(x, iHop * hopSize, 2 * hopSize)
+    iFrame, value = rtmonopitchProc.delta(frame, obsProbList[iHop])
+    f0List[iFrame] = value
+del rtmonopitchProc
+
+print("Tracker...")
+trackerProc = rtpitchtracker.Processor(sr)
+f0List_t = np.zeros(nHop)
+iInHop = 0
+while(True):
+    data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+    if(len(data) == 0):
+        data = None
+    out = trackerProc(data)
+    if(out is not None):
+        iFrame, value = out
+        f0List_t[iFrame] = value
+    elif(data is None):
+        break
+    iInHop += 1
+del trackerProc
+
+if((f0List != f0List_t).any()):
+    print("f0 mismatch at %d frame(s)" % np.sum(f0List != f0List_t))
+    exit(1)
+
+print("Candidate limit...")
+# pyin gives more candidates than the monopitch stage keeps
+maxCandidate = 2
+if(max(len(obsProb) for obsProb in obsProbList) <= maxCandidate):
+    print("no hop has more than %d candidates" % maxCandidate)
+    exit(1)
+rtmonopitchProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(rtpyin.Processor(sr)), maxCandidate = maxCandidate)
+f0List = np.zeros(nHop)
+for iHop in range(nHop):
+    frame = getFrame(x, iHop * hopSize, 2 * hopSize)
+    iFrame, value = rtmonopitchProc.delta(frame, obsProbList[iHop])
+    f0List[iFrame] = value
+del rtmonopitchProc
+
+trackerProc = rtpitchtracker.Processor(sr, maxCandidate = maxCandidate)
+f0List_t = np.zeros(nHop)
+iInHop = 0
+while(True):
+    data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+    if(len(data) == 0):
+        data = None
+    out = trackerProc(data)
+    if(out is not None):
+        iFrame, value = out
+        f0List_t[iFrame] = value
+    elif(data is None):
+        break
+    iInHop += 1
+del trackerProc
+
+if((f0List != f0List_t).any()):
+    print("f0 mismatch at %d frame(s) with maxCandidate = %d" % (np.sum(f0List != f0List_t), maxCandidate))
+    exit(1)
+
+print("Bank...")
+# channel 0 is x, the others are different material of the same length
+channelList = [x, x[::-1].copy(), np.roll(x, nX // 3) * 0.5]
+interleaved = np.stack(channelList, axis = 1)
+pool = threadpool.Pool(2)
+for bankPool in (None, pool):
+    bankProc = rtpitchtracker.Bank(len(channelList), sr, pool = bankPool)
+    for iPass in range(2):
+        f0List_b = np.zeros((len(channelList), nHop))
+        iInHop = 0
+        while(True):
+            data = interleaved[iInHop * hopSize:(iInHop + 1) * hopSize]
+            out = bankProc(data if len(data) > 0 else None)
+            if(out is not None):
+                for iChannel, (iFrame, value) in enumerate(out):
+                    f0List_b[iChannel][iFrame] = value
+            elif(len(data) == 0):
+                break
+            iInHop += 1
+        for iChannel, channel in enumerate(channelList):
+            trackerProc = rtpitchtracker.Processor(sr)
+            f0List_s = np.zeros(nHop)
+            iInHop = 0
+            while(True):
+                data = channel[iInHop * hopSize:(iInHop + 1) * hopSize]
+                out = trackerProc(data if len(data) > 0 else None)
+                if(out is not None):
+                    f0List_s[out[0]] = out[1]
+                elif(len(data) == 0):
+                    break
+                iInHop += 1
+            if((f0List_s != f0List_b[iChannel]).any()):
+                print("Test failed, bank channel %d mismatch at %d frame(s) with pool = %s" % (iChannel, np.sum(f0List_s != f0List_b[iChannel]), bankPool))
+                exit(1)
+            del trackerProc
+        bankProc.reset()
+    del bankProc
+del pool
+
+gc.collect()
+rvExitCheck()
+print("Everything passed")
\ No newline at end of file
@@ -62,6 +62,30 @@ if(iOutHop != nHop):
 del x
 f0List_pf = p.pyin.extractF0(obsProbList_pf)
 
+print("With silence gate...")
+x = w
+rtpyinProc = rtpyin.Processor(sr, prefilter = True, gateThreshold = 1e-8)
+obsProbList_g = []
+iInHop = 0
+while(True):
+    data = x[iInHop * rtpyinProc.hopSize:(iInHop + 1) * rtpyinProc.hopSize]
+    if(len(data) == 0):
+        data = None
+    out = rtpyinProc(data)
+    if(out is not None):
+        obsProbList_g.append(out)
+    elif(data is None):
+        break
+    iInHop += 1
+if(len(obsProbList_g) != len(obsProbList_pf)):
+    print("nHop mismatch with silence gate(expected %d, got %d)" % (len(obsProbList_pf), len(obsProbList_g)))
+    exit(1)
+if(rtpyinProc.skippedFrames == 0):
+    print("Test failed with silence gate, no frame skipped")
+    exit(1)
+del x
+del rtpyinProc
+
 print("Python without prefilter...")
 x = w
 rtpyinProc = p.rtpyin.Processor(sr, prefilter = False)
@@ -128,6 +152,11 @@ for i, obsProb in enumerate(obsProbList_pf):
         print("Test failed with prefilter @ obsProb", i)
         print("  Diff:", obsProb - obsProbList_pf_o[i])
 
+for i, obsProb in enumerate(obsProbList_g):
+    if(len(obsProb) > 0 and (obsProbList_pf[i].shape != obsProb.shape or (obsProbList_pf[i] != obsProb).any())):
+        print("Test failed with silence gate @ obsProb", i)
+        exit(1)
+
 gc.collect()
 rvExitCheck()
 
@@ -0,0 +1,121 @@
+import numpy as np
+from revoice import *
+from revoice.common import *
+import subprocess
+import sys
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+def feedHops(proc, x, hopSize):
+    outList = []
+    iInHop = 0
+    while(True):
+        data = x[iInHop * hopSize:(iInHop + 1) * hopSize]
+        if(len(data) == 0):
+            data = None
+        with RTSection():
+            out = proc(data)
+        if(out is not None):
+            outList.append(out)
+        elif(data is None):
+            break
+        iInHop += 1
+    return outList
+
+def check(name):
+    if(rvRTViolationCount() != 0):
+        print("Test failed, %s violated the real-time section %d time(s)" % (name, rvRTViolationCount()))
+        exit(1)
+
+print("RTFilter...")
+rtfilterProc = rtfilter.Procressor(rtfilter.firwinSingleBand(111, 0.0, 2500.0, "blackman", sr / 2), 512)
+for i in range(0, len(w) - 512, 512):
+    with RTSection():
+        rtfilterProc(w[i:i + 512])
+check("RTFilter")
+
+print("RTPYin...")
+rtpyinProc = rtpyin.Processor(sr)
+obsProbList = feedHops(rtpyinProc, w, rtpyinProc.hopSize)
+check("RTPYin")
+rtpyinGateProc = rtpyin.Processor(sr, gateThreshold = 1e-8)
+feedHops(rtpyinGateProc, w, rtpyinGateProc.hopSize)
+check("RTPYin with silence gate")
+
+hopSize = rtpyinProc.hopSize
+nHop = len(obsProbList)
+
+print("RTMonoPitch...")
+monoPitchProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(rtpyinProc))
+monoPitchDeltaProc = rtmonopitch.Processor(*rtmonopitch.parameterFromPYin(rtpyinProc))
+for iHop in range(nHop):
+    frame = getFrame(w, iHop * hopSize, 2 * hopSize)
+    with RTSection():
+        monoPitchProc(frame, obsProbList[iHop])
+        monoPitchDeltaProc.delta(frame, obsProbList[iHop])
+check("RTMonoPitch")
+
+print("RTMonoNote...")
+monoNoteProc = rtmononote.Processor(*rtmononote.parameterFromPYin(rtpyinProc))
+for iHop in range(nHop):
+    frame = getFrame(w, iHop * hopSize, 2 * hopSize)
+    with RTSection():
+        monoNoteProc(frame, obsProbList[iHop])
+with RTSection():
+    monoNoteProc.flush()
+check("RTMonoNote")
+
+print("RTPitchTracker...")
+trackerProc = rtpitchtracker.Processor(sr)
+feedHops(trackerProc, w, hopSize)
+check("RTPitchTracker")
+
+print("RTEnergyTracker...")
+energyProc = rtenergy.Processor(hopSize, 8, 1e-8)
+for i in range(0, len(w) - hopSize, hopSize):
+    with RTSection():
+        energyProc(w[i:i + hopSize])
+check("RTEnergyTracker")
+
+print("Violation reporting...")
+with RTSection():
+    with RTSection():
+        if(rvRTSectionDepth() != 2):
+            print("Test failed, sections do not nest")
+            exit(1)
+        violatingProc = rtenergy.Processor(hopSize, 8, 1e-8)
+if(rvRTSectionDepth() != 0):
+    print("Test failed, section depth is %d after leaving" % rvRTSectionDepth())
+    exit(1)
+if(rvRTViolationCount() == 0):
+    print("Test failed, allocation in a real-time section is not reported")
+    exit(1)
+
+print("Logging...")
+# the report of a violation is queued from inside the section, queueing is not a violation itself
+messageList = []
+setLogSink(lambda severity, message, nSuppressed: messageList.append(message))
+nViolation = rvRTViolationCount()
+with RTSection():
+    del violatingProc
+if(rvRTViolationCount() != nViolation + 1):
+    print("Test failed, expected 1 violation for one free, got %d" % (rvRTViolationCount() - nViolation))
+    exit(1)
+rvFlushLog()
+setLogSink(None)
+if(not any("free of block allocated in real-time section" in message for message in messageList)):
+    print("Test failed, the queued report is not delivered:", messageList)
+    exit(1)
+
+# aborting delivers the report at once, which must not report itself again
+script = "from revoice import *\nfrom revoice.common import *\nrvSetAbortOnRTViolation(True)\nwith RTSection():\n    proc = rtenergy.Processor(256, 8, 1e-8)\nprint('not aborted')"
+result = subprocess.run([sys.executable, "-c", script], capture_output = True, text = True)
+if(result.returncode == 0 or "not aborted" in result.stdout or result.stderr.count("in real-time section") != 1):
+    print("Test failed, abort on violation did not deliver exactly one report:", result.returncode, result.stderr)
+    exit(1)
+
+del energyProc, trackerProc, monoNoteProc, monoPitchDeltaProc, monoPitchProc, rtpyinGateProc, rtpyinProc, rtfilterProc
+gc.collect()
+rvExitCheck()
+print("Everything passed")
@@ -0,0 +1,84 @@
+import numpy as np
+import threading
+from revoice import *
+from revoice.common import *
+import pyrevoice as p
+import gc
+
+w, sr = loadWav("voices/yuri_orig.wav")
+
+def checkCover(pool, n, grainSize):
+    count = np.zeros(n, dtype = np.int32)
+    def func(iBegin, iEnd):
+        if(iEnd - iBegin > grainSize):
+            raise ValueError("chunk is larger than grainSize")
+        count[iBegin:iEnd] += 1
+    pool.parallelFor(n, grainSize, func)
+    return (count == 1).all()
+
+print("Parallel loop...")
+pool = threadpool.Pool(3)
+if(pool.size != 3):
+    print("Test failed, pool size is %d" % pool.size)
+    exit(1)
+for n, grainSize in ((0, 1), (1, 1), (7, 1), (1000, 7), (1000, 1000), (1000, 1001)):
+    if(not checkCover(pool, n, grainSize)):
+        print("Test failed, items are not processed exactly once @ n = %d, grainSize = %d" % (n, grainSize))
+        exit(1)
+
+print("Pinned workers...")
+pinnedPool = threadpool.Pool(2, cpuList = [0, 0])
+if(not checkCover(pinnedPool, 100, 3)):
+    print("Test failed with pinned workers")
+    exit(1)
+del pinnedPool
+
+print("External executor...")
+runThreadList = []
+def executor(run):
+    thread = threading.Thread(target = run)
+    runThreadList.append(thread)
+    thread.start()
+executorPool = threadpool.Pool(2, executor = executor)
+if(not checkCover(executorPool, 100, 3) or len(runThreadList) == 0):
+    print("Test failed with external executor")
+    exit(1)
+for thread in runThreadList:
+    thread.join()
+del executorPool
+
+print("Yin...")
+serialPool = threadpool.Pool(0)
+threadpool.setSharedPool(serialPool)
+yinProc = yin.Processor(sr)
+f0List = yinProc(w)
+threadpool.setSharedPool(pool)
+f0List_p = yinProc(w)
+if((f0List != f0List_p).any()):
+    print("Test failed, yin output depends on the pool")
+    exit(1)
+del yinProc
+
+print("HMM posterior...")
+monopitchProc = p.monopitch.Processor(256, 44100.0, 36, 3.0, 80.0)
+pyModel = monopitchProc.model
+cModel = hmm.SparseHMM(pyModel.init, pyModel.frm, pyModel.to, pyModel.transProb)
+obsSeq = np.random.uniform(0.0, 1.0, (500, len(pyModel.init))) ** 3 + 1e-5
+gamma, logLikelihood = cModel.posterior(obsSeq, 1)
+gamma_p, logLikelihood_p = cModel.posterior(obsSeq, 4)
+if((gamma != gamma_p).any() or logLikelihood != logLikelihood_p):
+    print("Test failed, posterior depends on nThread")
+    exit(1)
+threadpool.setSharedPool(serialPool)
+gamma_p, logLikelihood_p = cModel.posterior(obsSeq, 4)
+threadpool.setSharedPool(pool)
+if((gamma != gamma_p).any() or logLikelihood != logLikelihood_p):
+    print("Test failed, posterior depends on nThread with a serial pool")
+    exit(1)
+del cModel
+
+threadpool.setSharedPool(None)
+del pool, serialPool
+gc.collect()
+rvExitCheck()
+print("Everything passed")